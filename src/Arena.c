@@ -3,18 +3,235 @@
 #include "klib/print.h"
 #include "klib/Gpa.h"
 
+#include <assert.h>
+
+#define K_NAME VecInt
+#define K_TYPE int
+#include "klib/VecGen-inl.h"
+
 typedef struct ArenaPtrI64
 {
     k_ArenaPtr base;
     int64_t* pI;
 } ArenaPtrI64;
 
+/* Interleaved growth of several vectors in one arena: only the last block can grow in place,
+ * so every other Grow() moves the buffer and leaves a hole behind. */
+static void
+benchInterleavedGrowth(void)
+{
+    enum { N_VECS = 8, N_PUSHES = 100000 };
+
+    k_Arena arena;
+    if (!k_ArenaInit(&arena, K_SIZE_1G, 0)) return;
+
+    VecInt aVecs[N_VECS] = {0};
+    ssize_t aPrevCaps[N_VECS] = {0};
+    ssize_t noReuseBytes = 0; /* What the arena would hold if every moved block was leaked. */
+
+    for (int i = 0; i < N_PUSHES; ++i)
+    {
+        for (ssize_t j = 0; j < N_VECS; ++j)
+        {
+            VecIntPush(&aVecs[j], &arena.base, &i);
+            if (aVecs[j].cap != aPrevCaps[j])
+            {
+                noReuseBytes += aVecs[j].cap * (ssize_t)sizeof(int);
+                aPrevCaps[j] = aVecs[j].cap;
+            }
+        }
+    }
+
+    ssize_t liveBytes = 0;
+    for (ssize_t j = 0; j < N_VECS; ++j)
+    {
+        for (int i = 0; i < N_PUSHES; ++i) assert(aVecs[j].pData[i] == i);
+        liveBytes += aVecs[j].cap * (ssize_t)sizeof(int);
+    }
+
+    k_print(&k_GpaInst()->base, stdout, "interleaved growth: live: {sz} KiB, high-water: {sz} KiB, without hole reuse: {sz} KiB\n",
+        liveBytes / K_SIZE_1K, k_ArenaMemoryUsed(&arena) / K_SIZE_1K, noReuseBytes / K_SIZE_1K
+    );
+
+    k_ArenaDestroy(&arena);
+}
+
+/* One spike followed by small cycles: committed memory drops back once the spike leaves the window. */
+static void
+demoTrim(void)
+{
+    enum { TRIM_RESETS = 4 };
+
+    k_Arena arena;
+    if (!k_ArenaInitWithOpts(&arena, (k_ArenaInitOpts){
+        .reserveSize = K_SIZE_1G,
+        .commitSize = K_SIZE_1K * 64,
+        .trimResets = TRIM_RESETS,
+    })) return;
+
+    for (ssize_t i = 0; i < TRIM_RESETS + 2; ++i)
+    {
+        const ssize_t size = i == 0 ? K_SIZE_1M * 32 : K_SIZE_1K * 16;
+        uint8_t* pBytes = K_IMALLOC_T(&arena, uint8_t, size);
+        memset(pBytes, 1, size);
+
+        k_ArenaReset(&arena);
+        k_print(&k_GpaInst()->base, stdout, "trim cycle {sz}: high-water: {sz} KiB, committed: {sz} KiB\n",
+            i, k_ArenaHighWater(&arena) / K_SIZE_1K, k_ArenaMemoryCommitted(&arena) / K_SIZE_1K
+        );
+    }
+
+    assert(k_ArenaMemoryCommitted(&arena) < K_SIZE_1M);
+    k_ArenaDestroy(&arena);
+}
+
+typedef struct FileNode
+{
+    k_OffPtr next; /* FileNode*. */
+    int64_t value;
+} FileNode;
+
+typedef struct FileRoot
+{
+    k_OffPtr head; /* FileNode*. */
+    int64_t nNodes;
+} FileRoot;
+
+/* Builds a list in a file backed arena, then reopens the file and walks it again. */
+static void
+demoFile(void)
+{
+    enum { N_NODES = 1000 };
+    static const char* ntsPath = "/tmp/klib-arena-file-demo.bin";
+
+    remove(ntsPath);
+
+    k_Arena arena;
+    if (!k_ArenaInitWithOpts(&arena, (k_ArenaInitOpts){.reserveSize = K_SIZE_1M * 8, .ntsFilePathOrNull = ntsPath})) return;
+
+    FileRoot* pRoot = K_IZALLOC_T(&arena, FileRoot, 1);
+    k_ArenaFileSetRoot(&arena, pRoot);
+    for (int64_t i = 0; i < N_NODES; ++i)
+    {
+        FileNode* pNode = K_IMALLOC_T(&arena, FileNode, 1);
+        pNode->value = i;
+        k_OffPtrSet(&pNode->next, k_OffPtrGet(&pRoot->head));
+        k_OffPtrSet(&pRoot->head, pNode);
+        ++pRoot->nNodes;
+    }
+    const ssize_t usedBefore = k_ArenaMemoryUsed(&arena);
+    k_ArenaDestroy(&arena);
+
+    if (!k_ArenaInitWithOpts(&arena, (k_ArenaInitOpts){.reserveSize = K_SIZE_1M * 8, .ntsFilePathOrNull = ntsPath})) return;
+
+    pRoot = k_ArenaFileRoot(&arena);
+    assert(pRoot && pRoot->nNodes == N_NODES);
+    assert(k_ArenaMemoryUsed(&arena) == usedBefore);
+
+    int64_t sum = 0;
+    for (FileNode* pNode = K_OFF_PTR_GET(FileNode, &pRoot->head); pNode; pNode = K_OFF_PTR_GET(FileNode, &pNode->next))
+        sum += pNode->value;
+    assert(sum == (int64_t)N_NODES * (N_NODES - 1) / 2);
+
+    k_print(&k_GpaInst()->base, stdout, "file arena: reopened {i64} nodes, sum: {i64}, used: {sz}, relocated: {b}\n",
+        pRoot->nNodes, sum, k_ArenaMemoryUsed(&arena), k_ArenaFileRelocated(&arena)
+    );
+
+    k_ArenaDestroy(&arena);
+    remove(ntsPath);
+}
+
+/* Blocks end right at an inaccessible page, writing past them or into a released scope faults. */
+static void
+demoGuardPages(void)
+{
+    k_Arena arena;
+    if (!k_ArenaInitWithOpts(&arena, (k_ArenaInitOpts){.reserveSize = K_SIZE_1M * 16, .bGuardPages = true})) return;
+
+    VecInt v = {0};
+    K_ARENA_SCOPE(&arena)
+    {
+        for (int i = 0; i < 1000; ++i) VecIntPush(&v, &arena.base, &i);
+        assert(((uintptr_t)(v.pData + v.cap) & (k_getPageSize() - 1)) == 0);
+        for (int i = 0; i < 1000; ++i) assert(v.pData[i] == i);
+    }
+
+    k_print(&k_GpaInst()->base, stdout, "guard pages: {sz} ints, used after scope: {sz}\n", v.size, k_ArenaMemoryUsed(&arena));
+    k_ArenaDestroy(&arena);
+}
+
+/* Scopes put the holes back the way they were: moved pre-scope blocks stay allocated, used holes are free again. */
+static void
+testScopeHoles(void)
+{
+    k_Arena arena;
+    if (!k_ArenaInit(&arena, K_SIZE_1M, 0)) return;
+
+    /* Pre-scope hole, then a pre-scope last block that gets moved inside the scope. */
+    uint8_t* pHoleMaker = k_ArenaMalloc(&arena, 128);
+    uint8_t* pKeep = k_ArenaMalloc(&arena, 64);
+    uint8_t* pMoved = k_ArenaRealloc(&arena, pHoleMaker, 128, 4096);
+    assert(pMoved != pHoleMaker);
+    (void)pKeep;
+
+    uint8_t* pLast = k_ArenaMalloc(&arena, 256);
+    const ssize_t posBefore = k_ArenaMemoryUsed(&arena);
+
+    K_ARENA_SCOPE(&arena)
+    {
+        uint8_t* pFromHole = k_ArenaMalloc(&arena, 128);
+        assert(pFromHole == pHoleMaker);
+        uint8_t* pAfter = k_ArenaMalloc(&arena, 64);
+        uint8_t* pLastMoved = k_ArenaRealloc(&arena, pLast, 256, 1024);
+        assert(pLastMoved != pLast);
+        (void)pFromHole, (void)pAfter, (void)pLastMoved;
+    }
+    assert(k_ArenaMemoryUsed(&arena) == posBefore);
+
+    /* pLast is still the bump block and its old place is not a hole. */
+    uint8_t* pNext = k_ArenaMalloc(&arena, 256);
+    assert(pNext != pLast && k_ArenaMemoryUsed(&arena) > posBefore);
+    uint8_t* pGrown = k_ArenaRealloc(&arena, pNext, 256, 512);
+    assert(pGrown == pNext);
+    (void)pGrown;
+
+    /* The hole used inside the scope is free again. */
+    uint8_t* pAgain = k_ArenaMalloc(&arena, 128);
+    assert(pAgain == pHoleMaker);
+    (void)pAgain;
+
+    /* A pre-scope block grown into the hole after it inside the scope keeps that memory. */
+    k_ArenaReset(&arena);
+    uint8_t* pX = k_ArenaMalloc(&arena, 64);
+    uint8_t* pH = k_ArenaMalloc(&arena, 128);
+    uint8_t* pY = k_ArenaMalloc(&arena, 64);
+    pH = k_ArenaRealloc(&arena, pH, 128, 4096);
+    (void)pY;
+
+    K_ARENA_SCOPE(&arena)
+    {
+        uint8_t* pXGrown = k_ArenaRealloc(&arena, pX, 64, 192);
+        assert(pXGrown == pX);
+        (void)pXGrown;
+    }
+    memset(pX, 'x', 192);
+
+    uint8_t* pReused = k_ArenaMalloc(&arena, 128);
+    assert(pReused + 128 <= pX || pReused >= pX + 192);
+    memset(pReused, 'r', 128);
+    for (ssize_t i = 0; i < 192; ++i) assert(pX[i] == 'x');
+
+    k_ArenaDestroy(&arena);
+}
+
 int
 main(void)
 {
     k_print_Map* pPrintMap = k_print_MapAlloc(&k_GpaInst()->base);
     k_print_MapSetGlobal(pPrintMap);
 
+    testScopeHoles();
+
     k_Arena arena;
     if (k_ArenaInit(&arena, K_SIZE_1M * 60, k_getPageSize()))
     {
@@ -51,5 +268,35 @@ main(void)
     }
     k_ArenaDestroy(&arena);
 
+    k_Arena hugeArena;
+    if (k_ArenaInitWithOpts(&hugeArena, (k_ArenaInitOpts){
+        .reserveSize = K_SIZE_1M * 60,
+        .commitSize = K_SIZE_1K * 4,
+        .ePages = K_ARENA_PAGES_HUGE_EXPLICIT,
+    }))
+    {
+        static const char* aNtsPages[] = {"default", "huge transparent", "huge explicit"};
+
+        uint8_t* pBytes = K_IMALLOC_T(&hugeArena, uint8_t, K_SIZE_1M * 3);
+        memset(pBytes, 1, K_SIZE_1M * 3);
+        assert(((uintptr_t)hugeArena.priv.pData & (K_ARENA_HUGE_PAGE_SIZE - 1)) == 0 || k_ArenaPages(&hugeArena) == K_ARENA_PAGES_DEFAULT);
+
+        k_print(&k_GpaInst()->base, stdout, "huge arena pages: '{s}', used: {sz}, reserved: {sz}\n",
+            aNtsPages[k_ArenaPages(&hugeArena)], k_ArenaMemoryUsed(&hugeArena), k_ArenaMemoryReserved(&hugeArena)
+        );
+
+        /* Hugetlb pages may refuse MADV_DONTNEED, decommit must not fail on that. */
+        k_ArenaResetDecommit(&hugeArena);
+        assert(k_ArenaMemoryCommitted(&hugeArena) == 0);
+        pBytes = K_IMALLOC_T(&hugeArena, uint8_t, K_SIZE_1M);
+        memset(pBytes, 2, K_SIZE_1M);
+    }
+    k_ArenaDestroy(&hugeArena);
+
+    benchInterleavedGrowth();
+    demoTrim();
+    demoFile();
+    demoGuardPages();
+
     k_print_MapDealloc(&pPrintMap);
 }
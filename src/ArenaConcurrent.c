@@ -0,0 +1,86 @@
+#include "klib/ArenaConcurrent.h"
+#include "klib/ThreadPool.h"
+#include "klib/Gpa.h"
+#include "klib/print.h"
+
+#include <assert.h>
+
+#define N_TASKS 1000
+#define N_NUMBERS 100
+
+typedef struct Payload
+{
+    k_ArenaConcurrent* pArena;
+    ssize_t** ppResult;
+    ssize_t i;
+} Payload;
+
+static void
+fillTask(void* pArg)
+{
+    Payload* p = pArg;
+
+    /* Output goes straight into the shared arena. */
+    ssize_t* pNumbers = K_IMALLOC_T(p->pArena, ssize_t, N_NUMBERS);
+    assert(pNumbers);
+    for (ssize_t i = 0; i < N_NUMBERS; ++i)
+        pNumbers[i] = p->i * N_NUMBERS + i;
+
+    *p->ppResult = pNumbers;
+}
+
+int
+main(void)
+{
+    k_Gpa gpa = k_GpaCreate();
+    k_print_Map* pFormattersMap = k_print_MapAlloc(&gpa.base);
+    if (!pFormattersMap) return 1;
+    k_print_MapSetGlobal(pFormattersMap);
+
+    k_ArenaConcurrent arena;
+    if (!k_ArenaConcurrentInit(&arena, K_SIZE_1M*60, 0)) return 1;
+
+    k_ThreadPool tp = {0};
+    if (!k_ThreadPoolInit(&tp, (k_ThreadPoolInitOpts){
+        .nThreads = k_optimalThreadCount(),
+        .arenaReserve = K_SIZE_1K*60,
+        .ringBufferSize = K_SIZE_1K*4,
+    }))
+    {
+        k_print(&gpa.base, stdout, "FAILED\n");
+        return 1;
+    }
+
+    static ssize_t* s_apResults[N_TASKS];
+
+    for (ssize_t round = 0; round < 2; ++round)
+    {
+        for (ssize_t i = 0; i < N_TASKS; ++i)
+        {
+            Payload pl = {.pArena = &arena, .ppResult = &s_apResults[i], .i = i};
+            k_ThreadPoolAdd(&tp, fillTask, &pl, sizeof(pl));
+        }
+        k_ThreadPoolWait(&tp);
+
+        for (ssize_t i = 0; i < N_TASKS; ++i)
+            for (ssize_t j = 0; j < N_NUMBERS; ++j)
+                assert(s_apResults[i][j] == i * N_NUMBERS + j);
+
+        k_print(&gpa.base, stdout, "round: {sz}, used: {sz}\n", round, k_ArenaConcurrentMemoryUsed(&arena));
+        assert(k_ArenaConcurrentMemoryUsed(&arena) == (ssize_t)sizeof(ssize_t) * N_TASKS * N_NUMBERS);
+        k_ArenaConcurrentReset(&arena);
+    }
+
+    /* Running out of reserve doesn't poison the arena for allocations that still fit. */
+    void* pTooBig = k_ArenaConcurrentMalloc(&arena, k_ArenaConcurrentMemoryReserved(&arena) + 1);
+    assert(!pTooBig);
+    void* pSmall = k_ArenaConcurrentMalloc(&arena, 64);
+    assert(pSmall && k_ArenaConcurrentMemoryUsed(&arena) == 64);
+    void* pGrown = k_ArenaConcurrentRealloc(&arena, pSmall, 64, k_ArenaConcurrentMemoryReserved(&arena) + 1);
+    assert(!pGrown && k_ArenaConcurrentMemoryUsed(&arena) == 64);
+    (void)pTooBig, (void)pGrown;
+
+    k_ThreadPoolDestroy(&tp);
+    k_ArenaConcurrentDestroy(&arena);
+    k_print_MapDealloc(&pFormattersMap);
+}
@@ -0,0 +1,305 @@
+#include "klib/Gpa.h"
+#include "klib/print.h"
+#include "klib/time.h"
+#include "klib/TrackingAllocator.h"
+
+static ssize_t
+cmpU64(const uint64_t* l, const uint64_t* r)
+{
+    return (*l > *r) - (*l < *r);
+}
+
+#define K_NAME BTreeU64
+#define K_KEY_T uint64_t
+#define K_VALUE_T uint64_t
+#define K_FN_KEY_CMP cmpU64
+#include "klib/BTreeGen-inl.h"
+
+/* Tiny nodes, so a few thousand keys already make a deep tree. */
+#define K_NAME TinyBTreeU64
+#define K_KEY_T uint64_t
+#define K_VALUE_T uint64_t
+#define K_FN_KEY_CMP cmpU64
+#define K_BTREE_LEAF_CAP 3
+#define K_BTREE_INNER_CAP 2
+#include "klib/BTreeGen-inl.h"
+
+#define K_NAME BTreeSvToInt
+#define K_KEY_T k_StringView
+#define K_VALUE_T int
+#define K_FN_KEY_CMP k_StringViewCmp
+#include "klib/BTreeGen-inl.h"
+
+#include <assert.h>
+
+enum { N_REF = 4096, N_OPS = 50000, N_BENCH = 1 << 20, N_RANGES = 1 << 14, RANGE_LEN = 64 };
+
+static uint64_t
+xorshift(uint64_t* pRng)
+{
+    uint64_t x = *pRng;
+    x ^= x << 13, x ^= x >> 7, x ^= x << 17;
+    return *pRng = x;
+}
+
+/* Walks the whole tree and compares against a presence table. */
+static void
+checkAgainst(TinyBTreeU64* pTree, const bool* aPresent)
+{
+    ssize_t n = 0;
+    uint64_t expected = 0;
+    for (TinyBTreeU64It it = TinyBTreeU64Begin(pTree); TinyBTreeU64ItValid(it); TinyBTreeU64ItNext(&it), ++n)
+    {
+        while (!aPresent[expected]) ++expected;
+        assert(*TinyBTreeU64ItKey(it) == expected);
+        assert(*TinyBTreeU64ItValue(it) == expected * 10);
+        ++expected;
+    }
+    assert(n == pTree->size);
+}
+
+static void
+testRandomOps(k_IAllocator* pAlloc)
+{
+    TinyBTreeU64 tree = {0};
+    bool aPresent[N_REF] = {0};
+    ssize_t size = 0;
+    uint64_t rng = 0x9e3779b97f4a7c15LLU;
+
+    for (ssize_t i = 0; i < N_OPS; ++i)
+    {
+        const uint64_t key = xorshift(&rng) % N_REF;
+        const uint64_t val = key * 10;
+
+        /* Mostly inserts so the tree keeps growing, removes leave empty leaves behind. */
+        if (xorshift(&rng) % 3)
+        {
+            const K_MAP_RESULT_STATUS eStatus = TinyBTreeU64Insert(&tree, pAlloc, &key, &val);
+            assert(eStatus == (aPresent[key] ? K_MAP_RESULT_STATUS_FOUND : K_MAP_RESULT_STATUS_INSERTED));
+            if (!aPresent[key]) ++size;
+            aPresent[key] = true;
+        }
+        else
+        {
+            const bool bRemoved = TinyBTreeU64Remove(&tree, &key);
+            assert(bRemoved == aPresent[key]);
+            if (aPresent[key]) --size;
+            aPresent[key] = false;
+        }
+
+        const uint64_t* pVal = TinyBTreeU64Search(&tree, &key);
+        assert((pVal != NULL) == aPresent[key]);
+        (void)pVal;
+    }
+
+    assert(tree.size == size);
+    checkAgainst(&tree, aPresent);
+
+    /* LowerBound/UpperBound against a linear scan of the reference. */
+    for (uint64_t key = 0; key < N_REF; ++key)
+    {
+        uint64_t lower = key;
+        while (lower < N_REF && !aPresent[lower]) ++lower;
+        uint64_t upper = key + 1;
+        while (upper < N_REF && !aPresent[upper]) ++upper;
+
+        TinyBTreeU64It itLower = TinyBTreeU64LowerBound(&tree, &key);
+        TinyBTreeU64It itUpper = TinyBTreeU64UpperBound(&tree, &key);
+        assert(lower == N_REF ? !TinyBTreeU64ItValid(itLower) : *TinyBTreeU64ItKey(itLower) == lower);
+        assert(upper >= N_REF ? !TinyBTreeU64ItValid(itUpper) : *TinyBTreeU64ItKey(itUpper) == upper);
+        (void)itLower, (void)itUpper;
+    }
+
+    const int heightBefore = tree.height;
+    const bool bCompacted = TinyBTreeU64Compact(&tree, pAlloc);
+    assert(bCompacted && tree.size == size && tree.height <= heightBefore);
+    checkAgainst(&tree, aPresent);
+    (void)bCompacted;
+
+    k_print(pAlloc, stdout, "random ops: {sz} keys, height {i} -> {i} after compact\n", tree.size, heightBefore, tree.height);
+
+    TinyBTreeU64Destroy(&tree, pAlloc);
+}
+
+/* Fails every FAIL_EVERY'th malloc, to hit splits that run out of memory halfway up the tree. */
+typedef struct FlakyAlloc
+{
+    k_IAllocator base;
+    k_IAllocator* pBacking;
+    ssize_t nMallocs;
+} FlakyAlloc;
+
+enum { FAIL_EVERY = 7 };
+
+static void*
+flakyMalloc(void* pSelf, ssize_t nBytes)
+{
+    FlakyAlloc* s = pSelf;
+    if (++s->nMallocs % FAIL_EVERY == 0) return NULL;
+    return k_IAllocatorMalloc(s->pBacking, nBytes);
+}
+
+static void*
+flakyZalloc(void* pSelf, ssize_t nBytes)
+{
+    void* p = flakyMalloc(pSelf, nBytes);
+    if (p) memset(p, 0, nBytes);
+    return p;
+}
+
+static void*
+flakyRealloc(void* pSelf, void* p, ssize_t nBytesOld, ssize_t nBytesNew)
+{
+    FlakyAlloc* s = pSelf;
+    if (++s->nMallocs % FAIL_EVERY == 0) return NULL;
+    return k_IAllocatorRealloc(s->pBacking, p, nBytesOld, nBytesNew);
+}
+
+static void
+flakyFree(void* pSelf, void* p)
+{
+    k_IAllocatorFree(((FlakyAlloc*)pSelf)->pBacking, p);
+}
+
+/* A failed insert leaves the tree as it was and leaks nothing. */
+static void
+testOutOfMemory(k_IAllocator* pAlloc)
+{
+    static const k_IAllocatorVTable s_vTable = {
+        .malloc = flakyMalloc,
+        .zalloc = flakyZalloc,
+        .realloc = flakyRealloc,
+        .free = flakyFree,
+    };
+
+    k_TrackingAllocator tr;
+    const bool bInit = k_TrackingAllocatorInit(&tr, pAlloc);
+    assert(bInit);
+    (void)bInit;
+
+    FlakyAlloc flaky = {.base = {&s_vTable}, .pBacking = &tr.base};
+    TinyBTreeU64 tree = {0};
+    bool aPresent[N_REF] = {0};
+    ssize_t nFailed = 0;
+    uint64_t rng = 0x2545f4914f6cdd1dLLU;
+
+    for (ssize_t i = 0; i < N_REF; ++i)
+    {
+        const uint64_t key = xorshift(&rng) % N_REF;
+        const uint64_t val = key * 10;
+
+        const K_MAP_RESULT_STATUS eStatus = TinyBTreeU64Insert(&tree, &flaky.base, &key, &val);
+        if (eStatus == K_MAP_RESULT_STATUS_FAILED)
+        {
+            assert(!aPresent[key]);
+            ++nFailed;
+        }
+        else
+        {
+            assert(eStatus == (aPresent[key] ? K_MAP_RESULT_STATUS_FOUND : K_MAP_RESULT_STATUS_INSERTED));
+            aPresent[key] = true;
+        }
+    }
+
+    assert(nFailed > 0);
+    checkAgainst(&tree, aPresent);
+    for (uint64_t key = 0; key < N_REF; ++key)
+        assert((TinyBTreeU64Search(&tree, &key) != NULL) == aPresent[key]);
+
+    k_print(pAlloc, stdout, "out of memory: {sz} keys, height {i}, {sz} failed inserts\n", tree.size, tree.height, nFailed);
+
+    TinyBTreeU64Destroy(&tree, &flaky.base);
+    assert(k_TrackingAllocatorLiveBlocks(&tr) == 0);
+    k_TrackingAllocatorDestroy(&tr);
+}
+
+static void
+testStrings(k_IAllocator* pAlloc)
+{
+    const k_StringView aWords[] = {K_SV("pear"), K_SV("apple"), K_SV("fig"), K_SV("banana"), K_SV("cherry"), K_SV("apricot")};
+
+    BTreeSvToInt tree = {0};
+    for (int i = 0; i < (int)K_ASIZE(aWords); ++i)
+        BTreeSvToIntInsert(&tree, pAlloc, &aWords[i], &i);
+
+    /* Prefix range: everything in ["ap", "aq"). */
+    k_print(pAlloc, stdout, "words with 'ap':");
+    const k_StringView svTo = K_SV("aq");
+    for (BTreeSvToIntIt it = BTreeSvToIntLowerBound(&tree, &K_SV("ap"));
+        BTreeSvToIntItValid(it) && k_StringViewCmp(BTreeSvToIntItKey(it), &svTo) < 0;
+        BTreeSvToIntItNext(&it)
+    )
+    {
+        k_print(pAlloc, stdout, " {PSv}", BTreeSvToIntItKey(it));
+    }
+    k_print(pAlloc, stdout, "\n");
+
+    BTreeSvToIntDestroy(&tree, pAlloc);
+}
+
+static void
+benchRanges(k_IAllocator* pAlloc)
+{
+    uint64_t* aKeys = K_IMALLOC_T(pAlloc, uint64_t, N_BENCH);
+    for (ssize_t i = 0; i < N_BENCH; ++i) aKeys[i] = (uint64_t)i * 7;
+
+    BTreeU64 bulk = {0}, inserted = {0};
+
+    k_time_Type t0 = k_time_now();
+    const bool bLoaded = BTreeU64BulkLoad(&bulk, pAlloc, aKeys, aKeys, N_BENCH);
+    assert(bLoaded);
+    (void)bLoaded;
+    k_time_Type t1 = k_time_now();
+
+    uint64_t rng = 0xdeadbeefLLU;
+    for (ssize_t i = 0; i < N_BENCH; ++i)
+    {
+        const uint64_t key = aKeys[xorshift(&rng) % N_BENCH];
+        BTreeU64Insert(&inserted, pAlloc, &key, &key);
+    }
+    k_time_Type t2 = k_time_now();
+
+    uint64_t sum = 0;
+    for (ssize_t i = 0; i < N_RANGES; ++i)
+    {
+        const uint64_t from = xorshift(&rng) % ((uint64_t)N_BENCH * 7);
+        BTreeU64It it = BTreeU64LowerBound(&bulk, &from);
+        for (int j = 0; j < RANGE_LEN && BTreeU64ItValid(it); ++j, BTreeU64ItNext(&it))
+            sum += *BTreeU64ItValue(it);
+    }
+    k_time_Type t3 = k_time_now();
+
+    for (ssize_t i = 0; i < N_BENCH; ++i)
+    {
+        const uint64_t* pVal = BTreeU64Search(&bulk, &aKeys[i]);
+        assert(pVal && *pVal == aKeys[i]);
+        (void)pVal;
+    }
+
+    k_print(pAlloc, stdout, "bulk load {i}: {:.3:d} ms (height {i}); random inserts: {:.3:d} ms (height {i}, {sz} keys); {i} ranges of {i}: {:.3:d} ms (sum {u64})\n",
+        N_BENCH, k_time_diffMSec(t1, t0), bulk.height,
+        k_time_diffMSec(t2, t1), inserted.height, inserted.size,
+        N_RANGES, RANGE_LEN, k_time_diffMSec(t3, t2), sum
+    );
+
+    BTreeU64Destroy(&inserted, pAlloc);
+    BTreeU64Destroy(&bulk, pAlloc);
+    k_IAllocatorFree(pAlloc, aKeys);
+}
+
+int
+main(void)
+{
+    k_IAllocator* pAlloc = &k_GpaInst()->base;
+
+    k_print_Map* pFormattersMap = k_print_MapAlloc(pAlloc);
+    if (!pFormattersMap) return 1;
+    k_print_MapSetGlobal(pFormattersMap);
+
+    testRandomOps(pAlloc);
+    testOutOfMemory(pAlloc);
+    testStrings(pAlloc);
+    benchRanges(pAlloc);
+
+    k_print_MapDealloc(&pFormattersMap);
+}
@@ -0,0 +1,298 @@
+#include "klib/Gpa.h"
+#include "klib/print.h"
+#include "klib/time.h"
+
+#include <assert.h>
+
+typedef uint64_t (*HashPfn)(const uint8_t* p, ssize_t byteSize, uint64_t seed);
+
+typedef struct HashEntry
+{
+    const char* ntsName;
+    HashPfn pfn;
+} HashEntry;
+
+static uint64_t
+fastScalar(const uint8_t* p, ssize_t byteSize, uint64_t seed)
+{
+    if (byteSize > K_HASH_LONG_MIN) return k_hash_longImpl(K_HASH_IMPL_SCALAR, p, byteSize, seed);
+    return k_hash_fast(p, byteSize, seed);
+}
+
+static uint64_t
+fastAvx2(const uint8_t* p, ssize_t byteSize, uint64_t seed)
+{
+    if (byteSize > K_HASH_LONG_MIN) return k_hash_longImpl(K_HASH_IMPL_AVX2, p, byteSize, seed);
+    return k_hash_fast(p, byteSize, seed);
+}
+
+static const HashEntry s_aHashes[] = {
+#ifdef K_HASH_X86
+    {"crc32", k_hash_crc32},
+#endif
+    {"mulXor", k_hash_mulXor},
+    {"fast", k_hash_fast},
+    {"fast (scalar)", fastScalar},
+    {"fast (avx2)", fastAvx2},
+};
+
+/* One map per hash so probe lengths come from the real table. */
+#ifdef K_HASH_X86
+static uint64_t svCrc32(const k_StringView* pSv) { return k_hash_crc32((uint8_t*)pSv->pData, pSv->size, 0); }
+#endif
+static uint64_t svMulXor(const k_StringView* pSv) { return k_hash_mulXor((uint8_t*)pSv->pData, pSv->size, 0); }
+static uint64_t svFast(const k_StringView* pSv) { return k_hash_fast((uint8_t*)pSv->pData, pSv->size, 0); }
+
+#ifdef K_HASH_X86
+#define K_NAME MapCrc32
+#define K_KEY_T k_StringView
+#define K_VALUE_T int
+#define K_FN_HASH svCrc32
+#define K_FN_KEY_CMP k_StringViewCmp
+#include "klib/MapGen-inl.h"
+#endif
+
+#define K_NAME MapMulXor
+#define K_KEY_T k_StringView
+#define K_VALUE_T int
+#define K_FN_HASH svMulXor
+#define K_FN_KEY_CMP k_StringViewCmp
+#include "klib/MapGen-inl.h"
+
+#define K_NAME MapFast
+#define K_KEY_T k_StringView
+#define K_VALUE_T int
+#define K_FN_HASH svFast
+#define K_FN_KEY_CMP k_StringViewCmp
+#include "klib/MapGen-inl.h"
+
+enum { BUFF_SIZE = 1 << 20, BENCH_BYTES = 1 << 24, N_AVALANCHE = 1000, N_KEYS = 1 << 16 };
+
+static uint64_t
+xorshift(uint64_t* pRng)
+{
+    uint64_t x = *pRng;
+    x ^= x << 13, x ^= x >> 7, x ^= x << 17;
+    return *pRng = x;
+}
+
+static bool
+hasSse42(void)
+{
+#if defined K_HASH_X86 && (defined __clang__ || defined __GNUC__)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.2");
+#else
+    return true;
+#endif
+}
+
+static void
+benchThroughput(k_IAllocator* pAlloc, const uint8_t* pBuff)
+{
+    static const ssize_t aSizes[] = {1, 3, 4, 8, 15, 16, 32, 64, 100, 256, 257, 512, 1024, 4096};
+
+    k_print(pAlloc, stdout, "GB/s by key size:\n{:>8:s}", "size");
+    for (ssize_t hashI = 0; hashI < K_ASIZE(s_aHashes); ++hashI)
+        k_print(pAlloc, stdout, "{:>15:s}", s_aHashes[hashI].ntsName);
+    k_print(pAlloc, stdout, "\n");
+
+    uint64_t sink = 0;
+    for (ssize_t sizeI = 0; sizeI < K_ASIZE(aSizes); ++sizeI)
+    {
+        const ssize_t size = aSizes[sizeI];
+        const ssize_t nCalls = K_MIN(K_MAX(BENCH_BYTES / size, 1 << 16), 1 << 20);
+        k_print(pAlloc, stdout, "{:>8:sz}", size);
+
+        for (ssize_t hashI = 0; hashI < K_ASIZE(s_aHashes); ++hashI)
+        {
+            const HashPfn pfn = s_aHashes[hashI].pfn;
+            k_time_Type t0 = k_time_now();
+            /* Seeded with the running sum: calls can't overlap, like hashing before a dependent lookup. */
+            for (ssize_t i = 0; i < nCalls; ++i)
+                sink += pfn(pBuff + ((i * 64) & (BUFF_SIZE / 2 - 1)), size, sink);
+            const double ms = k_time_diffMSec(k_time_now(), t0);
+
+            k_print(pAlloc, stdout, "{:>15.3:d}", (double)(nCalls * size) / (ms * 1e6));
+        }
+        k_print(pAlloc, stdout, "\n");
+    }
+
+    k_print(pAlloc, stdout, "(checksum {u64})\n", sink);
+}
+
+/* Flip each input bit and count how often each output bit flips, ideal is half of the time. */
+static void
+testAvalanche(k_IAllocator* pAlloc)
+{
+    static const ssize_t aSizes[] = {8, 32, 300};
+    enum { MAX_SIZE = 300 };
+
+    ssize_t* aFlips = K_IMALLOC_T(pAlloc, ssize_t, MAX_SIZE * 8 * 64);
+    uint64_t rng = 0x2545f4914f6cdd1dLLU;
+
+    k_print(pAlloc, stdout, "avalanche (worst / mean |P(flip) - 0.5|, {i} samples):\n", N_AVALANCHE);
+    for (ssize_t hashI = 0; hashI < K_ASIZE(s_aHashes); ++hashI)
+    {
+        k_print(pAlloc, stdout, "{:>15:s}", s_aHashes[hashI].ntsName);
+
+        for (ssize_t sizeI = 0; sizeI < K_ASIZE(aSizes); ++sizeI)
+        {
+            const ssize_t size = aSizes[sizeI];
+            const ssize_t nInBits = size * 8;
+            memset(aFlips, 0, sizeof(*aFlips) * nInBits * 64);
+
+            uint8_t aKey[MAX_SIZE];
+            for (ssize_t sampleI = 0; sampleI < N_AVALANCHE; ++sampleI)
+            {
+                for (ssize_t i = 0; i < size; ++i) aKey[i] = (uint8_t)xorshift(&rng);
+                const uint64_t h0 = s_aHashes[hashI].pfn(aKey, size, 0);
+
+                for (ssize_t bitI = 0; bitI < nInBits; ++bitI)
+                {
+                    aKey[bitI / 8] ^= (uint8_t)(1 << (bitI % 8));
+                    const uint64_t diff = h0 ^ s_aHashes[hashI].pfn(aKey, size, 0);
+                    aKey[bitI / 8] ^= (uint8_t)(1 << (bitI % 8));
+
+                    for (ssize_t outI = 0; outI < 64; ++outI)
+                        aFlips[bitI*64 + outI] += (diff >> outI) & 1;
+                }
+            }
+
+            double worst = 0.0, sum = 0.0;
+            for (ssize_t i = 0; i < nInBits * 64; ++i)
+            {
+                const double bias = (double)aFlips[i] / N_AVALANCHE - 0.5;
+                const double absBias = bias < 0 ? -bias : bias;
+                worst = K_MAX(worst, absBias);
+                sum += absBias;
+            }
+
+            k_print(pAlloc, stdout, "  {sz}B: {:.3:d} / {:.3:d}", size, worst, sum / (double)(nInBits * 64));
+        }
+        k_print(pAlloc, stdout, "\n");
+    }
+
+    k_IAllocatorFree(pAlloc, aFlips);
+}
+
+typedef struct ProbeStats
+{
+    ssize_t aHist[7]; /* 0, 1, 2, 3, 4-7, 8-15, 16+. */
+    ssize_t max;
+    double mean;
+} ProbeStats;
+
+static void
+probeStatsAdd(ProbeStats* pStats, ssize_t probe)
+{
+    const ssize_t histI = probe < 4 ? probe : probe < 8 ? 4 : probe < 16 ? 5 : 6;
+    ++pStats->aHist[histI];
+    pStats->max = K_MAX(pStats->max, probe);
+    pStats->mean += (double)probe;
+}
+
+/* Distance of every key from its home bucket. */
+#define PROBE_STATS(Map, pAlloc, aKeys, n, pStats)                                                                     \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        Map _m = K_GLUE(Map, Create)(pAlloc, 8);                                                                       \
+        for (ssize_t _i = 0; _i < (n); ++_i)                                                                           \
+            K_GLUE(Map, Insert)(&_m, pAlloc, &(aKeys)[_i], &(int){0});                                                 \
+        *(pStats) = (ProbeStats){0};                                                                                   \
+        for (ssize_t _i = K_GLUE(Map, FirstI)(&_m); _i != K_GLUE(Map, EndI)(&_m); _i = K_GLUE(Map, NextI)(&_m, _i))    \
+        {                                                                                                              \
+            const ssize_t _home = (ssize_t)(K_GLUE(Map, Search)(&_m, &_m.pBuckets[_i].key).hash & (_m.cap - 1));         \
+            probeStatsAdd(pStats, (_i - _home) & (_m.cap - 1));                                                        \
+        }                                                                                                              \
+        (pStats)->mean /= (double)_m.size;                                                                             \
+        K_GLUE(Map, Destroy)(&_m, pAlloc);                                                                             \
+    } while (0)
+
+static void
+printProbeStats(k_IAllocator* pAlloc, const char* ntsName, const ProbeStats* pStats)
+{
+    k_print(pAlloc, stdout, "{:>15:s}  mean {:.3:d}, max {:>5:sz}, hist:", ntsName, pStats->mean, pStats->max);
+    for (ssize_t i = 0; i < K_ASIZE(pStats->aHist); ++i)
+        k_print(pAlloc, stdout, " {:>6:sz}", pStats->aHist[i]);
+    k_print(pAlloc, stdout, "\n");
+}
+
+static void
+testProbeLengths(k_IAllocator* pAlloc)
+{
+    char (*aStorage)[64] = k_IAllocatorMalloc(pAlloc, sizeof(*aStorage) * N_KEYS);
+    uint64_t* aInts = K_IMALLOC_T(pAlloc, uint64_t, N_KEYS);
+    k_StringView* aKeys = K_IMALLOC_T(pAlloc, k_StringView, N_KEYS);
+
+    static const char* aNtsSets[] = {"identifiers", "urls", "integers"};
+    for (ssize_t setI = 0; setI < K_ASIZE(aNtsSets); ++setI)
+    {
+        for (ssize_t i = 0; i < N_KEYS; ++i)
+        {
+            if (setI == 0)
+            {
+                aKeys[i] = (k_StringView){aStorage[i], k_print_toBuffer(aStorage[i], sizeof(aStorage[i]), "m_field{sz}", i)};
+            }
+            else if (setI == 1)
+            {
+                aKeys[i] = (k_StringView){aStorage[i],
+                    k_print_toBuffer(aStorage[i], sizeof(aStorage[i]), "https://example.com/api/v1/users/{sz}/posts", i)
+                };
+            }
+            else
+            {
+                aInts[i] = (uint64_t)i;
+                aKeys[i] = (k_StringView){(char*)&aInts[i], sizeof(aInts[i])};
+            }
+        }
+
+        k_print(pAlloc, stdout, "probe lengths, {i} {s} (0, 1, 2, 3, 4-7, 8-15, 16+):\n", N_KEYS, aNtsSets[setI]);
+        ProbeStats stats;
+#ifdef K_HASH_X86
+        PROBE_STATS(MapCrc32, pAlloc, aKeys, N_KEYS, &stats);
+        printProbeStats(pAlloc, "crc32", &stats);
+#endif
+        PROBE_STATS(MapMulXor, pAlloc, aKeys, N_KEYS, &stats);
+        printProbeStats(pAlloc, "mulXor", &stats);
+        PROBE_STATS(MapFast, pAlloc, aKeys, N_KEYS, &stats);
+        printProbeStats(pAlloc, "fast", &stats);
+    }
+
+    k_IAllocatorFree(pAlloc, aKeys);
+    k_IAllocatorFree(pAlloc, aInts);
+    k_IAllocatorFree(pAlloc, aStorage);
+}
+
+int
+main(void)
+{
+    k_IAllocator* pAlloc = &k_GpaInst()->base;
+
+    k_print_Map* pFormattersMap = k_print_MapAlloc(pAlloc);
+    if (!pFormattersMap) return 1;
+    k_print_MapSetGlobal(pFormattersMap);
+
+    if (!hasSse42())
+    {
+        k_print(pAlloc, stderr, "crc32 needs SSE4.2\n");
+        return 1;
+    }
+
+    uint8_t* pBuff = k_IAllocatorMalloc(pAlloc, BUFF_SIZE);
+    uint64_t rng = 0x9e3779b97f4a7c15LLU;
+    for (ssize_t i = 0; i < BUFF_SIZE; ++i) pBuff[i] = (uint8_t)xorshift(&rng);
+
+    /* Both long key paths have to agree. */
+    for (ssize_t size = K_HASH_LONG_MIN + 1; size < 8192; size += 13)
+        assert(fastScalar(pBuff, size, (uint64_t)size) == fastAvx2(pBuff, size, (uint64_t)size));
+
+    k_print(pAlloc, stdout, "k_hash_long: {s}\n", k_hash_bestImpl() == K_HASH_IMPL_AVX2 ? "avx2" : "scalar");
+
+    benchThroughput(pAlloc, pBuff);
+    testAvalanche(pAlloc);
+    testProbeLengths(pAlloc);
+
+    k_IAllocatorFree(pAlloc, pBuff);
+    k_print_MapDealloc(&pFormattersMap);
+}
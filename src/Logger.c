@@ -1,6 +1,8 @@
 #include "klib/Ctx.h"
 #include "klib/Gpa.h"
 
+#include <assert.h>
+
 static void
 func(void* pArg)
 {
@@ -8,6 +10,30 @@ func(void* pArg)
     K_CTX_LOG_DEBUG("i: {sz}", i);
 }
 
+/* Result goes to pArena, temporaries to a scratch arena that can't be pArena. */
+static k_StringView
+joinNumbers(k_Arena* pArena, ssize_t n)
+{
+    k_StringView ret = {0};
+
+    K_SCRATCH_SCOPE(pArena, pScratch)
+    {
+        k_print_Builder pb;
+        if (!k_print_BuilderInit(&pb, (k_print_BuilderInitOpts){.pAllocOrNull = &pScratch->base, .preallocOrBufferSize = 16}))
+            break;
+
+        for (ssize_t i = 0; i < n; ++i)
+            k_print_BuilderPrint(&pb, "{sz}{s}", i, i + 1 < n ? ", " : "");
+
+        char* pData = K_IMALLOC_T(pArena, char, pb.size);
+        if (!pData) break;
+        memcpy(pData, pb.pData, pb.size);
+        ret = (k_StringView){pData, pb.size};
+    }
+
+    return ret;
+}
+
 int
 main(void)
 {
@@ -26,6 +52,15 @@ main(void)
         }
     );
 
+    /* Scratch arenas can't be reserved yet: log messages fall back to k_CtxArena(). */
+    {
+        const ssize_t scratchReserve = k_CtxInst()->scratchReserve;
+        k_CtxInst()->scratchReserve = (ssize_t)1 << 60;
+        assert(k_CtxScratchArena(k_CtxArena()) == NULL);
+        K_CTX_LOG_INFO("logged without a scratch arena");
+        k_CtxInst()->scratchReserve = scratchReserve;
+    }
+
     k_ThreadPool* pThreadPool = k_CtxThreadPool();
     for (ssize_t i = 0; i < 20; ++i)
         k_ThreadPoolAdd(pThreadPool, func, &i, sizeof(i));
@@ -34,5 +69,11 @@ main(void)
     for (ssize_t i = 0; i < 10; ++i)
         K_CTX_LOG_INFO("i: {d}", (double)i);
 
+    K_ARENA_SCOPE(k_CtxArena())
+    {
+        k_StringView sv = joinNumbers(k_CtxArena(), 10);
+        K_CTX_LOG_INFO("joined: '{PSv}'", &sv);
+    }
+
     k_CtxDestroyGlobal();
 }
@@ -10,6 +10,115 @@
 #define K_GEN_CODE
 #include "klib/MapGen-inl.h"
 
+#define K_NAME SwissSvToInt
+#define K_KEY_T k_StringView
+#define K_VALUE_T int
+#define K_FN_HASH k_StringViewHash
+#define K_FN_KEY_CMP k_StringViewCmp
+#define K_MAP_SWISS
+#include "klib/MapGen-inl.h"
+
+static ssize_t s_nHashCalls;
+
+static uint64_t
+countedHash(const k_StringView* pSv)
+{
+    ++s_nHashCalls;
+    return k_StringViewHash(pSv);
+}
+
+#define K_NAME CountedSvToInt
+#define K_KEY_T k_StringView
+#define K_VALUE_T int
+#define K_FN_HASH countedHash
+#define K_FN_KEY_CMP k_StringViewCmp
+#include "klib/MapGen-inl.h"
+
+#define K_NAME StoredSvToInt
+#define K_KEY_T k_StringView
+#define K_VALUE_T int
+#define K_FN_HASH countedHash
+#define K_FN_KEY_CMP k_StringViewCmp
+#define K_MAP_STORE_HASH
+#include "klib/MapGen-inl.h"
+
+#define K_NAME StoredSwissSvToInt
+#define K_KEY_T k_StringView
+#define K_VALUE_T int
+#define K_FN_HASH countedHash
+#define K_FN_KEY_CMP k_StringViewCmp
+#define K_MAP_SWISS
+#define K_MAP_STORE_HASH
+#include "klib/MapGen-inl.h"
+
+static uint64_t
+hashU64(const uint64_t* p)
+{
+    const uint64_t x = *p * 0x9e3779b97f4a7c15LLU;
+    return x ^ (x >> 29);
+}
+
+static ssize_t
+cmpU64(const uint64_t* l, const uint64_t* r)
+{
+    return *l != *r;
+}
+
+#define K_NAME MapU64
+#define K_KEY_T uint64_t
+#define K_VALUE_T uint64_t
+#define K_FN_HASH hashU64
+#define K_FN_KEY_CMP cmpU64
+#include "klib/MapGen-inl.h"
+
+#define K_NAME SwissU64
+#define K_KEY_T uint64_t
+#define K_VALUE_T uint64_t
+#define K_FN_HASH hashU64
+#define K_FN_KEY_CMP cmpU64
+#define K_MAP_SWISS
+#include "klib/MapGen-inl.h"
+
+#define K_NAME IncSwissU64
+#define K_KEY_T uint64_t
+#define K_VALUE_T uint64_t
+#define K_FN_HASH hashU64
+#define K_FN_KEY_CMP cmpU64
+#define K_MAP_SWISS
+#define K_MAP_INCREMENTAL
+#include "klib/MapGen-inl.h"
+
+#define K_NAME IncSvToInt
+#define K_KEY_T k_StringView
+#define K_VALUE_T int
+#define K_FN_HASH k_StringViewHash
+#define K_FN_KEY_CMP k_StringViewCmp
+#define K_MAP_INCREMENTAL
+#include "klib/MapGen-inl.h"
+
+#define K_NAME IncSwissSvToInt
+#define K_KEY_T k_StringView
+#define K_VALUE_T int
+#define K_FN_HASH k_StringViewHash
+#define K_FN_KEY_CMP k_StringViewCmp
+#define K_MAP_SWISS
+#define K_MAP_INCREMENTAL
+#include "klib/MapGen-inl.h"
+
+#define K_NAME SeededSvToInt
+#define K_KEY_T k_StringView
+#define K_VALUE_T int
+#define K_FN_HASH k_StringViewHashSeeded
+#define K_FN_KEY_CMP k_StringViewCmp
+#define K_MAP_SEEDED
+#include "klib/MapGen-inl.h"
+
+#include "klib/time.h"
+#include "klib/file.h"
+
+#include <assert.h>
+#include <stdio.h>
+
 static ssize_t
 PMapSvToIntFormatter(k_print_Context* pCtx, k_print_FmtArgs* pFmtArgs, void* arg)
 {
@@ -38,6 +147,481 @@ PMapSvToIntFormatter(k_print_Context* pCtx, k_print_FmtArgs* pFmtArgs, void* arg
     return n;
 }
 
+/* Constant insert/remove churn on a small key range: without tombstones the tables stay at their initial size. */
+static void
+testChurn(k_IAllocator* pAlloc)
+{
+    enum { N_KEYS = 1000, N_OPS = 500000, N_FILL = 880 };
+
+    static char aKeys[N_KEYS][16];
+    static k_StringView aSvs[N_KEYS];
+    static bool aBPresent[N_KEYS];
+    for (int i = 0; i < N_KEYS; ++i)
+        aSvs[i] = (k_StringView){aKeys[i], k_print_toBuffer(aKeys[i], sizeof(aKeys[i]), "s{i}", i)};
+
+    MapSvToInt mLinear = MapSvToIntCreate(pAlloc, N_KEYS * 2);
+    SwissSvToInt mSwiss = SwissSvToIntCreate(pAlloc, N_KEYS * 2);
+    const ssize_t linearCap = mLinear.cap, swissCap = mSwiss.cap;
+
+    uint64_t rng = 0x9e3779b97f4a7c15LLU;
+    for (int op = 0; op < N_OPS; ++op)
+    {
+        rng ^= rng << 13, rng ^= rng >> 7, rng ^= rng << 17;
+        const int i = (int)(rng % N_KEYS);
+        if (aBPresent[i])
+        {
+            MapSvToIntRemove(&mLinear, &aSvs[i]);
+            SwissSvToIntRemove(&mSwiss, &aSvs[i]);
+        }
+        else
+        {
+            MapSvToIntInsert(&mLinear, pAlloc, &aSvs[i], &i);
+            SwissSvToIntInsert(&mSwiss, pAlloc, &aSvs[i], &i);
+        }
+        aBPresent[i] = !aBPresent[i];
+    }
+
+    for (int i = 0; i < N_KEYS; ++i)
+    {
+        assert((MapSvToIntSearch(&mLinear, &aSvs[i]).eStatus == K_MAP_RESULT_STATUS_FOUND) == aBPresent[i]);
+        assert((SwissSvToIntSearch(&mSwiss, &aSvs[i]).eStatus == K_MAP_RESULT_STATUS_FOUND) == aBPresent[i]);
+    }
+    assert(mLinear.cap == linearCap && mSwiss.cap == swissCap);
+
+    k_print(pAlloc, stdout, "churn: {sz} live keys, swiss tombstones: {sz}\n", mSwiss.size, mSwiss.nDeleted);
+
+    /* Nearly full swiss table: removals leave tombstones, refilling purges them in place. */
+    SwissSvToInt mFull = SwissSvToIntCreate(pAlloc, N_KEYS);
+    const ssize_t fullCap = mFull.cap;
+    for (int i = 0; i < N_FILL; ++i) SwissSvToIntInsert(&mFull, pAlloc, &aSvs[i], &i);
+    for (int i = 0; i < N_FILL - 100; ++i) SwissSvToIntRemove(&mFull, &aSvs[i]);
+    const ssize_t nTombstones = mFull.nDeleted;
+    for (int i = 0; i < N_FILL - 100; ++i) SwissSvToIntInsert(&mFull, pAlloc, &aSvs[(i + N_FILL) % N_KEYS], &i);
+    for (int i = 0; i < N_KEYS; ++i)
+    {
+        const bool bPresent = i >= N_FILL - 100 || i < (2 * N_FILL - 100) % N_KEYS;
+        assert((SwissSvToIntSearch(&mFull, &aSvs[i]).eStatus == K_MAP_RESULT_STATUS_FOUND) == bPresent);
+    }
+    assert(mFull.cap == fullCap);
+    k_print(pAlloc, stdout, "refill: tombstones before: {sz}, after: {sz}\n", nTombstones, mFull.nDeleted);
+    SwissSvToIntDestroy(&mFull, pAlloc);
+
+    SwissSvToIntDestroy(&mSwiss, pAlloc);
+    MapSvToIntDestroy(&mLinear, pAlloc);
+}
+
+/* Same keys through both probing modes: checks the swiss mode against linear probing and compares memory and time. */
+static void
+benchSwiss(k_IAllocator* pAlloc)
+{
+    enum { N_KEYS = 200000 };
+
+    char (*aKeys)[16] = k_IAllocatorMalloc(pAlloc, sizeof(*aKeys) * N_KEYS);
+    k_StringView* aSvs = K_IMALLOC_T(pAlloc, k_StringView, N_KEYS);
+    for (int i = 0; i < N_KEYS; ++i)
+    {
+        const ssize_t n = k_print_toBuffer(aKeys[i], sizeof(aKeys[i]), "key{i}", i);
+        aSvs[i] = (k_StringView){aKeys[i], n};
+    }
+
+    MapSvToInt mLinear = {0};
+    SwissSvToInt mSwiss = {0};
+
+    k_time_Type t0 = k_time_now();
+    for (int i = 0; i < N_KEYS; ++i) MapSvToIntInsert(&mLinear, pAlloc, &aSvs[i], &i);
+    for (int i = 0; i < N_KEYS; i += 2) MapSvToIntRemove(&mLinear, &aSvs[i]);
+    int64_t sumLinear = 0;
+    for (int i = 0; i < N_KEYS; ++i)
+    {
+        MapSvToIntResult r = MapSvToIntSearch(&mLinear, &aSvs[i]);
+        if (r.eStatus == K_MAP_RESULT_STATUS_FOUND) sumLinear += r.pBucket->value;
+    }
+    k_time_Type t1 = k_time_now();
+    for (int i = 0; i < N_KEYS; ++i) SwissSvToIntInsert(&mSwiss, pAlloc, &aSvs[i], &i);
+    for (int i = 0; i < N_KEYS; i += 2) SwissSvToIntRemove(&mSwiss, &aSvs[i]);
+    int64_t sumSwiss = 0;
+    for (int i = 0; i < N_KEYS; ++i)
+    {
+        SwissSvToIntResult r = SwissSvToIntSearch(&mSwiss, &aSvs[i]);
+        if (r.eStatus == K_MAP_RESULT_STATUS_FOUND) sumSwiss += r.pBucket->value;
+    }
+    k_time_Type t2 = k_time_now();
+
+    assert(sumLinear == sumSwiss && mLinear.size == mSwiss.size && mSwiss.size == N_KEYS / 2);
+
+    ssize_t nIterated = 0;
+    for (ssize_t i = SwissSvToIntFirstI(&mSwiss); i != SwissSvToIntEndI(&mSwiss); i = SwissSvToIntNextI(&mSwiss, i))
+    {
+        assert(mSwiss.pBuckets[i].value % 2 == 1);
+        ++nIterated;
+    }
+    assert(nIterated == mSwiss.size);
+
+    k_print(pAlloc, stdout, "linear: {:.3:d} ms, {sz} KiB; swiss: {:.3:d} ms, {sz} KiB\n",
+        k_time_diffMSec(t1, t0), mLinear.cap * (ssize_t)(sizeof(MapSvToIntBucket) + 1) / K_SIZE_1K,
+        k_time_diffMSec(t2, t1), mSwiss.cap * (ssize_t)(sizeof(SwissSvToIntBucket) + 1) / K_SIZE_1K
+    );
+
+    SwissSvToIntDestroy(&mSwiss, pAlloc);
+    MapSvToIntDestroy(&mLinear, pAlloc);
+    k_IAllocatorFree(pAlloc, aSvs);
+    k_IAllocatorFree(pAlloc, aKeys);
+}
+
+/* Worst single insert: a regular map rehashes everything at once, incremental maps spread it over later inserts. */
+static void
+benchIncremental(k_IAllocator* pAlloc)
+{
+    enum { N_KEYS = 500000 };
+
+    char (*aKeys)[16] = k_IAllocatorMalloc(pAlloc, sizeof(*aKeys) * N_KEYS);
+    k_StringView* aSvs = K_IMALLOC_T(pAlloc, k_StringView, N_KEYS);
+    for (int i = 0; i < N_KEYS; ++i)
+        aSvs[i] = (k_StringView){aKeys[i], k_print_toBuffer(aKeys[i], sizeof(aKeys[i]), "key{i}", i)};
+
+    MapSvToInt mRegular = {0};
+    IncSvToInt mInc = {0};
+    IncSwissSvToInt mIncSwiss = {0};
+    k_time_Type maxRegular = 0, maxInc = 0, maxIncSwiss = 0;
+
+    for (int i = 0; i < N_KEYS; ++i)
+    {
+        k_time_Type t0 = k_time_now();
+        MapSvToIntInsert(&mRegular, pAlloc, &aSvs[i], &i);
+        k_time_Type t1 = k_time_now();
+        IncSvToIntInsert(&mInc, pAlloc, &aSvs[i], &i);
+        k_time_Type t2 = k_time_now();
+        IncSwissSvToIntInsert(&mIncSwiss, pAlloc, &aSvs[i], &i);
+        k_time_Type t3 = k_time_now();
+
+        maxRegular = K_MAX(maxRegular, t1 - t0);
+        maxInc = K_MAX(maxInc, t2 - t1);
+        maxIncSwiss = K_MAX(maxIncSwiss, t3 - t2);
+
+        /* Overwrite and remove while old buckets are still waiting to migrate. */
+        if (i % 7 == 0)
+        {
+            const int j = i / 2, neg = -j;
+            IncSvToIntInsert(&mInc, pAlloc, &aSvs[j], &neg);
+            IncSwissSvToIntInsert(&mIncSwiss, pAlloc, &aSvs[j], &neg);
+        }
+        if (i % 5 == 0)
+        {
+            IncSvToIntRemove(&mInc, &aSvs[i / 3]);
+            IncSwissSvToIntRemove(&mIncSwiss, &aSvs[i / 3]);
+        }
+    }
+
+    for (int i = 0; i < N_KEYS; ++i)
+    {
+        IncSvToIntResult r = IncSvToIntSearch(&mInc, &aSvs[i]);
+        IncSwissSvToIntResult rSwiss = IncSwissSvToIntSearch(&mIncSwiss, &aSvs[i]);
+        assert(r.eStatus == rSwiss.eStatus);
+        if (r.eStatus == K_MAP_RESULT_STATUS_FOUND)
+            assert(r.pBucket->value == rSwiss.pBucket->value && (r.pBucket->value == i || r.pBucket->value == -i));
+    }
+    assert(mInc.size == mIncSwiss.size);
+
+    ssize_t nIterated = 0;
+    for (ssize_t i = IncSvToIntFirstI(&mInc); i != IncSvToIntEndI(&mInc); i = IncSvToIntNextI(&mInc, i))
+        ++nIterated;
+    assert(nIterated == mInc.size);
+
+    k_print(pAlloc, stdout, "max insert: regular: {:.3:d} ms, incremental: {:.3:d} ms, incremental swiss: {:.3:d} ms\n",
+        k_time_diffMSec(maxRegular, 0), k_time_diffMSec(maxInc, 0), k_time_diffMSec(maxIncSwiss, 0)
+    );
+
+    IncSwissSvToIntDestroy(&mIncSwiss, pAlloc);
+    IncSvToIntDestroy(&mInc, pAlloc);
+    MapSvToIntDestroy(&mRegular, pAlloc);
+    k_IAllocatorFree(pAlloc, aSvs);
+    k_IAllocatorFree(pAlloc, aKeys);
+}
+
+/* Growth from 8 buckets: without stored hashes every rehash hashes every key again. */
+static void
+testStoreHash(k_IAllocator* pAlloc)
+{
+    enum { N_KEYS = 100000 };
+
+    char (*aKeys)[16] = k_IAllocatorMalloc(pAlloc, sizeof(*aKeys) * N_KEYS);
+    k_StringView* aSvs = K_IMALLOC_T(pAlloc, k_StringView, N_KEYS);
+    for (int i = 0; i < N_KEYS; ++i)
+        aSvs[i] = (k_StringView){aKeys[i], k_print_toBuffer(aKeys[i], sizeof(aKeys[i]), "key{i}", i)};
+
+    CountedSvToInt mCounted = {0};
+    StoredSvToInt mStored = {0};
+    StoredSwissSvToInt mStoredSwiss = {0};
+
+    s_nHashCalls = 0;
+    for (int i = 0; i < N_KEYS; ++i) CountedSvToIntInsert(&mCounted, pAlloc, &aSvs[i], &i);
+    const ssize_t nCounted = s_nHashCalls;
+
+    s_nHashCalls = 0;
+    for (int i = 0; i < N_KEYS; ++i) StoredSvToIntInsert(&mStored, pAlloc, &aSvs[i], &i);
+    for (int i = 0; i < N_KEYS; i += 3) StoredSvToIntRemove(&mStored, &aSvs[i]);
+    const ssize_t nStored = s_nHashCalls;
+
+    s_nHashCalls = 0;
+    for (int i = 0; i < N_KEYS; ++i) StoredSwissSvToIntInsert(&mStoredSwiss, pAlloc, &aSvs[i], &i);
+    for (int i = 0; i < N_KEYS; i += 3) StoredSwissSvToIntRemove(&mStoredSwiss, &aSvs[i]);
+    const ssize_t nStoredSwiss = s_nHashCalls;
+
+    /* One hash per insert and remove, none from growth or backward shifts. */
+    assert(nStored == N_KEYS + (N_KEYS + 2) / 3 && nStoredSwiss == nStored);
+    for (int i = 0; i < N_KEYS; ++i)
+    {
+        StoredSvToIntResult r = StoredSvToIntSearch(&mStored, &aSvs[i]);
+        StoredSwissSvToIntResult rSwiss = StoredSwissSvToIntSearch(&mStoredSwiss, &aSvs[i]);
+        assert(r.eStatus == rSwiss.eStatus && (r.eStatus == K_MAP_RESULT_STATUS_FOUND) == (i % 3 != 0));
+        if (r.eStatus == K_MAP_RESULT_STATUS_FOUND)
+            assert(r.pBucket->value == i && r.pBucket->hash == k_StringViewHash(&aSvs[i]));
+    }
+
+    k_print(pAlloc, stdout, "hash calls for {i} inserts: {sz}, with K_MAP_STORE_HASH: {sz}\n", N_KEYS, nCounted, nStored - (N_KEYS + 2) / 3);
+
+    StoredSwissSvToIntDestroy(&mStoredSwiss, pAlloc);
+    StoredSvToIntDestroy(&mStored, pAlloc);
+    CountedSvToIntDestroy(&mCounted, pAlloc);
+    k_IAllocatorFree(pAlloc, aSvs);
+    k_IAllocatorFree(pAlloc, aKeys);
+}
+
+/* Random lookups into tables much bigger than the cache: one at a time vs SearchBatch. */
+static void
+benchSearchBatch(k_IAllocator* pAlloc)
+{
+    enum { N_KEYS = 1 << 20, N_LOOKUPS = 1 << 21, BATCH = 1024 };
+
+    MapU64 mLinear = MapU64Create(pAlloc, N_KEYS * 2);
+    SwissU64 mSwiss = SwissU64Create(pAlloc, N_KEYS);
+    for (uint64_t i = 0; i < N_KEYS; ++i)
+    {
+        const uint64_t key = i * 2, val = i;
+        MapU64Insert(&mLinear, pAlloc, &key, &val);
+        SwissU64Insert(&mSwiss, pAlloc, &key, &val);
+    }
+
+    /* Odd keys miss. */
+    uint64_t* aKeys = K_IMALLOC_T(pAlloc, uint64_t, BATCH);
+    MapU64Result* aLinearRes = K_IMALLOC_T(pAlloc, MapU64Result, BATCH);
+    SwissU64Result* aSwissRes = K_IMALLOC_T(pAlloc, SwissU64Result, BATCH);
+
+    uint64_t rng = 0x9e3779b97f4a7c15LLU;
+    uint64_t aSums[4] = {0};
+    double aMs[4] = {0};
+
+    for (ssize_t round = 0; round < N_LOOKUPS / BATCH; ++round)
+    {
+        for (ssize_t i = 0; i < BATCH; ++i)
+        {
+            rng ^= rng << 13, rng ^= rng >> 7, rng ^= rng << 17;
+            aKeys[i] = rng % (N_KEYS * 2);
+        }
+
+        k_time_Type t0 = k_time_now();
+        for (ssize_t i = 0; i < BATCH; ++i)
+        {
+            MapU64Result r = MapU64Search(&mLinear, &aKeys[i]);
+            if (r.eStatus == K_MAP_RESULT_STATUS_FOUND) aSums[0] += r.pBucket->value;
+        }
+        k_time_Type t1 = k_time_now();
+        const ssize_t nFoundLinear = MapU64SearchBatch(&mLinear, aKeys, BATCH, aLinearRes);
+        for (ssize_t i = 0; i < BATCH; ++i)
+            if (aLinearRes[i].eStatus == K_MAP_RESULT_STATUS_FOUND) aSums[1] += aLinearRes[i].pBucket->value;
+        k_time_Type t2 = k_time_now();
+        for (ssize_t i = 0; i < BATCH; ++i)
+        {
+            SwissU64Result r = SwissU64Search(&mSwiss, &aKeys[i]);
+            if (r.eStatus == K_MAP_RESULT_STATUS_FOUND) aSums[2] += r.pBucket->value;
+        }
+        k_time_Type t3 = k_time_now();
+        const ssize_t nFoundSwiss = SwissU64SearchBatch(&mSwiss, aKeys, BATCH, aSwissRes);
+        for (ssize_t i = 0; i < BATCH; ++i)
+            if (aSwissRes[i].eStatus == K_MAP_RESULT_STATUS_FOUND) aSums[3] += aSwissRes[i].pBucket->value;
+        k_time_Type t4 = k_time_now();
+
+        assert(nFoundLinear == nFoundSwiss);
+        aMs[0] += k_time_diffMSec(t1, t0);
+        aMs[1] += k_time_diffMSec(t2, t1);
+        aMs[2] += k_time_diffMSec(t3, t2);
+        aMs[3] += k_time_diffMSec(t4, t3);
+    }
+
+    assert(aSums[0] == aSums[1] && aSums[1] == aSums[2] && aSums[2] == aSums[3]);
+    /* Print the sums so the loops aren't dead code without asserts. */
+    k_print(pAlloc, stdout, "{i} lookups: linear: {:.3:d} ms, batched: {:.3:d} ms; swiss: {:.3:d} ms, batched: {:.3:d} ms (checksum {u64})\n",
+        N_LOOKUPS, aMs[0], aMs[1], aMs[2], aMs[3], aSums[0] + aSums[1] + aSums[2] + aSums[3]
+    );
+
+    k_IAllocatorFree(pAlloc, aSwissRes);
+    k_IAllocatorFree(pAlloc, aLinearRes);
+    k_IAllocatorFree(pAlloc, aKeys);
+    SwissU64Destroy(&mSwiss, pAlloc);
+    MapU64Destroy(&mLinear, pAlloc);
+}
+
+/* Startup cost of a big table: re-inserting everything vs mapping a snapshot. */
+static void
+benchSnapshot(k_IAllocator* pAlloc)
+{
+    enum { N_KEYS = 1 << 20 };
+    const char* ntsPath = "Map.snapshot";
+
+    k_time_Type t0 = k_time_now();
+    SwissU64 mSwiss = SwissU64Create(pAlloc, 8);
+    for (uint64_t i = 0; i < N_KEYS; ++i)
+        SwissU64Insert(&mSwiss, pAlloc, &i, &(uint64_t){i * 3});
+    const double msRebuild = k_time_diffMSec(k_time_now(), t0);
+
+    /* Leave tombstones in. */
+    for (uint64_t i = 0; i < N_KEYS; i += 4)
+        SwissU64Remove(&mSwiss, &i);
+
+    k_Span spOut = {.size = SwissU64SerializedSize(&mSwiss)};
+    spOut.pData = k_IAllocatorMalloc(pAlloc, spOut.size);
+    const bool bSaved = spOut.pData && SwissU64Serialize(&mSwiss, spOut) && k_file_save(ntsPath, spOut);
+    assert(bSaved);
+    k_IAllocatorFree(pAlloc, spOut.pData);
+    (void)bSaved;
+
+    t0 = k_time_now();
+    k_Span spFile = k_file_map(ntsPath);
+    SwissU64 mView;
+    const bool bLoaded = SwissU64LoadView(&mView, spFile);
+    const double msLoad = k_time_diffMSec(k_time_now(), t0);
+    assert(bLoaded && mView.size == mSwiss.size);
+    (void)bLoaded;
+
+    t0 = k_time_now();
+    for (uint64_t i = 0; i < N_KEYS; ++i)
+    {
+        SwissU64Result r = SwissU64Search(&mView, &i);
+        assert((r.eStatus == K_MAP_RESULT_STATUS_FOUND) == (i % 4 != 0));
+        assert(r.eStatus != K_MAP_RESULT_STATUS_FOUND || r.pBucket->value == i * 3);
+        (void)r;
+    }
+    const double msFirstPass = k_time_diffMSec(k_time_now(), t0);
+
+    /* Wrong layout is refused. */
+    MapU64 mWrong;
+    const bool bWrong = MapU64LoadView(&mWrong, spFile);
+    assert(!bWrong);
+    (void)bWrong;
+
+    k_file_unmap(spFile);
+
+    /* Snapshot taken in the middle of an incremental migration. */
+    IncSwissU64 mInc = {0};
+    ssize_t nInserted = 0;
+    for (uint64_t i = 0; ; ++i, ++nInserted)
+    {
+        IncSwissU64Insert(&mInc, pAlloc, &i, &i);
+        if (nInserted > 1000 && mInc.oldSize > 0) break;
+    }
+
+    spOut = (k_Span){.size = IncSwissU64SerializedSize(&mInc)};
+    spOut.pData = k_IAllocatorMalloc(pAlloc, spOut.size);
+    IncSwissU64 mIncView;
+    const bool bIncOk = spOut.pData && IncSwissU64Serialize(&mInc, spOut) && IncSwissU64LoadView(&mIncView, spOut);
+    assert(bIncOk && mInc.oldSize > 0 && mIncView.size == mInc.size);
+    for (uint64_t i = 0; i <= (uint64_t)nInserted; ++i)
+    {
+        IncSwissU64Result r = IncSwissU64Search(&mIncView, &i);
+        assert(r.eStatus == K_MAP_RESULT_STATUS_FOUND && r.pBucket->value == i);
+        (void)r;
+    }
+    (void)bIncOk;
+
+    k_print(pAlloc, stdout, "{i} keys: rebuild: {:.3:d} ms, map snapshot: {:.3:d} ms (+ {:.3:d} ms first lookup pass)\n",
+        N_KEYS, msRebuild, msLoad, msFirstPass
+    );
+
+    k_IAllocatorFree(pAlloc, spOut.pData);
+    IncSwissU64Destroy(&mInc, pAlloc);
+    SwissU64Destroy(&mSwiss, pAlloc);
+    remove(ntsPath);
+}
+
+/* Hash flooding: keys picked offline so that the unseeded hash has the low bits zero all pile up in one probe chain.
+ * A seeded map spreads the same keys normally. */
+static void
+benchFlooding(k_IAllocator* pAlloc)
+{
+    enum { N_KEYS = 3000, LOW_BITS_MASK = (1 << 13) - 1 };
+
+    char (*aKeys)[24] = k_IAllocatorMalloc(pAlloc, sizeof(*aKeys) * N_KEYS);
+    k_StringView* aSvs = K_IMALLOC_T(pAlloc, k_StringView, N_KEYS);
+    int nKeys = 0;
+    for (int64_t i = 0; nKeys < N_KEYS; ++i)
+    {
+        const ssize_t n = k_print_toBuffer(aKeys[nKeys], sizeof(aKeys[nKeys]), "user{i64}", i);
+        aSvs[nKeys] = (k_StringView){aKeys[nKeys], n};
+        if ((k_StringViewHash(&aSvs[nKeys]) & LOW_BITS_MASK) == 0) ++nKeys;
+    }
+
+    MapSvToInt mPlain = {0};
+    SeededSvToInt mSeeded = {0};
+
+    k_time_Type t0 = k_time_now();
+    for (int i = 0; i < N_KEYS; ++i) MapSvToIntInsert(&mPlain, pAlloc, &aSvs[i], &i);
+    k_time_Type t1 = k_time_now();
+    for (int i = 0; i < N_KEYS; ++i) SeededSvToIntInsert(&mSeeded, pAlloc, &aSvs[i], &i);
+    k_time_Type t2 = k_time_now();
+
+    /* Longest run of occupied buckets, that's what a miss has to walk. */
+    ssize_t maxRunPlain = 0, maxRunSeeded = 0;
+    for (ssize_t i = 0, run = 0; i < mPlain.cap; ++i)
+    {
+        run = MapSvToIntFlags(&mPlain)[i] == K_MAP_BUCKET_FLAG_OCCUPIED ? run + 1 : 0;
+        maxRunPlain = K_MAX(maxRunPlain, run);
+    }
+    for (ssize_t i = 0, run = 0; i < mSeeded.cap; ++i)
+    {
+        run = SeededSvToIntFlags(&mSeeded)[i] == K_MAP_BUCKET_FLAG_OCCUPIED ? run + 1 : 0;
+        maxRunSeeded = K_MAX(maxRunSeeded, run);
+    }
+
+    assert(mPlain.size == N_KEYS && mSeeded.size == N_KEYS);
+    for (int i = 0; i < N_KEYS; ++i)
+    {
+        SeededSvToIntResult r = SeededSvToIntSearch(&mSeeded, &aSvs[i]);
+        assert(r.eStatus == K_MAP_RESULT_STATUS_FOUND && r.pBucket->value == i);
+        (void)r;
+    }
+
+    /* First key of a {0} map is hashed with the seed Init() picks. */
+    SeededSvToInt mLazy = {0};
+    SeededSvToIntInsert(&mLazy, pAlloc, &K_SV("hello"), &(int){1});
+    assert(SeededSvToIntSearch(&mLazy, &K_SV("hello")).eStatus == K_MAP_RESULT_STATUS_FOUND);
+    SeededSvToIntDestroy(&mLazy, pAlloc);
+    SeededSvToIntTryInsert(&mLazy, pAlloc, &K_SV("hello"), &(int){2});
+    assert(SeededSvToIntSearch(&mLazy, &K_SV("hello")).eStatus == K_MAP_RESULT_STATUS_FOUND);
+    SeededSvToIntDestroy(&mLazy, pAlloc);
+
+    /* Fresh maps get different seeds. */
+    SeededSvToInt mOther = SeededSvToIntCreate(pAlloc, 8);
+    assert(mOther.seed != mSeeded.seed);
+
+    /* Clone keeps the seed, the copied buckets stay findable. */
+    SeededSvToInt mClone = {0};
+    const bool bCloned = SeededSvToIntClone(&mSeeded, pAlloc, &mClone);
+    assert(bCloned && mClone.seed == mSeeded.seed);
+    assert(SeededSvToIntSearch(&mClone, &aSvs[N_KEYS - 1]).eStatus == K_MAP_RESULT_STATUS_FOUND);
+    (void)bCloned;
+
+    k_print(pAlloc, stdout, "flooding {i} keys: unseeded: {:.3:d} ms, longest run {sz}; seeded: {:.3:d} ms, longest run {sz}\n",
+        N_KEYS, k_time_diffMSec(t1, t0), maxRunPlain, k_time_diffMSec(t2, t1), maxRunSeeded
+    );
+
+    SeededSvToIntDestroy(&mClone, pAlloc);
+    SeededSvToIntDestroy(&mOther, pAlloc);
+    SeededSvToIntDestroy(&mSeeded, pAlloc);
+    MapSvToIntDestroy(&mPlain, pAlloc);
+    k_IAllocatorFree(pAlloc, aSvs);
+    k_IAllocatorFree(pAlloc, aKeys);
+}
+
 int
 main(void)
 {
@@ -70,4 +654,12 @@ main(void)
 
         k_print(&k_GpaInst()->base, stdout, "map: {PMapSvToInt}\n", &m);
     }
+
+    testChurn(&pGpa->base);
+    benchSwiss(&pGpa->base);
+    benchIncremental(&pGpa->base);
+    testStoreHash(&pGpa->base);
+    benchSearchBatch(&pGpa->base);
+    benchSnapshot(&pGpa->base);
+    benchFlooding(&pGpa->base);
 }
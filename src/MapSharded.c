@@ -0,0 +1,242 @@
+#include "klib/Gpa.h"
+#include "klib/print.h"
+#include "klib/time.h"
+#include "klib/ThreadPool.h"
+
+#define K_NAME MapSvToInt
+#define K_KEY_T k_StringView
+#define K_VALUE_T int
+#define K_FN_HASH k_StringViewHash
+#define K_FN_KEY_CMP k_StringViewCmp
+#include "klib/MapGen-inl.h"
+
+#define K_NAME ShardedSvToInt
+#define K_MAP MapSvToInt
+#define K_KEY_T k_StringView
+#define K_VALUE_T int
+#define K_FN_HASH k_StringViewHash
+#include "klib/MapShardedGen-inl.h"
+
+#define K_NAME SeededSvToInt
+#define K_KEY_T k_StringView
+#define K_VALUE_T int
+#define K_FN_HASH k_StringViewHashSeeded
+#define K_FN_KEY_CMP k_StringViewCmp
+#define K_MAP_SEEDED
+#include "klib/MapGen-inl.h"
+
+#define K_NAME ShardedSeededSvToInt
+#define K_MAP SeededSvToInt
+#define K_KEY_T k_StringView
+#define K_VALUE_T int
+#define K_FN_HASH k_StringViewHashSeeded
+#define K_MAP_SEEDED
+#include "klib/MapShardedGen-inl.h"
+
+#include <assert.h>
+
+enum { N_KEYS = 1 << 16, N_LOOKUPS = 1 << 20, N_MAX_THREADS = 64, BATCH = 256 };
+
+typedef enum MODE
+{
+    MODE_SINGLE_MUTEX,
+    MODE_SHARDED,
+    MODE_SHARDED_BATCH,
+} MODE;
+
+typedef struct Shared
+{
+    k_StringView* aSvs;
+    MapSvToInt mSingle;
+    k_Mutex mtxSingle;
+    ShardedSvToInt mSharded;
+    MODE eMode;
+    ssize_t nThreads;
+} Shared;
+
+typedef struct Worker
+{
+    Shared* pShared;
+    ssize_t id;
+    int64_t sum;
+} Worker;
+
+static K_THREAD_RESULT
+insertSlice(void* p)
+{
+    Worker* pWorker = p;
+    Shared* pS = pWorker->pShared;
+    const ssize_t sliceSize = N_KEYS / pS->nThreads;
+    const ssize_t off = pWorker->id * sliceSize;
+
+    int aVals[BATCH];
+    for (ssize_t i = 0; i < sliceSize; i += BATCH)
+    {
+        const ssize_t n = K_MIN(BATCH, sliceSize - i);
+        for (ssize_t j = 0; j < n; ++j) aVals[j] = (int)(off + i + j);
+        if (!ShardedSvToIntInsertMany(&pS->mSharded, &k_GpaInst()->base, pS->aSvs + off + i, aVals, n))
+            return K_THREAD_FAIL;
+    }
+
+    return 0;
+}
+
+static K_THREAD_RESULT
+lookup(void* p)
+{
+    Worker* pWorker = p;
+    Shared* pS = pWorker->pShared;
+    uint64_t rng = 0x9e3779b97f4a7c15LLU * (uint64_t)(pWorker->id + 1);
+    int64_t sum = 0;
+
+    k_StringView aBatch[BATCH];
+    int aVals[BATCH];
+
+    for (ssize_t i = 0; i < N_LOOKUPS; i += BATCH)
+    {
+        for (ssize_t j = 0; j < BATCH; ++j)
+        {
+            rng ^= rng << 13, rng ^= rng >> 7, rng ^= rng << 17;
+            aBatch[j] = pS->aSvs[rng % N_KEYS];
+        }
+
+        switch (pS->eMode)
+        {
+            case MODE_SINGLE_MUTEX:
+            for (ssize_t j = 0; j < BATCH; ++j)
+            {
+                k_MutexLock(&pS->mtxSingle);
+                MapSvToIntResult r = MapSvToIntSearch(&pS->mSingle, &aBatch[j]);
+                if (r.eStatus == K_MAP_RESULT_STATUS_FOUND) sum += r.pBucket->value;
+                k_MutexUnlock(&pS->mtxSingle);
+            }
+            break;
+
+            case MODE_SHARDED:
+            for (ssize_t j = 0; j < BATCH; ++j)
+            {
+                int val;
+                if (ShardedSvToIntGet(&pS->mSharded, &aBatch[j], &val)) sum += val;
+            }
+            break;
+
+            case MODE_SHARDED_BATCH:
+            {
+                const ssize_t nFound = ShardedSvToIntGetMany(&pS->mSharded, aBatch, BATCH, aVals, NULL);
+                assert(nFound == BATCH);
+                for (ssize_t j = 0; j < BATCH; ++j) sum += aVals[j];
+            }
+            break;
+        }
+    }
+
+    pWorker->sum = sum;
+    return 0;
+}
+
+static double
+run(Shared* pS, k_ThreadFunc pfn, int64_t* pSum)
+{
+    k_Thread aThreads[N_MAX_THREADS];
+    Worker aWorkers[N_MAX_THREADS];
+
+    k_time_Type t0 = k_time_now();
+    for (ssize_t i = 0; i < pS->nThreads; ++i)
+    {
+        aWorkers[i] = (Worker){.pShared = pS, .id = i};
+        k_ThreadInit(&aThreads[i], pfn, &aWorkers[i]);
+    }
+
+    int64_t sum = 0;
+    for (ssize_t i = 0; i < pS->nThreads; ++i)
+    {
+        K_THREAD_RESULT res = k_ThreadJoin(&aThreads[i]);
+        assert(res == 0);
+        sum += aWorkers[i].sum;
+    }
+
+    if (pSum) *pSum = sum;
+    return k_time_diffMSec(k_time_now(), t0);
+}
+
+int
+main(void)
+{
+    k_IAllocator* pAlloc = &k_GpaInst()->base;
+
+    k_print_Map* pFormattersMap = k_print_MapAlloc(pAlloc);
+    if (!pFormattersMap) return 1;
+    k_print_MapSetGlobal(pFormattersMap);
+
+    Shared s = {0};
+    s.nThreads = k_NextPowerofTwo64(K_MIN(N_MAX_THREADS, k_optimalThreadCount() + 1));
+
+    char (*aKeys)[16] = k_IAllocatorMalloc(pAlloc, sizeof(*aKeys) * N_KEYS);
+    s.aSvs = K_IMALLOC_T(pAlloc, k_StringView, N_KEYS);
+    for (int i = 0; i < N_KEYS; ++i)
+        s.aSvs[i] = (k_StringView){aKeys[i], k_print_toBuffer(aKeys[i], sizeof(aKeys[i]), "key{i}", i)};
+
+    k_MutexInitPlain(&s.mtxSingle);
+    for (int i = 0; i < N_KEYS; ++i) MapSvToIntInsert(&s.mSingle, pAlloc, &s.aSvs[i], &i);
+
+    /* Shards fill concurrently, each thread inserts its own slice in batches. */
+    ShardedSvToIntInit(&s.mSharded, pAlloc, s.nThreads * 4, 0);
+    run(&s, insertSlice, NULL);
+    assert(ShardedSvToIntSize(&s.mSharded) == N_KEYS);
+    for (ssize_t i = 0; i < s.mSharded.nShards; ++i)
+        assert(s.mSharded.pShards[i].map.size > N_KEYS / s.mSharded.nShards / 2);
+    for (int i = 0; i < N_KEYS; ++i)
+    {
+        int val = -1;
+        bool bFound = ShardedSvToIntGet(&s.mSharded, &s.aSvs[i], &val);
+        assert(bFound && val == i);
+    }
+
+    bool bRemoved = ShardedSvToIntRemove(&s.mSharded, &s.aSvs[0]);
+    assert(bRemoved && !ShardedSvToIntGet(&s.mSharded, &s.aSvs[0], NULL));
+    K_MAP_RESULT_STATUS eStatus = ShardedSvToIntTryInsert(&s.mSharded, pAlloc, &s.aSvs[0], &(int){0});
+    assert(eStatus == K_MAP_RESULT_STATUS_INSERTED);
+    eStatus = ShardedSvToIntTryInsert(&s.mSharded, pAlloc, &s.aSvs[0], &(int){1});
+    assert(eStatus == K_MAP_RESULT_STATUS_FOUND);
+
+    /* Seeded shards: one seed for the whole map, hashed once per key. */
+    ShardedSeededSvToInt mSeeded = {0};
+    ShardedSeededSvToIntInit(&mSeeded, pAlloc, 8, N_KEYS);
+    int aVals[BATCH];
+    for (int i = 0; i < N_KEYS; i += BATCH)
+    {
+        for (int j = 0; j < BATCH; ++j) aVals[j] = i + j;
+        ShardedSeededSvToIntInsertMany(&mSeeded, pAlloc, &s.aSvs[i], aVals, BATCH);
+    }
+    assert(ShardedSeededSvToIntSize(&mSeeded) == N_KEYS);
+    for (ssize_t i = 0; i < mSeeded.nShards; ++i)
+        assert(mSeeded.pShards[i].map.seed == mSeeded.seed);
+    for (int i = 0; i < N_KEYS; ++i)
+    {
+        int val = -1;
+        bool bFound = ShardedSeededSvToIntGet(&mSeeded, &s.aSvs[i], &val);
+        assert(bFound && val == i);
+        (void)bFound;
+    }
+    ShardedSeededSvToIntDestroy(&mSeeded, pAlloc);
+
+    int64_t aSums[3];
+    s.eMode = MODE_SINGLE_MUTEX;
+    const double msSingle = run(&s, lookup, &aSums[0]);
+    s.eMode = MODE_SHARDED;
+    const double msSharded = run(&s, lookup, &aSums[1]);
+    s.eMode = MODE_SHARDED_BATCH;
+    const double msBatch = run(&s, lookup, &aSums[2]);
+    assert(aSums[0] == aSums[1] && aSums[1] == aSums[2]);
+
+    k_print(pAlloc, stdout, "{sz} threads, {i} lookups each: single mutex: {:.3:d} ms, {sz} shards: {:.3:d} ms, batched: {:.3:d} ms\n",
+        s.nThreads, N_LOOKUPS, msSingle, s.mSharded.nShards, msSharded, msBatch
+    );
+
+    ShardedSvToIntDestroy(&s.mSharded, pAlloc);
+    MapSvToIntDestroy(&s.mSingle, pAlloc);
+    k_MutexDestroy(&s.mtxSingle);
+    k_IAllocatorFree(pAlloc, s.aSvs);
+    k_IAllocatorFree(pAlloc, aKeys);
+    k_print_MapDealloc(&pFormattersMap);
+}
@@ -0,0 +1,165 @@
+#include "klib/Gpa.h"
+#include "klib/print.h"
+#include "klib/time.h"
+#include "klib/ThreadPool.h"
+
+#define K_NAME MapSvToInt
+#define K_KEY_T k_StringView
+#define K_VALUE_T int
+#define K_FN_HASH k_StringViewHash
+#define K_FN_KEY_CMP k_StringViewCmp
+#include "klib/MapGen-inl.h"
+
+#define K_NAME RcuSvToInt
+#define K_MAP MapSvToInt
+#define K_KEY_T k_StringView
+#define K_VALUE_T int
+#include "klib/RcuMapGen-inl.h"
+
+#include <assert.h>
+
+enum { N_ROUTES = 512, N_VERSIONS = 200, N_TASKS = 64, N_LOOKUPS = 20000 };
+
+static k_StringView s_aRoutes[N_ROUTES];
+static RcuSvToInt s_routes;
+static k_atomic_Int s_atomBStop;
+static k_atomic_Int s_atomNStarted;
+static k_atomic_Ssize s_atomNLookups;
+static k_atomic_Int s_atomNTornReads;
+
+static k_atomic_Int s_atomNFreed;
+
+static void
+countedFree(void* pAlloc, void* pMap)
+{
+    k_AtomicIntAddRelaxed(&s_atomNFreed, 1);
+    RcuSvToIntFreeTable(pAlloc, pMap);
+}
+
+/* Every version rewrites all routes with the version number: a snapshot must never mix two versions. */
+static void
+reader(void* pArg)
+{
+    uint64_t rng = (uint64_t)(ssize_t)pArg * 0x9e3779b97f4a7c15LLU + 1;
+    ssize_t nLookups = 0;
+
+    k_AtomicIntAddRelaxed(&s_atomNStarted, 1);
+    while (!k_AtomicIntLoadAcquire(&s_atomBStop) && nLookups < N_LOOKUPS * 16)
+    {
+        MapSvToInt* pSnapshot = RcuSvToIntRead(&s_routes);
+        int version = -1;
+        for (ssize_t i = 0; i < N_LOOKUPS / 100; ++i)
+        {
+            rng ^= rng << 13, rng ^= rng >> 7, rng ^= rng << 17;
+            MapSvToIntResult r = MapSvToIntSearch(pSnapshot, &s_aRoutes[rng % N_ROUTES]);
+            assert(r.eStatus == K_MAP_RESULT_STATUS_FOUND);
+            if (version == -1) version = r.pBucket->value;
+            else if (version != r.pBucket->value) k_AtomicIntAddRelaxed(&s_atomNTornReads, 1);
+        }
+        nLookups += N_LOOKUPS / 100;
+    }
+
+    k_AtomicSsizeFetchAddRelaxed(&s_atomNLookups, nLookups);
+}
+
+static bool
+setAll(MapSvToInt* pCopy, k_IAllocator* pAlloc, void* pUser)
+{
+    for (ssize_t i = MapSvToIntFirstI(pCopy); i != MapSvToIntEndI(pCopy); i = MapSvToIntNextI(pCopy, i))
+        pCopy->pBuckets[i].value = *(int*)pUser;
+
+    return true;
+}
+
+/* Publishes a copy while still holding a snapshot: the snapshot must survive k_EpochCollect(),
+ * also when the task is run by a thread stealing it in k_ThreadPoolWait(). */
+static void
+readDuringUpdate(void* pArg)
+{
+    k_Epoch* pEpoch = pArg;
+    MapSvToInt* pSnapshot = RcuSvToIntRead(&s_routes);
+
+    int version = N_VERSIONS + 1;
+    RcuSvToIntUpdate(&s_routes, setAll, &version);
+    k_EpochCollect(pEpoch);
+    assert(k_EpochPending(pEpoch) > 0);
+
+    MapSvToIntResult r = MapSvToIntSearch(pSnapshot, &s_aRoutes[0]);
+    assert(r.eStatus == K_MAP_RESULT_STATUS_FOUND && r.pBucket->value == N_VERSIONS);
+    (void)r;
+}
+
+int
+main(void)
+{
+    k_IAllocator* pAlloc = &k_GpaInst()->base;
+
+    k_print_Map* pFormattersMap = k_print_MapAlloc(pAlloc);
+    if (!pFormattersMap) return 1;
+    k_print_MapSetGlobal(pFormattersMap);
+
+    char (*aKeys)[24] = k_IAllocatorMalloc(pAlloc, sizeof(*aKeys) * N_ROUTES);
+    for (int i = 0; i < N_ROUTES; ++i)
+        s_aRoutes[i] = (k_StringView){aKeys[i], k_print_toBuffer(aKeys[i], sizeof(aKeys[i]), "/api/v1/route{i}", i)};
+
+    k_Epoch epoch;
+    if (!k_EpochInit(&epoch, pAlloc)) return 1;
+
+    int aVersions[N_ROUTES] = {0};
+    if (!RcuSvToIntInit(&s_routes, pAlloc, &epoch, N_ROUTES)) return 1;
+    RcuSvToIntInsertMany(&s_routes, s_aRoutes, aVersions, N_ROUTES);
+
+    const ssize_t nThreads = k_optimalThreadCount();
+    k_ThreadPool tp = {0};
+    if (!k_ThreadPoolInit(&tp, (k_ThreadPoolInitOpts){
+        .nThreads = nThreads,
+        .ringBufferSize = K_SIZE_1K*4,
+        .arenaReserve = K_SIZE_1M,
+        .pEpochOrNull = &epoch,
+    })) return 1;
+
+    for (ssize_t i = 0; i < N_TASKS; ++i)
+        k_ThreadPoolAddP(&tp, reader, (void*)i);
+
+    /* Publish while readers are running, not before the pool picks the tasks up. */
+    while (k_AtomicIntLoadRelaxed(&s_atomNStarted) < K_MIN(nThreads, N_TASKS))
+        k_ThreadYield();
+
+    /* This thread only writes and isn't registered with the epoch. */
+    k_time_Type t0 = k_time_now();
+    for (int v = 1; v <= N_VERSIONS; ++v)
+    {
+        for (int i = 0; i < N_ROUTES; ++i) aVersions[i] = v;
+        if (v % 2) RcuSvToIntInsertMany(&s_routes, s_aRoutes, aVersions, N_ROUTES);
+        else RcuSvToIntUpdate(&s_routes, setAll, &v);
+    }
+    const double msWrites = k_time_diffMSec(k_time_now(), t0);
+
+    k_AtomicIntStoreRelease(&s_atomBStop, 1);
+    k_ThreadPoolWait(&tp);
+
+    k_ThreadPoolAddP(&tp, readDuringUpdate, &epoch);
+    k_ThreadPoolWait(&tp);
+    k_EpochSynchronize(&epoch);
+    assert(k_EpochPending(&epoch) == 0);
+
+    /* Remove of an absent key doesn't publish a copy. */
+    const bool bRemoved = RcuSvToIntRemove(&s_routes, &K_SV("/missing"));
+    assert(!bRemoved && k_EpochPending(&epoch) == 0);
+
+    k_EpochRetire(&epoch, k_IAllocatorZalloc(pAlloc, sizeof(MapSvToInt)), countedFree, pAlloc);
+    k_EpochSynchronize(&epoch);
+    assert(k_AtomicIntLoadRelaxed(&s_atomNFreed) == 1);
+
+    k_print(pAlloc, stdout, "{i} versions published in {:.3:d} ms, {sz} lookups, torn reads: {i}\n",
+        N_VERSIONS, msWrites, k_AtomicSsizeLoadRelaxed(&s_atomNLookups), k_AtomicIntLoadRelaxed(&s_atomNTornReads)
+    );
+    assert(k_AtomicSsizeLoadRelaxed(&s_atomNLookups) > 0);
+    assert(k_AtomicIntLoadRelaxed(&s_atomNTornReads) == 0);
+
+    k_ThreadPoolDestroy(&tp);
+    RcuSvToIntDestroy(&s_routes);
+    k_EpochDestroy(&epoch);
+    k_IAllocatorFree(pAlloc, aKeys);
+    k_print_MapDealloc(&pFormattersMap);
+}
@@ -0,0 +1,135 @@
+#include "klib/Gpa.h"
+#include "klib/print.h"
+#include "klib/time.h"
+
+#define K_NAME SegVecInt
+#define K_TYPE int
+#define K_SEGVEC_FIRST_CAP 4
+#include "klib/SegVecGen-inl.h"
+
+typedef struct Record
+{
+    int64_t id;
+    uint8_t aPayload[248];
+} Record;
+
+#define K_NAME VecRecord
+#define K_TYPE Record
+#include "klib/VecGen-inl.h"
+
+#define K_NAME SegVecRecord
+#define K_TYPE Record
+#include "klib/SegVecGen-inl.h"
+
+#include <assert.h>
+
+enum { N_INTS = 100000, N_RECORDS = 1 << 18 };
+
+/* Indexing, pointers held across pushes, PushMany over segment boundaries and segment iteration. */
+static void
+testSegVec(k_IAllocator* pAlloc)
+{
+    SegVecInt v = {0};
+
+    SegVecIntPush(&v, pAlloc, &(int){0});
+    int* pFirst = SegVecIntGetP(&v, 0);
+
+    for (int i = 1; i < N_INTS / 2; ++i) SegVecIntPush(&v, pAlloc, &i);
+
+    int aMany[1000];
+    for (int i = N_INTS / 2; i < N_INTS; i += K_ASIZE(aMany))
+    {
+        for (int j = 0; j < (int)K_ASIZE(aMany); ++j) aMany[j] = i + j;
+        const ssize_t at = SegVecIntPushMany(&v, pAlloc, aMany, K_MIN((int)K_ASIZE(aMany), N_INTS - i));
+        assert(at == i);
+        (void)at;
+    }
+
+    assert(v.size == N_INTS);
+    assert(pFirst == SegVecIntGetP(&v, 0) && *pFirst == 0);
+    for (int i = 0; i < N_INTS; ++i) assert(SegVecIntGet(&v, i) == i);
+
+    ssize_t nSeen = 0;
+    for (int s = 0; s < v.nSegs; ++s)
+    {
+        ssize_t n;
+        const int* pSeg = SegVecIntSegment(&v, s, &n);
+        for (ssize_t i = 0; i < n; ++i) assert(pSeg[i] == nSeen + i);
+        nSeen += n;
+    }
+    assert(nSeen == N_INTS);
+
+    /* Pop keeps the memory, next pushes reuse it. */
+    const ssize_t capBefore = v.cap;
+    int* pLast = SegVecIntGetP(&v, N_INTS - 1);
+    assert(SegVecIntPop(&v) == pLast && *pLast == N_INTS - 1);
+    SegVecIntSet(&v, 0, &(int){-1});
+    SegVecIntPush(&v, pAlloc, &(int){7});
+    assert(pLast == SegVecIntGetP(&v, N_INTS - 1) && *pLast == 7 && v.cap == capBefore && *pFirst == -1);
+    (void)capBefore, (void)pLast;
+
+    k_print(pAlloc, stdout, "{i} ints: {i} segments, cap {sz}\n", N_INTS, v.nSegs, v.cap);
+
+    SegVecIntDestroy(&v, pAlloc);
+}
+
+/* Append only log of big records: worst single push with realloc doubling vs new segments. */
+static void
+benchAppend(k_IAllocator* pAlloc)
+{
+    Record rec = {0};
+    VecRecord vec = {0};
+    SegVecRecord seg = {0};
+    double maxVec = 0.0, maxSeg = 0.0;
+
+    k_time_Type t0 = k_time_now();
+    for (int64_t i = 0; i < N_RECORDS; ++i)
+    {
+        rec.id = i;
+        const k_time_Type tPush = k_time_now();
+        VecRecordPush(&vec, pAlloc, &rec);
+        maxVec = K_MAX(maxVec, k_time_diffMSec(k_time_now(), tPush));
+    }
+    k_time_Type t1 = k_time_now();
+    for (int64_t i = 0; i < N_RECORDS; ++i)
+    {
+        rec.id = i;
+        const k_time_Type tPush = k_time_now();
+        SegVecRecordPush(&seg, pAlloc, &rec);
+        maxSeg = K_MAX(maxSeg, k_time_diffMSec(k_time_now(), tPush));
+    }
+    k_time_Type t2 = k_time_now();
+
+    int64_t sumVec = 0, sumSeg = 0;
+    for (ssize_t i = 0; i < N_RECORDS; ++i) sumVec += VecRecordGetP(&vec, i)->id;
+    k_time_Type t3 = k_time_now();
+    for (ssize_t i = 0; i < N_RECORDS; ++i) sumSeg += SegVecRecordGetP(&seg, i)->id;
+    k_time_Type t4 = k_time_now();
+    assert(sumVec == sumSeg);
+
+    k_print(pAlloc, stdout,
+        "{i} records of {sz} bytes: VecGen: {:.3:d} ms (worst push {:.3:d} ms), SegVecGen: {:.3:d} ms (worst push {:.3:d} ms)\n",
+        N_RECORDS, (ssize_t)sizeof(Record), k_time_diffMSec(t1, t0), maxVec, k_time_diffMSec(t2, t1), maxSeg
+    );
+    k_print(pAlloc, stdout, "indexed scan: VecGen: {:.3:d} ms, SegVecGen: {:.3:d} ms (checksum {i64})\n",
+        k_time_diffMSec(t3, t2), k_time_diffMSec(t4, t3), sumVec + sumSeg
+    );
+
+    SegVecRecordDestroy(&seg, pAlloc);
+    VecRecordDestroy(&vec, pAlloc);
+}
+
+int
+main(void)
+{
+    k_Gpa* pGpa = k_GpaInst();
+
+    k_print_Map* pFormattersMap = k_print_MapAlloc(&pGpa->base);
+    if (!pFormattersMap) return 1;
+    k_print_MapSetGlobal(pFormattersMap);
+
+    testSegVec(&pGpa->base);
+    benchAppend(&pGpa->base);
+
+    k_print_MapDealloc(&pFormattersMap);
+}
@@ -0,0 +1,124 @@
+#include "klib/Gpa.h"
+#include "klib/print.h"
+#include "klib/time.h"
+
+static uint64_t
+hashU64(const uint64_t* p)
+{
+    const uint64_t x = *p * 0x9e3779b97f4a7c15LLU;
+    return x ^ (x >> 29);
+}
+
+static ssize_t
+cmpU64(const uint64_t* l, const uint64_t* r)
+{
+    return *l != *r;
+}
+
+#define K_NAME SetU64
+#define K_KEY_T uint64_t
+#define K_FN_HASH hashU64
+#define K_FN_KEY_CMP cmpU64
+#include "klib/SetGen-inl.h"
+
+#define K_NAME SwissSetU64
+#define K_KEY_T uint64_t
+#define K_FN_HASH hashU64
+#define K_FN_KEY_CMP cmpU64
+#define K_MAP_SWISS
+#include "klib/SetGen-inl.h"
+
+/* What we used to do: a map with a dummy value. */
+#define K_NAME MapU64ToBool
+#define K_KEY_T uint64_t
+#define K_VALUE_T bool
+#define K_FN_HASH hashU64
+#define K_FN_KEY_CMP cmpU64
+#include "klib/MapGen-inl.h"
+
+#include <assert.h>
+
+enum { N_STREAM = 1 << 20, N_DISTINCT = 1 << 16 };
+
+static void
+testAlgebra(k_IAllocator* pAlloc)
+{
+    /* Multiples of 2 and multiples of 3 below 3000. */
+    SwissSetU64 s2 = {0}, s3 = {0};
+    for (uint64_t i = 0; i < 3000; i += 2) SwissSetU64Insert(&s2, pAlloc, &i);
+    for (uint64_t i = 0; i < 3000; i += 3) SwissSetU64Insert(&s3, pAlloc, &i);
+
+    SwissSetU64 sInter, sDiff;
+    SwissSetU64Intersect(&sInter, pAlloc, &s2, &s3);
+    SwissSetU64Difference(&sDiff, pAlloc, &s2, &s3);
+    SwissSetU64UnionWith(&s2, pAlloc, &s3);
+
+    for (uint64_t i = 0; i < 3000; ++i)
+    {
+        assert((SwissSetU64Search(&sInter, &i).eStatus == K_MAP_RESULT_STATUS_FOUND) == (i % 6 == 0));
+        assert((SwissSetU64Search(&sDiff, &i).eStatus == K_MAP_RESULT_STATUS_FOUND) == (i % 2 == 0 && i % 3 != 0));
+        assert((SwissSetU64Search(&s2, &i).eStatus == K_MAP_RESULT_STATUS_FOUND) == (i % 2 == 0 || i % 3 == 0));
+    }
+    assert(sInter.size == 500 && sDiff.size == 1000 && s2.size == 2000);
+
+    k_print(pAlloc, stdout, "2|3: {sz}, 2&3: {sz}, 2-3: {sz}\n", s2.size, sInter.size, sDiff.size);
+
+    SwissSetU64Destroy(&sDiff, pAlloc);
+    SwissSetU64Destroy(&sInter, pAlloc);
+    SwissSetU64Destroy(&s3, pAlloc);
+    SwissSetU64Destroy(&s2, pAlloc);
+}
+
+/* Dedup a stream with lots of repeats. */
+static void
+benchDedup(k_IAllocator* pAlloc)
+{
+    uint64_t* aStream = K_IMALLOC_T(pAlloc, uint64_t, N_STREAM);
+    uint64_t rng = 0x9e3779b97f4a7c15LLU;
+    for (ssize_t i = 0; i < N_STREAM; ++i)
+    {
+        rng ^= rng << 13, rng ^= rng >> 7, rng ^= rng << 17;
+        aStream[i] = (rng % N_DISTINCT) * 0x100000001LLU;
+    }
+
+    MapU64ToBool mDummy = {0};
+    SetU64 set = {0};
+    SwissSetU64 swissSet = {0};
+
+    k_time_Type t0 = k_time_now();
+    for (ssize_t i = 0; i < N_STREAM; ++i) MapU64ToBoolTryInsert(&mDummy, pAlloc, &aStream[i], &(bool){true});
+    k_time_Type t1 = k_time_now();
+    for (ssize_t i = 0; i < N_STREAM; ++i) SetU64TryInsert(&set, pAlloc, &aStream[i]);
+    k_time_Type t2 = k_time_now();
+    for (ssize_t i = 0; i < N_STREAM; ++i) SwissSetU64TryInsert(&swissSet, pAlloc, &aStream[i]);
+    k_time_Type t3 = k_time_now();
+
+    assert(mDummy.size == set.size && set.size == swissSet.size);
+
+    k_print(pAlloc, stdout, "dedup {i} -> {sz}: map<u64, bool>: {:.3:d} ms, {sz} KiB; set: {:.3:d} ms, {sz} KiB; swiss set: {:.3:d} ms, {sz} KiB\n",
+        N_STREAM, set.size,
+        k_time_diffMSec(t1, t0), mDummy.cap * (ssize_t)(sizeof(MapU64ToBoolBucket) + 1) / K_SIZE_1K,
+        k_time_diffMSec(t2, t1), set.cap * (ssize_t)(sizeof(SetU64Bucket) + 1) / K_SIZE_1K,
+        k_time_diffMSec(t3, t2), swissSet.cap * (ssize_t)(sizeof(SwissSetU64Bucket) + 1) / K_SIZE_1K
+    );
+
+    SwissSetU64Destroy(&swissSet, pAlloc);
+    SetU64Destroy(&set, pAlloc);
+    MapU64ToBoolDestroy(&mDummy, pAlloc);
+    k_IAllocatorFree(pAlloc, aStream);
+}
+
+int
+main(void)
+{
+    k_IAllocator* pAlloc = &k_GpaInst()->base;
+
+    k_print_Map* pFormattersMap = k_print_MapAlloc(pAlloc);
+    if (!pFormattersMap) return 1;
+    k_print_MapSetGlobal(pFormattersMap);
+
+    testAlgebra(pAlloc);
+    benchDedup(pAlloc);
+
+    k_print_MapDealloc(&pFormattersMap);
+}
@@ -0,0 +1,99 @@
+#include "klib/Slab.h"
+#include "klib/Gpa.h"
+#include "klib/print.h"
+
+#include <assert.h>
+
+#define K_NAME VecInt
+#define K_TYPE int
+#include "klib/VecGen-inl.h"
+
+#define K_NAME MapSvToInt
+#define K_KEY_T k_StringView
+#define K_VALUE_T int
+#define K_FN_HASH k_StringViewHash
+#define K_FN_KEY_CMP k_StringViewCmp
+#include "klib/MapGen-inl.h"
+
+int
+main(void)
+{
+    k_Gpa* pGpa = k_GpaInst();
+
+    k_print_Map* pFormattersMap = k_print_MapAlloc(&pGpa->base);
+    if (!pFormattersMap) return 1;
+    k_print_MapSetGlobal(pFormattersMap);
+
+    k_Slab slab;
+    if (!k_SlabInit(&slab, &pGpa->base, K_SIZE_1M*60)) return 1;
+
+    {
+        void* p0 = k_SlabMalloc(&slab, 24);
+        void* p1 = k_SlabMalloc(&slab, 24);
+        assert(k_SlabOwns(&slab, p0) && (uint8_t*)p1 - (uint8_t*)p0 == 32);
+        k_SlabFree(&slab, p0);
+        void* p2 = k_SlabMalloc(&slab, 30);
+        assert(p2 == p0 && "free list reuse");
+
+        void* p3 = k_SlabRealloc(&slab, p2, 30, 32);
+        assert(p3 == p2 && "same class realloc is in place");
+        void* p4 = k_SlabRealloc(&slab, p3, 32, 100);
+        assert(p4 != p3);
+
+        void* pBig = k_SlabMalloc(&slab, K_SLAB_MAX_CLASS_SIZE + 1);
+        assert(!k_SlabOwns(&slab, pBig));
+        k_SlabFree(&slab, pBig);
+        k_SlabFree(&slab, p4);
+        k_SlabFree(&slab, p1);
+    }
+
+    {
+        /* Last block of a chunk has to map back to its own chunk's class. */
+        enum { N_BLOCKS = 3 * K_SLAB_CHUNK_SIZE / K_SLAB_MIN_CLASS_SIZE };
+        uint8_t** apBlocks = K_IMALLOC_T(&pGpa->base, uint8_t*, N_BLOCKS);
+        int nBoundaries = 0;
+        uint8_t* pChunkLast = NULL;
+        for (int i = 0; i < N_BLOCKS; ++i)
+        {
+            apBlocks[i] = k_SlabMalloc(&slab, K_SLAB_MIN_CLASS_SIZE);
+            const ssize_t off = apBlocks[i] - (uint8_t*)slab.priv.arena.priv.pData;
+            if (i > 0 && off % K_SLAB_CHUNK_SIZE == 0 && ++nBoundaries == 2)
+                pChunkLast = apBlocks[i - 1];
+        }
+        assert(pChunkLast);
+
+        k_SlabFree(&slab, pChunkLast);
+        uint8_t* pPage = k_SlabMalloc(&slab, K_SLAB_MAX_CLASS_SIZE);
+        assert(pPage != pChunkLast);
+        k_SlabFree(&slab, pPage);
+        pChunkLast = k_SlabMalloc(&slab, K_SLAB_MIN_CLASS_SIZE);
+
+        for (int i = 0; i < N_BLOCKS; ++i) k_SlabFree(&slab, apBlocks[i]);
+        k_IAllocatorFree(&pGpa->base, apBlocks);
+    }
+
+    VecInt v = {0};
+    for (int i = 0; i < 5000; ++i)
+        VecIntPush(&v, &slab.base, &i);
+    for (int i = 0; i < v.size; ++i)
+        assert(VecIntGet(&v, i) == i);
+    VecIntDestroy(&v, &slab.base);
+
+    MapSvToInt m = MapSvToIntCreate(&slab.base, 8);
+    for (int i = 0; i < 100; ++i)
+    {
+        char* pKey = K_IMALLOC_T(&slab.base, char, 16);
+        const ssize_t n = k_print_toBuffer(pKey, 16, "key{i}", i);
+        MapSvToIntInsert(&m, &slab.base, &(k_StringView){pKey, n}, &i);
+    }
+    assert(m.size == 100);
+    assert(*(int*)&MapSvToIntSearch(&m, &K_SV("key42")).pBucket->value == 42);
+    for (ssize_t i = MapSvToIntFirstI(&m); i != MapSvToIntEndI(&m); i = MapSvToIntNextI(&m, i))
+        k_SlabFree(&slab, m.pBuckets[i].key.pData);
+    MapSvToIntDestroy(&m, &slab.base);
+
+    k_print(&pGpa->base, stdout, "slab chunks used: {sz}\n", k_ArenaMemoryUsed(&slab.priv.arena) / K_SLAB_CHUNK_SIZE);
+
+    k_SlabDestroy(&slab);
+    k_print_MapDealloc(&pFormattersMap);
+}
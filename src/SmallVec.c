@@ -0,0 +1,169 @@
+#include "klib/Gpa.h"
+#include "klib/print.h"
+#include "klib/time.h"
+#include "klib/TrackingAllocator.h"
+
+#define K_NAME VecInt
+#define K_TYPE int
+#include "klib/VecGen-inl.h"
+
+#define K_NAME SmallVecInt
+#define K_TYPE int
+#define K_INLINE_CAP 16
+#include "klib/SmallVecGen-inl.h"
+
+#include <assert.h>
+
+enum { N_OPS = 100000, N_BENCH = 1 << 20 };
+
+static uint64_t
+xorshift(uint64_t* pRng)
+{
+    uint64_t x = *pRng;
+    x ^= x << 13, x ^= x >> 7, x ^= x << 17;
+    return *pRng = x;
+}
+
+/* Random pushes and pops across the inline/heap boundary, checked against VecGen. */
+static void
+testAgainstVec(k_IAllocator* pAlloc)
+{
+    VecInt vRef = {0};
+    SmallVecInt v = {0};
+    uint64_t rng = 0x9e3779b97f4a7c15LLU;
+    ssize_t nSpills = 0;
+
+    for (int i = 0; i < N_OPS; ++i)
+    {
+        const uint64_t r = xorshift(&rng) % 8;
+        const bool bWasInline = SmallVecIntIsInline(&v);
+
+        if (r < 3)
+        {
+            VecIntPush(&vRef, pAlloc, &i);
+            SmallVecIntPush(&v, pAlloc, &i);
+        }
+        else if (r < 5)
+        {
+            int aMany[24];
+            const ssize_t n = (ssize_t)(xorshift(&rng) % K_ASIZE(aMany));
+            for (ssize_t j = 0; j < n; ++j) aMany[j] = i + (int)j;
+            VecIntPushMany(&vRef, pAlloc, aMany, n);
+            SmallVecIntPushMany(&v, pAlloc, aMany, n);
+        }
+        else if (r < 7 && vRef.size > 0)
+        {
+            const int ref = *VecIntPop(&vRef);
+            const int got = *SmallVecIntPop(&v);
+            assert(ref == got);
+            (void)ref, (void)got;
+        }
+        else if (vRef.size > 0)
+        {
+            /* Shrink back towards (or into) the inline buffer. */
+            const ssize_t newSize = (ssize_t)(xorshift(&rng) % (uint64_t)(vRef.size + 1));
+            vRef.size = newSize;
+            SmallVecIntShrink(&v, pAlloc, K_MAX(newSize, 1));
+            v.size = newSize;
+        }
+
+        if (bWasInline && !SmallVecIntIsInline(&v)) ++nSpills;
+
+        assert(v.size == vRef.size);
+        assert(SmallVecIntIsInline(&v) == (SmallVecIntCap(&v) == 16));
+        for (ssize_t j = 0; j < v.size; ++j)
+            assert(SmallVecIntGet(&v, j) == VecIntGet(&vRef, j));
+    }
+
+    k_print(pAlloc, stdout, "random ops: final size {sz}, spilled to the heap {sz} times\n", v.size, nSpills);
+
+    SmallVecIntDestroy(&v, pAlloc);
+    VecIntDestroy(&vRef, pAlloc);
+}
+
+/* Small vectors never reach the allocator, bigger ones make a single block. */
+static void
+testAllocations(k_IAllocator* pAlloc)
+{
+    k_TrackingAllocator tr;
+    const bool bInit = k_TrackingAllocatorInit(&tr, pAlloc);
+    assert(bInit);
+    (void)bInit;
+
+    SmallVecInt v = {0};
+    for (int i = 0; i < 16; ++i) SmallVecIntPush(&v, &tr.base, &i);
+    assert(SmallVecIntIsInline(&v) && k_TrackingAllocatorLiveBlocks(&tr) == 0);
+
+    /* Copies by value while inline. */
+    SmallVecInt vCopy = v;
+    SmallVecIntSet(&vCopy, 0, &(int){-1});
+    assert(SmallVecIntGet(&v, 0) == 0 && SmallVecIntGet(&vCopy, 0) == -1);
+
+    SmallVecIntPush(&v, &tr.base, &(int){16});
+    assert(!SmallVecIntIsInline(&v) && k_TrackingAllocatorLiveBlocks(&tr) == 1);
+    for (int i = 0; i < 17; ++i) assert(SmallVecIntGet(&v, i) == i);
+
+    while (v.size > 8) SmallVecIntPopShrink(&v, &tr.base);
+    SmallVecIntShrink(&v, &tr.base, 8);
+    assert(SmallVecIntIsInline(&v) && k_TrackingAllocatorLiveBlocks(&tr) == 0);
+    for (int i = 0; i < 8; ++i) assert(*SmallVecIntGetP(&v, i) == i);
+
+    SmallVecIntInit(&v, &tr.base, 100);
+    assert(!SmallVecIntIsInline(&v) && SmallVecIntCap(&v) == 100);
+    SmallVecIntDestroy(&v, &tr.base);
+
+    assert(k_TrackingAllocatorLiveBlocks(&tr) == 0);
+    k_TrackingAllocatorDestroy(&tr);
+}
+
+/* Lots of short lived vectors, 1 to 16 elements each. */
+static void
+bench(k_IAllocator* pAlloc)
+{
+    uint64_t rng = 1;
+    int64_t sumVec = 0, sumSmall = 0;
+
+    k_time_Type t0 = k_time_now();
+    for (int i = 0; i < N_BENCH; ++i)
+    {
+        VecInt v = {0};
+        const int n = 1 + (int)(xorshift(&rng) % 16);
+        for (int j = 0; j < n; ++j) VecIntPush(&v, pAlloc, &j);
+        sumVec += VecIntGet(&v, n - 1);
+        VecIntDestroy(&v, pAlloc);
+    }
+    k_time_Type t1 = k_time_now();
+
+    rng = 1;
+    for (int i = 0; i < N_BENCH; ++i)
+    {
+        SmallVecInt v = {0};
+        const int n = 1 + (int)(xorshift(&rng) % 16);
+        for (int j = 0; j < n; ++j) SmallVecIntPush(&v, pAlloc, &j);
+        sumSmall += SmallVecIntGet(&v, n - 1);
+        SmallVecIntDestroy(&v, pAlloc);
+    }
+    k_time_Type t2 = k_time_now();
+
+    assert(sumVec == sumSmall);
+
+    k_print(pAlloc, stdout, "{i} short vectors: VecGen: {:.3:d} ms, SmallVecGen: {:.3:d} ms\n",
+        N_BENCH, k_time_diffMSec(t1, t0), k_time_diffMSec(t2, t1)
+    );
+}
+
+int
+main(void)
+{
+    k_Gpa* pGpa = k_GpaInst();
+
+    k_print_Map* pFormattersMap = k_print_MapAlloc(&pGpa->base);
+    if (!pFormattersMap) return 1;
+    k_print_MapSetGlobal(pFormattersMap);
+
+    testAgainstVec(&pGpa->base);
+    testAllocations(&pGpa->base);
+    bench(&pGpa->base);
+
+    k_print_MapDealloc(&pFormattersMap);
+}
@@ -0,0 +1,113 @@
+#include "klib/ThreadCache.h"
+#include "klib/ThreadPool.h"
+#include "klib/Gpa.h"
+#include "klib/print.h"
+#include "klib/TrackingAllocator.h"
+
+#include <assert.h>
+
+#define N_TASKS 200
+#define N_ALLOCS 1000
+
+static k_ThreadCache s_cache;
+
+static void
+churnTask(void* pArg)
+{
+    (void)pArg;
+    void* apLive[64] = {0};
+
+    for (ssize_t i = 0; i < N_ALLOCS; ++i)
+    {
+        const ssize_t slotI = i % K_ASIZE(apLive);
+        k_ThreadCacheFree(&s_cache, apLive[slotI]);
+
+        const ssize_t size = 8 + (i * 37) % 700;
+        apLive[slotI] = k_ThreadCacheMalloc(&s_cache, size);
+        assert(apLive[slotI]);
+        memset(apLive[slotI], (int)i, size);
+    }
+
+    for (ssize_t i = 0; i < K_ASIZE(apLive); ++i)
+        k_ThreadCacheFree(&s_cache, apLive[i]);
+}
+
+/* Freeing lots of blocks keeps at most K_THREAD_CACHE_DEPOT_CAP of them per class, the rest go back in batches. */
+static void
+testDepotCap(k_IAllocator* pAlloc)
+{
+    enum { N = K_THREAD_CACHE_DEPOT_CAP * 4 };
+
+    k_TrackingAllocator tr;
+    const bool bInit = k_TrackingAllocatorInit(&tr, pAlloc);
+    assert(bInit);
+    (void)bInit;
+
+    k_ThreadCache cache;
+    if (!k_ThreadCacheInit(&cache, &tr.base)) return;
+
+    void** apBlocks = K_IMALLOC_T(pAlloc, void*, N);
+    for (ssize_t i = 0; i < N; ++i)
+    {
+        apBlocks[i] = k_ThreadCacheMalloc(&cache, 64);
+        assert(apBlocks[i] && ((uintptr_t)apBlocks[i] & 15) == 0);
+    }
+    for (ssize_t i = 0; i < N; ++i) k_ThreadCacheFree(&cache, apBlocks[i]);
+
+    const k_ThreadCacheStats stats = k_ThreadCacheGetStats(&cache);
+    const ssize_t nLive = k_TrackingAllocatorLiveBlocks(&tr);
+    k_print(pAlloc, stdout, "depot cap: freed {i} blocks, released {sz}, {sz} still live\n", N, stats.nReleased, nLive);
+    /* + 1 for the slots array. */
+    assert(nLive <= K_THREAD_CACHE_DEPOT_CAP + K_THREAD_CACHE_MAGAZINE_CAP + 1);
+    assert(stats.nReleased == N - nLive + 1);
+
+    k_IAllocatorFree(pAlloc, apBlocks);
+    k_ThreadCacheDestroy(&cache);
+    assert(k_TrackingAllocatorLiveBlocks(&tr) == 0);
+    k_TrackingAllocatorDestroy(&tr);
+}
+
+int
+main(void)
+{
+    k_Gpa gpa = k_GpaCreate();
+    k_print_Map* pFormattersMap = k_print_MapAlloc(&gpa.base);
+    if (!pFormattersMap) return 1;
+    k_print_MapSetGlobal(pFormattersMap);
+
+    if (!k_ThreadCacheInit(&s_cache, &gpa.base)) return 1;
+
+    {
+        void* p0 = k_ThreadCacheMalloc(&s_cache, 20);
+        void* p1 = k_ThreadCacheRealloc(&s_cache, p0, 20, 32);
+        assert(p0 == p1 && "same class realloc is in place");
+        void* pBig = k_ThreadCacheRealloc(&s_cache, p1, 32, K_THREAD_CACHE_MAX_CLASS_SIZE * 2);
+        assert(pBig);
+        k_ThreadCacheFree(&s_cache, pBig);
+    }
+
+    k_ThreadPool tp = {0};
+    if (!k_ThreadPoolInit(&tp, (k_ThreadPoolInitOpts){
+        .nThreads = k_optimalThreadCount(),
+        .arenaReserve = K_SIZE_1K*60,
+        .ringBufferSize = K_SIZE_1K*4,
+    }))
+    {
+        k_print(&gpa.base, stdout, "FAILED\n");
+        return 1;
+    }
+
+    for (ssize_t i = 0; i < N_TASKS; ++i)
+        k_ThreadPoolAddP(&tp, churnTask, NULL);
+    k_ThreadPoolDestroy(&tp);
+
+    k_ThreadCacheStats stats = k_ThreadCacheGetStats(&s_cache);
+    k_print(&gpa.base, stdout, "hits: {sz}, misses: {sz}, refills: {sz}, flushes: {sz}\n",
+        stats.nHits, stats.nMisses, stats.nRefills, stats.nFlushes
+    );
+    assert(stats.nHits > stats.nMisses);
+
+    k_ThreadCacheDestroy(&s_cache);
+    testDepotCap(&gpa.base);
+    k_print_MapDealloc(&pFormattersMap);
+}
@@ -57,6 +57,57 @@ funcBigLoad(void* p)
     }
 }
 
+typedef struct TrimTask
+{
+    k_ThreadPool* pTp;
+    ssize_t nBytes;
+    ssize_t highWater;
+    k_atomic_Int atomBDone;
+} TrimTask;
+
+/* Uses the worker arena and resets it, which already trims. */
+static void
+funcTrim(void* pArg)
+{
+    TrimTask* p = pArg;
+    k_Arena* pArena = k_ThreadPoolArena(p->pTp);
+    void* pMem = k_ArenaMalloc(pArena, p->nBytes);
+    memset(pMem, 1, p->nBytes);
+    k_ArenaReset(pArena);
+    p->highWater = k_ArenaHighWater(pArena);
+    k_AtomicIntStoreRelease(&p->atomBDone, 1);
+}
+
+/* A big task is remembered for arenaTrimResets tasks, the pool must not trim again after the task's own reset. */
+static void
+testTrim(k_IAllocator* pAlloc)
+{
+    k_ThreadPool tp = {0};
+    if (!k_ThreadPoolInit(&tp, (k_ThreadPoolInitOpts){
+        .nThreads = 1,
+        .arenaReserve = K_SIZE_1M*4,
+        .ringBufferSize = 128,
+        .arenaTrimResets = 2,
+    })) return;
+
+    /* Spin instead of k_ThreadPoolWait(), which would run the tasks on this thread's arena. */
+    TrimTask aTasks[] = {{&tp, K_SIZE_1M}, {&tp, K_SIZE_1K*4}, {&tp, K_SIZE_1K*4}};
+    for (ssize_t i = 0; i < K_ASIZE(aTasks); ++i)
+    {
+        k_ThreadPoolAddP(&tp, funcTrim, &aTasks[i]);
+        while (!k_AtomicIntLoadAcquire(&aTasks[i].atomBDone)) k_ThreadYield();
+    }
+    k_ThreadPoolWait(&tp);
+
+    k_print(pAlloc, stdout, "trim: high-water after the big task: {sz} KiB, one task later: {sz} KiB, two tasks later: {sz} KiB\n",
+        aTasks[0].highWater / K_SIZE_1K, aTasks[1].highWater / K_SIZE_1K, aTasks[2].highWater / K_SIZE_1K
+    );
+    assert(aTasks[1].highWater >= K_SIZE_1M);
+    assert(aTasks[2].highWater < K_SIZE_1M);
+
+    k_ThreadPoolDestroy(&tp);
+}
+
 int
 main(void)
 {
@@ -121,4 +172,6 @@ main(void)
     int counter = k_AtomicIntLoadRelaxed(&s_atomCounter);
     k_print(&gpa.base, stderr, "s_atomCounter: {i}\n", counter);
     assert(counter == BIG);
+
+    testTrim(&gpa.base);
 }
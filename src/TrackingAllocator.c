@@ -0,0 +1,63 @@
+#include "klib/TrackingAllocator.h"
+#include "klib/Gpa.h"
+#include "klib/print.h"
+
+#include <assert.h>
+
+#define K_NAME VecInt
+#define K_TYPE int
+#include "klib/VecGen-inl.h"
+
+#define K_NAME MapSvToInt
+#define K_KEY_T k_StringView
+#define K_VALUE_T int
+#define K_FN_HASH k_StringViewHash
+#define K_FN_KEY_CMP k_StringViewCmp
+#include "klib/MapGen-inl.h"
+
+int
+main(void)
+{
+    k_Gpa* pGpa = k_GpaInst();
+
+    k_print_Map* pFormattersMap = k_print_MapAlloc(&pGpa->base);
+    if (!pFormattersMap) return 1;
+    k_print_MapSetGlobal(pFormattersMap);
+
+    k_TrackingAllocator tr;
+    if (!k_TrackingAllocatorInit(&tr, &pGpa->base)) return 1;
+
+    char* pBuff = K_TRACKING_IMALLOC_T(&tr, char, 100);
+    pBuff = K_TRACKING_IREALLOC_T(&tr, char, pBuff, 100, 200);
+
+    VecInt vSmall = {0};
+    VecInt vBig = {0};
+
+    K_TRACKING_SITE(&tr);
+    for (int i = 0; i < 10; ++i) VecIntPush(&vSmall, &tr.base, &i);
+
+    K_TRACKING_SITE(&tr);
+    for (int i = 0; i < 10000; ++i) VecIntPush(&vBig, &tr.base, &i);
+
+    K_TRACKING_SITE(&tr);
+    MapSvToInt m = MapSvToIntCreate(&tr.base, 8);
+    static const char* aNtsKeys[] = {"one", "two", "three", "four", "five", "six", "seven", "eight", "nine", "ten"};
+    for (int i = 0; i < K_ASIZE(aNtsKeys); ++i)
+        MapSvToIntInsert(&m, &tr.base, &K_NTS(aNtsKeys[i]), &i);
+
+    assert(k_TrackingAllocatorLiveBlocks(&tr) == 4);
+    assert(k_TrackingAllocatorBytesLive(&tr) >= 200 + 10000 * (ssize_t)sizeof(int));
+
+    k_TrackingAllocatorPrintReport(&tr, stdout);
+
+    MapSvToIntDestroy(&m, &tr.base);
+    VecIntDestroy(&vBig, &tr.base);
+    VecIntDestroy(&vSmall, &tr.base);
+    k_TrackingAllocatorFree(&tr, pBuff);
+
+    assert(k_TrackingAllocatorLiveBlocks(&tr) == 0);
+    assert(k_TrackingAllocatorBytesLive(&tr) == 0);
+
+    k_TrackingAllocatorDestroy(&tr);
+    k_print_MapDealloc(&pFormattersMap);
+}
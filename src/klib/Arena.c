@@ -1,11 +1,15 @@
 #include "Arena.h"
 
 #include <assert.h>
+#include <errno.h>
 #include <stdlib.h>
 
 #if defined __unix__
     #define K_ARENA_MMAP
     #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
 #elif defined _WIN32
     #define K_ARENA_WIN32
 
@@ -21,6 +25,19 @@
     #warning "Arena is not implemented"
 #endif
 
+#define K_ARENA_FILE_MAGIC 0x4b41524e41464c31LLU /* "KARNAFL1" */
+
+/* Occupies the first page of a file backed arena. */
+typedef struct k_ArenaFileHeader
+{
+    uint64_t magic;
+    int64_t headerSize; /* Page size at creation, data starts after it. */
+    int64_t size; /* Whole file. */
+    void* pBase; /* Address of the mapping at creation, reopening tries to map there again. */
+    int64_t pos;
+    int64_t rootOff; /* K_NPOS64 if not set. */
+} k_ArenaFileHeader;
+
 static bool
 commit(void* p, ssize_t size)
 {
@@ -46,7 +63,9 @@ commit(void* p, ssize_t size)
 static void
 decommit(k_Arena* s, void* p, ssize_t size)
 {
-    (void)s;
+    /* Dropping shared file pages would lose the data (and hugetlbfs would lose it for good). */
+    if (s->priv.pFileHeader) return;
+
 #ifdef K_ARENA_MMAP
     int err = mprotect(p, size, PROT_NONE);
     (void)err;
@@ -54,8 +73,9 @@ decommit(k_Arena* s, void* p, ssize_t size)
     {
         abort();
     }
+    /* Hugetlb mappings reject MADV_DONTNEED before Linux 5.18: the pages just stay resident until munmap. */
     err = madvise(p, size, MADV_DONTNEED);
-    if (err == - 1)
+    if (err == - 1 && errno != EINVAL)
     {
         abort();
     }
@@ -68,6 +88,22 @@ decommit(k_Arena* s, void* p, ssize_t size)
 #endif
 }
 
+/* Makes pages inaccessible without dropping commit accounting. */
+static void
+guard(void* p, ssize_t size)
+{
+    if (size <= 0) return;
+
+#ifdef K_ARENA_MMAP
+    if (mprotect(p, size, PROT_NONE) == -1) abort();
+#elif defined K_ARENA_WIN32
+    DWORD oldProtect;
+    if (!VirtualProtect(p, size, PAGE_NOACCESS, &oldProtect)) abort();
+#else
+    (void)p;
+#endif
+}
+
 bool
 growIfNeeded(k_Arena* pSelf, ssize_t newPos)
 {
@@ -75,8 +111,7 @@ growIfNeeded(k_Arena* pSelf, ssize_t newPos)
 
     if (newPos > s->commited)
     {
-        const ssize_t pageSize = k_getPageSize();
-        ssize_t aligned = K_ALIGN_UP_PO2(newPos, pageSize);
+        ssize_t aligned = K_ALIGN_UP_PO2(newPos, s->commitGranule);
         const ssize_t newCommited = K_MAX(aligned, s->commited * 2);
         if (newCommited > s->reserved)
         {
@@ -94,11 +129,203 @@ growIfNeeded(k_Arena* pSelf, ssize_t newPos)
 #endif
 
     s->pos = newPos;
+    if (newPos > s->highWater) s->highWater = newPos;
+    return true;
+}
+
+#ifdef K_ARENA_MMAP
+
+/* Over-reserve by one huge page and trim the slack so the region starts at a huge page boundary. */
+static void*
+reserveHugeAligned(ssize_t size)
+{
+    const ssize_t overSize = size + K_ARENA_HUGE_PAGE_SIZE;
+    uint8_t* pRes = mmap(NULL, overSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (pRes == MAP_FAILED) return NULL;
+
+    uint8_t* pAligned = (uint8_t*)K_ALIGN_UP_PO2((uintptr_t)pRes, (uintptr_t)K_ARENA_HUGE_PAGE_SIZE);
+    const ssize_t head = pAligned - pRes;
+    const ssize_t tail = overSize - head - size;
+    if (head > 0) munmap(pRes, head);
+    if (tail > 0) munmap(pAligned + size, tail);
+
+    return pAligned;
+}
+
+    #ifdef MADV_HUGEPAGE
+/* madvise(MADV_HUGEPAGE) succeeds even when THP is off, so ask sysfs. */
+static bool
+thpEnabled(void)
+{
+    int fd = open("/sys/kernel/mm/transparent_hugepage/enabled", O_RDONLY);
+    if (fd == -1) return false;
+
+    char aBuff[64];
+    const ssize_t n = read(fd, aBuff, sizeof(aBuff) - 1);
+    close(fd);
+    if (n <= 0) return false;
+
+    aBuff[n] = '\0';
+    return !strstr(aBuff, "[never]");
+}
+    #endif
+
+#endif
+
+static void*
+reserve(ssize_t* pSize, ssize_t* pGranule, K_ARENA_PAGES* pEPages)
+{
+    const ssize_t pageSize = k_getPageSize();
+
+#ifdef K_ARENA_MMAP
+    const ssize_t hugeSize = K_ALIGN_UP_PO2(*pSize, K_ARENA_HUGE_PAGE_SIZE);
+
+    #ifdef MAP_HUGETLB
+    if (*pEPages == K_ARENA_PAGES_HUGE_EXPLICIT)
+    {
+        /* Takes the whole reservation from the hugetlbfs pool, fails if the pool is too small. */
+        void* pRes = mmap(NULL, hugeSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (pRes != MAP_FAILED)
+        {
+            *pSize = hugeSize;
+            *pGranule = K_ARENA_HUGE_PAGE_SIZE;
+            return pRes;
+        }
+    }
+    #endif
+
+    #ifdef MADV_HUGEPAGE
+    if ((*pEPages == K_ARENA_PAGES_HUGE_EXPLICIT || *pEPages == K_ARENA_PAGES_HUGE_TRANSPARENT) && thpEnabled())
+    {
+        void* pRes = reserveHugeAligned(hugeSize);
+        if (pRes)
+        {
+            if (madvise(pRes, hugeSize, MADV_HUGEPAGE) == 0)
+            {
+                *pSize = hugeSize;
+                *pGranule = K_ARENA_HUGE_PAGE_SIZE;
+                *pEPages = K_ARENA_PAGES_HUGE_TRANSPARENT;
+                return pRes;
+            }
+
+            munmap(pRes, hugeSize);
+        }
+    }
+    #endif
+
+    *pSize = K_ALIGN_UP_PO2(*pSize, pageSize);
+    *pGranule = pageSize;
+    *pEPages = K_ARENA_PAGES_DEFAULT;
+
+    void* pRes = mmap(NULL, *pSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (pRes == MAP_FAILED) return NULL;
+    return pRes;
+#elif defined K_ARENA_WIN32
+    /* Large pages need SeLockMemoryPrivilege and can't be committed lazily. */
+    *pSize = K_ALIGN_UP_PO2(*pSize, pageSize);
+    *pGranule = pageSize;
+    *pEPages = K_ARENA_PAGES_DEFAULT;
+
+    return VirtualAlloc(NULL, *pSize, MEM_RESERVE, PAGE_READWRITE);
+#else
+    (void)pageSize, (void)pSize, (void)pGranule, (void)pEPages;
+    return NULL;
+#endif
+}
+
+static bool
+initFile(k_Arena* s, k_ArenaInitOpts opts)
+{
+#ifdef K_ARENA_MMAP
+    const ssize_t pageSize = k_getPageSize();
+
+    int fd = open(opts.ntsFilePathOrNull, O_RDWR | O_CREAT, 0644);
+    if (fd == -1) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) == -1) goto fail;
+
+    k_ArenaFileHeader hdr = {0};
+    const bool bExisting = st.st_size >= (off_t)sizeof(hdr) &&
+        pread(fd, &hdr, sizeof(hdr), 0) == (ssize_t)sizeof(hdr) &&
+        hdr.magic == K_ARENA_FILE_MAGIC && hdr.headerSize == pageSize && hdr.size == st.st_size;
+
+    ssize_t size = pageSize + K_ALIGN_UP_PO2(opts.reserveSize, pageSize);
+    if (bExisting) size = K_MAX(size, hdr.size);
+    if (size > st.st_size && ftruncate(fd, size) == -1) goto fail;
+
+    uint8_t* pMap = MAP_FAILED;
+    #ifdef MAP_FIXED_NOREPLACE
+    if (bExisting)
+    {
+        pMap = mmap(hdr.pBase, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED_NOREPLACE, fd, 0);
+        if (pMap != MAP_FAILED && pMap != hdr.pBase)
+        {
+            /* Old kernels treat the flag as a hint. */
+            munmap(pMap, size);
+            pMap = MAP_FAILED;
+        }
+    }
+    #endif
+    if (pMap == MAP_FAILED) pMap = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (pMap == MAP_FAILED) goto fail;
+
+    close(fd);
+
+    k_ArenaFileHeader* pHdr = (k_ArenaFileHeader*)pMap;
+    if (!bExisting)
+    {
+        *pHdr = (k_ArenaFileHeader){
+            .magic = K_ARENA_FILE_MAGIC,
+            .headerSize = pageSize,
+            .pBase = pMap,
+            .pos = 0,
+            .rootOff = (int64_t)K_NPOS64,
+        };
+    }
+    pHdr->size = size; /* Keep pBase of the creation, mapping there again makes raw pointers valid again. */
+
+    s->priv.pData = pMap + pageSize;
+    s->priv.pos = pHdr->pos;
+    s->priv.reserved = size - pageSize;
+    s->priv.commited = s->priv.reserved;
+    s->priv.commitGranule = pageSize;
+    s->priv.ePages = K_ARENA_PAGES_DEFAULT;
+    s->priv.pLastAlloc = (void*)K_NPOS64;
+    s->priv.lDeleters = NULL;
+    s->priv.pLCurrentDeleters = &s->priv.lDeleters;
+    s->priv.pScope = NULL;
+    s->priv.nHoles = 0;
+    s->priv.minCommit = s->priv.reserved;
+    s->priv.highWater = s->priv.pos;
+    memset(s->priv.aTrimWindow, 0, sizeof(s->priv.aTrimWindow));
+    s->priv.trimWindowSize = 0;
+    s->priv.trimWindowI = 0;
+    s->priv.pFileHeader = pHdr;
+    s->priv.bFileRelocated = bExisting && pMap != hdr.pBase;
+    s->priv.bGuardPages = false;
+
+    K_ASAN_POISON((uint8_t*)s->priv.pData + s->priv.pos, s->priv.reserved - s->priv.pos);
+
     return true;
+
+fail:
+    close(fd);
+    return false;
+#else
+    (void)s, (void)opts;
+    return false;
+#endif
 }
 
 bool
 k_ArenaInit(k_Arena* s, ssize_t reserveSize, ssize_t commitSize)
+{
+    return k_ArenaInitWithOpts(s, (k_ArenaInitOpts){.reserveSize = reserveSize, .commitSize = commitSize});
+}
+
+bool
+k_ArenaInitWithOpts(k_Arena* s, k_ArenaInitOpts opts)
 {
     static k_IAllocatorVTable s_arenaVTable = {
         .malloc = k_ArenaMalloc,
@@ -109,54 +336,248 @@ k_ArenaInit(k_Arena* s, ssize_t reserveSize, ssize_t commitSize)
     s->base.pVTable = &s_arenaVTable;
     s->priv.pData = NULL;
 
-    int err = 0;
-    (void)err;
-
-    assert(reserveSize > 0);
+    assert(opts.reserveSize > 0);
 
-    const ssize_t pageSize = k_getPageSize();
-    const ssize_t realReserved = K_ALIGN_UP_PO2(reserveSize, pageSize);
+    if (opts.ntsFilePathOrNull) return initFile(s, opts);
 
-#ifdef K_ARENA_MMAP
-    void* pRes = mmap(NULL, realReserved, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
-    if (pRes == MAP_FAILED) return false;
-#elif defined K_ARENA_WIN32
-    void* pRes = VirtualAlloc(NULL, realReserved, MEM_RESERVE, PAGE_READWRITE);
+    ssize_t realReserved = opts.reserveSize;
+    ssize_t granule = 0;
+    K_ARENA_PAGES ePages = opts.ePages;
+    void* pRes = reserve(&realReserved, &granule, &ePages);
     if (!pRes) return false;
-#else
-#endif
 
     s->priv.pData = pRes;
     s->priv.pos = 0;
     s->priv.reserved = realReserved;
     s->priv.commited = 0;
+    s->priv.commitGranule = granule;
+    s->priv.ePages = ePages;
     s->priv.pLastAlloc = (void*)K_NPOS64;
     s->priv.lDeleters = NULL;
     s->priv.pLCurrentDeleters = &s->priv.lDeleters;
+    s->priv.pScope = NULL;
+    s->priv.nHoles = 0;
+    s->priv.minCommit = 0;
+    s->priv.highWater = 0;
+    memset(s->priv.aTrimWindow, 0, sizeof(s->priv.aTrimWindow));
+    s->priv.trimWindowSize = K_MIN(opts.trimResets, K_ARENA_TRIM_WINDOW_CAP);
+    s->priv.trimWindowI = 0;
+    s->priv.pFileHeader = NULL;
+    s->priv.bFileRelocated = false;
+    s->priv.bGuardPages = opts.bGuardPages;
+
+    assert(opts.trimResets <= K_ARENA_TRIM_WINDOW_CAP);
 
     K_ASAN_POISON(s->priv.pData, realReserved);
 
-    if (commitSize > 0)
+    if (opts.commitSize > 0)
     {
-        const ssize_t realCommit = K_ALIGN_UP_PO2(commitSize, pageSize);
+        const ssize_t realCommit = K_MIN(K_ALIGN_UP_PO2(opts.commitSize, granule), realReserved);
         if (!commit(s->priv.pData, realCommit))
         {
             abort();
             return false;
         }
         s->priv.commited = realCommit;
+        s->priv.minCommit = realCommit;
     }
 
     return true;
 }
 
+static void
+removeHole(k_Arena* s, ssize_t i)
+{
+    s->priv.aHoles[i] = s->priv.aHoles[--s->priv.nHoles];
+}
+
+static ssize_t
+holeStartingAt(k_Arena* s, ssize_t off)
+{
+    for (ssize_t i = 0; i < s->priv.nHoles; ++i)
+        if (s->priv.aHoles[i].off == off) return i;
+
+    return K_NPOS;
+}
+
+static ssize_t
+holeEndingAt(k_Arena* s, ssize_t off)
+{
+    for (ssize_t i = 0; i < s->priv.nHoles; ++i)
+        if (s->priv.aHoles[i].off + s->priv.aHoles[i].size == off) return i;
+
+    return K_NPOS;
+}
+
+static void
+addHole(k_Arena* s, ssize_t off, ssize_t size)
+{
+    K_ASAN_POISON((uint8_t*)s->priv.pData + off, size);
+
+    /* Coalesce with neighbours. */
+    ssize_t i = holeEndingAt(s, off);
+    if (i != K_NPOS)
+    {
+        off = s->priv.aHoles[i].off;
+        size += s->priv.aHoles[i].size;
+        removeHole(s, i);
+    }
+    i = holeStartingAt(s, off + size);
+    if (i != K_NPOS)
+    {
+        size += s->priv.aHoles[i].size;
+        removeHole(s, i);
+    }
+
+    if (size < K_ARENA_HOLE_MIN_SIZE) return;
+
+    if (s->priv.nHoles >= K_ARENA_HOLES_CAP)
+    {
+        /* Evict the smallest one, it stays unusable until reset. */
+        ssize_t minI = 0;
+        for (ssize_t j = 1; j < s->priv.nHoles; ++j)
+            if (s->priv.aHoles[j].size < s->priv.aHoles[minI].size) minI = j;
+
+        if (s->priv.aHoles[minI].size >= size) return;
+        removeHole(s, minI);
+    }
+
+    s->priv.aHoles[s->priv.nHoles++] = (k_ArenaHole){.off = off, .size = size};
+}
+
+/* Shrinks hole i from the front by size bytes. */
+static void
+takeFromHole(k_Arena* s, ssize_t i, ssize_t size)
+{
+    k_ArenaHole* pHole = &s->priv.aHoles[i];
+    K_ASAN_UNPOISON((uint8_t*)s->priv.pData + pHole->off, size);
+
+    pHole->off += size;
+    pHole->size -= size;
+    if (pHole->size < K_ARENA_HOLE_MIN_SIZE) removeHole(s, i);
+}
+
+static void*
+mallocFromHoles(k_Arena* s, ssize_t realSize)
+{
+    ssize_t bestI = K_NPOS;
+    for (ssize_t i = 0; i < s->priv.nHoles; ++i)
+    {
+        if (s->priv.aHoles[i].size >= realSize &&
+            (bestI == K_NPOS || s->priv.aHoles[i].size < s->priv.aHoles[bestI].size)
+        )
+        {
+            bestI = i;
+        }
+    }
+
+    if (bestI == K_NPOS) return NULL;
+
+    void* pRet = (uint8_t*)s->priv.pData + s->priv.aHoles[bestI].off;
+    takeFromHole(s, bestI, realSize);
+    return pRet;
+}
+
+/* Cuts [off, off + size) out of a saved hole list, pieces that don't fit are dropped until reset. */
+static void
+cutHole(k_ArenaHole* aHoles, ssize_t* pNHoles, ssize_t off, ssize_t size)
+{
+    const ssize_t end = off + size;
+    for (ssize_t i = *pNHoles - 1; i >= 0; --i)
+    {
+        const k_ArenaHole hole = aHoles[i];
+        const ssize_t holeEnd = hole.off + hole.size;
+        if (end <= hole.off || off >= holeEnd) continue;
+
+        aHoles[i] = aHoles[--*pNHoles];
+        if (off - hole.off >= K_ARENA_HOLE_MIN_SIZE)
+            aHoles[(*pNHoles)++] = (k_ArenaHole){.off = hole.off, .size = off - hole.off};
+        if (holeEnd - end >= K_ARENA_HOLE_MIN_SIZE && *pNHoles < K_ARENA_HOLES_CAP)
+            aHoles[(*pNHoles)++] = (k_ArenaHole){.off = end, .size = holeEnd - end};
+    }
+}
+
+/* The block at blockOff was reallocated into [off, off + size). If the block may be older than a scope
+ * (it starts below the scope's pos), that memory stays taken after the scope, so the scope must not restore it as a hole. */
+static void
+claimFromScopes(k_Arena* s, ssize_t blockOff, ssize_t off, ssize_t size)
+{
+    for (k_ArenaState* pScope = s->priv.pScope; pScope; pScope = pScope->state.pPrevScope)
+    {
+        if (blockOff < pScope->state.pos)
+            cutHole(pScope->state.aHoles, &pScope->state.nHoles, off, size);
+    }
+}
+
+/* Aligned size plus the redzone after it. */
+static inline ssize_t
+blockSize(ssize_t nBytes)
+{
+    return K_ALIGN_UP8(nBytes) + K_ARENA_REDZONE_SIZE;
+}
+
+/* Unpoisons the first nBytes of the block and poisons the rest of it. */
+static inline void
+poisonTail(void* p, ssize_t nBytes, ssize_t size)
+{
+    (void)p, (void)nBytes, (void)size;
+    K_ASAN_UNPOISON(p, nBytes);
+    K_ASAN_POISON((uint8_t*)p + nBytes, size - nBytes);
+}
+
+/* Every block gets its own pages and ends right before an inaccessible page. */
+static void*
+mallocGuarded(k_Arena* s, ssize_t nBytes)
+{
+    const ssize_t pageSize = s->priv.commitGranule;
+    const ssize_t dataSize = K_ALIGN_UP_PO2(K_ALIGN_UP8(nBytes), pageSize);
+
+    uint8_t* pBlock = (uint8_t*)s->priv.pData + s->priv.pos;
+    if (!growIfNeeded(s, s->priv.pos + dataSize + pageSize)) return NULL;
+    if (dataSize > 0) commit(pBlock, dataSize);
+    guard(pBlock + dataSize, pageSize);
+
+    void* pRet = pBlock + dataSize - K_ALIGN_UP8(nBytes);
+    s->priv.pLastAlloc = pRet;
+    return pRet;
+}
+
+static void*
+reallocGuarded(k_Arena* s, void* p, ssize_t oldNBytes, ssize_t newNBytes)
+{
+    void* pMem = mallocGuarded(s, newNBytes);
+    if (!pMem) return NULL;
+
+    memcpy(pMem, p, K_MIN(oldNBytes, newNBytes));
+
+    /* Catch stale pointers to the old block. */
+    uint8_t* pOldBlock = (uint8_t*)K_ALIGN_DOWN_PO2((uintptr_t)p, (uintptr_t)s->priv.commitGranule);
+    guard(pOldBlock, (uint8_t*)p + K_ALIGN_UP8(oldNBytes) - pOldBlock);
+
+    return pMem;
+}
+
 void*
 k_ArenaMalloc(void* pSelf, ssize_t nBytes)
 {
     k_Arena* s = (k_Arena*)pSelf;
-    const ssize_t realSize = K_ALIGN_UP8(nBytes);
+    if (s->priv.bGuardPages) return mallocGuarded(s, nBytes);
+
+    const ssize_t realSize = blockSize(nBytes);
+
+    if (s->priv.nHoles > 0 && realSize >= K_ARENA_HOLE_MIN_SIZE)
+    {
+        void* pHole = mallocFromHoles(s, realSize);
+        if (pHole)
+        {
+            poisonTail(pHole, nBytes, realSize);
+            return pHole;
+        }
+    }
+
     void* pRet = (void*)((uint8_t*)s->priv.pData + s->priv.pos);
     if (!growIfNeeded(s, s->priv.pos + realSize)) return NULL;
+    poisonTail(pRet, nBytes, realSize);
     s->priv.pLastAlloc = pRet;
 
     return pRet;
@@ -174,21 +595,64 @@ void*
 k_ArenaRealloc(void* pSelf, void* p, ssize_t oldNBytes, ssize_t newNBytes)
 {
     k_Arena* s = (k_Arena*)pSelf;
-    if (!p) return malloc(newNBytes);
+    if (!p) return k_ArenaMalloc(s, newNBytes);
+    if (s->priv.bGuardPages) return reallocGuarded(s, p, oldNBytes, newNBytes);
 
     /* bump case */
     if (p == s->priv.pLastAlloc)
     {
-        const ssize_t realSize = K_ALIGN_UP8(newNBytes);
+        const ssize_t realSize = blockSize(newNBytes);
         const ssize_t newPos = ((ssize_t)s->priv.pLastAlloc - (ssize_t)s->priv.pData) + realSize;
         if (!growIfNeeded(s, newPos)) return NULL;
+        poisonTail(p, newNBytes, realSize);
         return p;
     }
 
-    if (newNBytes <= oldNBytes) return p;
+    if (newNBytes <= oldNBytes)
+    {
+        poisonTail(p, newNBytes, blockSize(oldNBytes));
+        return p;
+    }
+
+    const ssize_t off = (uint8_t*)p - (uint8_t*)s->priv.pData;
+    const ssize_t oldSize = blockSize(oldNBytes);
+    const ssize_t newSize = blockSize(newNBytes);
+
+    /* Extend into the hole right after the block. */
+    const ssize_t afterI = holeStartingAt(s, off + oldSize);
+    if (afterI != K_NPOS && oldSize + s->priv.aHoles[afterI].size >= newSize)
+    {
+        takeFromHole(s, afterI, newSize - oldSize);
+        claimFromScopes(s, off, off + oldSize, newSize - oldSize);
+        poisonTail(p, newNBytes, newSize);
+        return p;
+    }
+
+    /* Slide down into the hole right before the block. */
+    const ssize_t beforeI = holeEndingAt(s, off);
+    if (beforeI != K_NPOS && s->priv.aHoles[beforeI].size + oldSize >= newSize)
+    {
+        const k_ArenaHole hole = s->priv.aHoles[beforeI];
+        removeHole(s, beforeI);
+
+        uint8_t* pNew = (uint8_t*)s->priv.pData + hole.off;
+        K_ASAN_UNPOISON(pNew, hole.size);
+        memmove(pNew, p, oldNBytes);
+
+        const ssize_t tailOff = hole.off + newSize;
+        if (tailOff < off + oldSize) addHole(s, tailOff, off + oldSize - tailOff);
+        claimFromScopes(s, off, hole.off, newSize);
+        poisonTail(pNew, newNBytes, newSize);
+
+        return pNew;
+    }
+
+    void* pMem = k_ArenaMalloc(s, newNBytes);
+    if (!pMem) return NULL;
 
-    void* pMem = malloc(newNBytes);
-    if (p) memcpy(pMem, p, K_MIN(oldNBytes, newNBytes));
+    memcpy(pMem, p, oldNBytes);
+    addHole(s, off, oldSize);
+    claimFromScopes(s, off, (uint8_t*)pMem - (uint8_t*)s->priv.pData, newSize);
     return pMem;
 }
 
@@ -200,7 +664,16 @@ k_ArenaDestroy(k_Arena* s)
     if (s->priv.pData)
     {
 #ifdef K_ARENA_MMAP
-        int err = munmap(s->priv.pData, s->priv.reserved);
+        int err;
+        if (s->priv.pFileHeader)
+        {
+            k_ArenaFileSync(s);
+            err = munmap(s->priv.pFileHeader, s->priv.reserved + s->priv.pFileHeader->headerSize);
+        }
+        else
+        {
+            err = munmap(s->priv.pData, s->priv.reserved);
+        }
         (void)err;
         assert(err != - 1);
 #elif defined ADT_ARENA_WIN32
@@ -218,9 +691,13 @@ k_ArenaReset(k_Arena* s)
     k_ArenaRunDeleters(s);
 
     K_ASAN_POISON(s->priv.pData, s->priv.pos);
+    if (s->priv.bGuardPages) guard(s->priv.pData, s->priv.pos);
 
     s->priv.pos = 0;
     s->priv.pLastAlloc = (void*)K_NPOS64;
+    s->priv.nHoles = 0;
+
+    if (s->priv.trimWindowSize > 0) k_ArenaTrim(s);
 }
 
 void
@@ -235,6 +712,8 @@ k_ArenaResetDecommit(k_Arena* s)
     s->priv.pos = 0;
     s->priv.commited = 0;
     s->priv.pLastAlloc = (void*)K_NPOS64;
+    s->priv.nHoles = 0;
+    s->priv.highWater = 0;
 }
 
 void
@@ -242,7 +721,7 @@ k_ArenaResetToPage(k_Arena* pSelf, ssize_t nthPage)
 {
     K_TYPEOF(pSelf->priv)* s = &pSelf->priv;
 
-    const ssize_t commitSize = k_getPageSize() * nthPage;
+    const ssize_t commitSize = K_ALIGN_UP_PO2(k_getPageSize() * nthPage, s->commitGranule);
     assert(commitSize <= s->reserved);
 
     k_ArenaRunDeleters(pSelf);
@@ -257,6 +736,70 @@ k_ArenaResetToPage(k_Arena* pSelf, ssize_t nthPage)
     s->pos = 0;
     s->commited = commitSize;
     s->pLastAlloc = (void*)K_NPOS64;
+    s->nHoles = 0;
+    s->highWater = 0;
+}
+
+ssize_t
+k_ArenaHighWater(k_Arena* pSelf)
+{
+    K_TYPEOF(pSelf->priv)* s = &pSelf->priv;
+
+    ssize_t ret = s->highWater;
+    for (ssize_t i = 0; i < s->trimWindowSize; ++i)
+        ret = K_MAX(ret, s->aTrimWindow[i]);
+
+    return ret;
+}
+
+void
+k_ArenaTrim(k_Arena* pSelf)
+{
+    K_TYPEOF(pSelf->priv)* s = &pSelf->priv;
+
+    /* The cycle that just ended replaces the oldest one in the window. */
+    if (s->trimWindowSize > 0)
+    {
+        s->aTrimWindow[s->trimWindowI] = s->highWater;
+        s->trimWindowI = (s->trimWindowI + 1) % s->trimWindowSize;
+    }
+
+    const ssize_t keep = K_MAX(K_MAX(k_ArenaHighWater(pSelf), s->pos), s->minCommit);
+    const ssize_t newCommited = K_MIN(K_ALIGN_UP_PO2(keep, s->commitGranule), s->reserved);
+    s->highWater = s->pos;
+
+    if (newCommited < s->commited)
+    {
+        decommit(pSelf, (uint8_t*)s->pData + newCommited, s->commited - newCommited);
+        s->commited = newCommited;
+    }
+}
+
+bool
+k_ArenaFileSync(k_Arena* s)
+{
+    if (!s->priv.pFileHeader) return false;
+
+    s->priv.pFileHeader->pos = s->priv.pos;
+#ifdef K_ARENA_MMAP
+    return msync(s->priv.pFileHeader, s->priv.reserved + s->priv.pFileHeader->headerSize, MS_SYNC) == 0;
+#else
+    return false;
+#endif
+}
+
+void*
+k_ArenaFileRoot(k_Arena* s)
+{
+    if (!s->priv.pFileHeader || s->priv.pFileHeader->rootOff == (int64_t)K_NPOS64) return NULL;
+    return (uint8_t*)s->priv.pData + s->priv.pFileHeader->rootOff;
+}
+
+void
+k_ArenaFileSetRoot(k_Arena* s, void* p)
+{
+    assert(s->priv.pFileHeader);
+    s->priv.pFileHeader->rootOff = p ? (uint8_t*)p - (uint8_t*)s->priv.pData : (int64_t)K_NPOS64;
 }
 
 void
@@ -291,17 +834,35 @@ k_ArenaStatePush(k_ArenaState* s, k_Arena* pArena)
     s->state.pos = pArena->priv.pos;
     s->state.pLastAlloc = pArena->priv.pLastAlloc;
     s->state.pLCurrentDeleters = pArena->priv.pLCurrentDeleters;
+    s->state.nHoles = pArena->priv.nHoles;
+    memcpy(s->state.aHoles, pArena->priv.aHoles, sizeof(k_ArenaHole) * pArena->priv.nHoles);
+    s->state.pPrevScope = pArena->priv.pScope;
 
     s->lDeleters = NULL;
     s->state.pArena->priv.pLCurrentDeleters = &s->lDeleters;
+    pArena->priv.pScope = s;
 }
 
 void
 k_ArenaStateRestore(k_ArenaState* s)
 {
     k_ArenaRunDeleters(s->state.pArena);
-    K_ASAN_POISON((uint8_t*)s->state.pArena->priv.pData + s->state.pArena->priv.pos, s->state.pArena->priv.pos - s->state.pos);
+
+    uint8_t* pReleased = (uint8_t*)s->state.pArena->priv.pData + s->state.pos;
+    const ssize_t releasedSize = s->state.pArena->priv.pos - s->state.pos;
+    K_ASAN_POISON(pReleased, releasedSize);
+    if (s->state.pArena->priv.bGuardPages) guard(pReleased, releasedSize);
+
     s->state.pArena->priv.pos = s->state.pos;
     s->state.pArena->priv.pLastAlloc = s->state.pLastAlloc;
     s->state.pArena->priv.pLCurrentDeleters = s->state.pLCurrentDeleters;
+
+    /* Back to the holes from before the scope, minus what pre-scope blocks grew or moved into (see claimFromScopes()):
+     * pLastAlloc can't end up inside a hole, and holes used by released blocks are free again. */
+    k_Arena* pArena = s->state.pArena;
+    pArena->priv.pScope = s->state.pPrevScope;
+    for (ssize_t i = 0; i < s->state.nHoles; ++i)
+        K_ASAN_POISON((uint8_t*)pArena->priv.pData + s->state.aHoles[i].off, s->state.aHoles[i].size);
+    pArena->priv.nHoles = s->state.nHoles;
+    memcpy(pArena->priv.aHoles, s->state.aHoles, sizeof(k_ArenaHole) * s->state.nHoles);
 }
@@ -20,6 +20,56 @@ typedef struct k_ArenaPtrAllocOpts
     k_ArenaDeleterPfn pfnDeleter; /* k_nullDeleter if NULL. */
 } k_ArenaPtrAllocOpts;
 
+typedef uint8_t K_ARENA_PAGES;
+static const uint8_t K_ARENA_PAGES_DEFAULT = 0; /* Regular system pages. */
+static const uint8_t K_ARENA_PAGES_HUGE_TRANSPARENT = 1; /* 2M aligned reservation + madvise(MADV_HUGEPAGE), if THP isn't set to never. */
+static const uint8_t K_ARENA_PAGES_HUGE_EXPLICIT = 2; /* MAP_HUGETLB, falls back to transparent, then to default. */
+
+#define K_ARENA_HUGE_PAGE_SIZE (K_SIZE_1M * 2)
+
+#define K_ARENA_HOLES_CAP 16
+#define K_ARENA_HOLE_MIN_SIZE 64 /* Smaller holes are not worth tracking. */
+
+#ifdef K_ASAN
+    #define K_ARENA_REDZONE_SIZE 16 /* Poisoned bytes after each block. */
+#else
+    #define K_ARENA_REDZONE_SIZE 0
+#endif
+
+#define K_ARENA_TRIM_WINDOW_CAP 32 /* Max number of resets k_ArenaTrim() looks back at. */
+
+/* Space left behind when k_ArenaRealloc() has to move a block. */
+typedef struct k_ArenaHole
+{
+    ssize_t off;
+    ssize_t size;
+} k_ArenaHole;
+
+/* Self-relative pointer, stays valid when a k_ArenaInitOpts.ntsFilePath arena is mapped at a different address.
+ * Zero offset is NULL, so it can't point to itself. */
+typedef struct k_OffPtr
+{
+    int64_t off;
+} k_OffPtr;
+
+static inline void* k_OffPtrGet(const k_OffPtr* s) { return s->off ? (uint8_t*)s + s->off : NULL; }
+static inline void k_OffPtrSet(k_OffPtr* s, const void* p) { s->off = p ? (uint8_t*)p - (uint8_t*)s : 0; }
+
+#define K_OFF_PTR_GET(type, pOffPtr) ((type*)k_OffPtrGet(pOffPtr))
+
+struct k_ArenaFileHeader;
+struct k_ArenaState;
+
+typedef struct k_ArenaInitOpts
+{
+    ssize_t reserveSize;
+    ssize_t commitSize;
+    K_ARENA_PAGES ePages; /* Requested backing, k_ArenaPages() reports what was actually used. */
+    ssize_t trimResets; /* If > 0, k_ArenaReset() decommits everything above the high-water of the last trimResets resets. */
+    const char* ntsFilePathOrNull; /* Back by a shared file mapping of reserveSize bytes, reopening restores the contents. */
+    bool bGuardPages; /* Debug: every block gets own pages followed by an inaccessible one, released pages become inaccessible. */
+} k_ArenaInitOpts;
+
 typedef struct
 {
     k_IAllocator base;
@@ -30,13 +80,27 @@ typedef struct
         ssize_t pos;
         ssize_t reserved;
         ssize_t commited;
+        ssize_t commitGranule; /* Page size or K_ARENA_HUGE_PAGE_SIZE. */
+        K_ARENA_PAGES ePages;
         void* pLastAlloc;
         k_ArenaPtr* lDeleters;
         k_ArenaPtr** pLCurrentDeleters;
+        k_ArenaHole aHoles[K_ARENA_HOLES_CAP]; /* Reused by bigger mallocs and by reallocs of neighbouring blocks. */
+        ssize_t nHoles;
+        struct k_ArenaState* pScope; /* Innermost pushed state, NULL outside of scopes. */
+        ssize_t minCommit; /* Initial commitSize, never trimmed below. */
+        ssize_t highWater; /* Max pos since the last trim. */
+        ssize_t aTrimWindow[K_ARENA_TRIM_WINDOW_CAP]; /* High-water of previous trims, ring buffer. */
+        ssize_t trimWindowSize;
+        ssize_t trimWindowI;
+        struct k_ArenaFileHeader* pFileHeader; /* First page of the file mapping, NULL if not file backed. */
+        bool bFileRelocated; /* Mapped at a different address than the file was created at, raw pointers are invalid. */
+        bool bGuardPages;
     } priv;
 } k_Arena;
 
 bool k_ArenaInit(k_Arena* s, ssize_t reserveSize, ssize_t commitSize);
+bool k_ArenaInitWithOpts(k_Arena* s, k_ArenaInitOpts opts);
 K_NO_DISCARD void* k_ArenaMalloc(void* s, ssize_t nBytes);
 K_NO_DISCARD void* k_ArenaZalloc(void* s, ssize_t nBytes);
 K_NO_DISCARD void* k_ArenaRealloc(void* s, void* p, ssize_t oldNBytes, ssize_t newNBytes);
@@ -45,10 +109,18 @@ void k_ArenaDestroy(k_Arena* s);
 void k_ArenaReset(k_Arena* s);
 void k_ArenaResetDecommit(k_Arena* s);
 void k_ArenaResetToPage(k_Arena* s, ssize_t nthPage);
+void k_ArenaTrim(k_Arena* s); /* Ends a trim cycle: decommits the tail above k_ArenaHighWater(). */
+ssize_t k_ArenaHighWater(k_Arena* s); /* Max pos over the current cycle and the last trimResets ones. */
+bool k_ArenaFileSync(k_Arena* s); /* Stores pos in the file header and flushes the mapping. Destroy syncs too. */
+void* k_ArenaFileRoot(k_Arena* s); /* NULL if not set. */
+void k_ArenaFileSetRoot(k_Arena* s, void* p); /* Entry point to find the data after reopening. */
+static inline bool k_ArenaFileRelocated(k_Arena* s);
 void k_ArenaRunDeleters(k_Arena* s);
 bool k_ArenaPtrAlloc(k_Arena* s, k_ArenaPtrAllocOpts opts);
 static inline ssize_t k_ArenaMemoryReserved(k_Arena* s);
 static inline ssize_t k_ArenaMemoryUsed(k_Arena* s);
+static inline ssize_t k_ArenaMemoryCommitted(k_Arena* s);
+static inline K_ARENA_PAGES k_ArenaPages(k_Arena* s); /* Backing that k_ArenaInitWithOpts() actually got. */
 
 static inline void*
 k_ArenaAlloc(void* pSelf, void* p, ssize_t size)
@@ -71,9 +143,27 @@ k_ArenaMemoryUsed(k_Arena* s)
     return s->priv.pos;
 }
 
+static inline ssize_t
+k_ArenaMemoryCommitted(k_Arena* s)
+{
+    return s->priv.commited;
+}
+
+static inline bool
+k_ArenaFileRelocated(k_Arena* s)
+{
+    return s->priv.bFileRelocated;
+}
+
+static inline K_ARENA_PAGES
+k_ArenaPages(k_Arena* s)
+{
+    return s->priv.ePages;
+}
+
 #define K_ARENA_ALLOC(pArena, type, ...) (type*)k_ArenaAlloc(pArena, &(type) {__VA_ARGS__}, sizeof(type))
 
-typedef struct
+typedef struct k_ArenaState
 {
     struct
     {
@@ -81,6 +171,9 @@ typedef struct
         ssize_t pos;
         void* pLastAlloc;
         k_ArenaPtr** pLCurrentDeleters;
+        k_ArenaHole aHoles[K_ARENA_HOLES_CAP]; /* Holes taken inside the scope are given back on restore. */
+        ssize_t nHoles;
+        struct k_ArenaState* pPrevScope;
     } state;
     k_ArenaPtr* lDeleters; /* New list. */
 } k_ArenaState;
@@ -0,0 +1,199 @@
+#include "ArenaConcurrent.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+#if defined __unix__
+    #define K_ARENA_MMAP
+    #include <sys/mman.h>
+#elif defined _WIN32
+    #define K_ARENA_WIN32
+#else
+    #warning "ArenaConcurrent is not implemented"
+#endif
+
+static bool
+commit(void* p, ssize_t size)
+{
+#ifdef K_ARENA_MMAP
+    if (mprotect(p, size, PROT_READ | PROT_WRITE) == -1)
+        return false;
+#elif defined K_ARENA_WIN32
+    if (!VirtualAlloc(p, size, MEM_COMMIT, PAGE_READWRITE))
+        return false;
+#else
+#endif
+
+    return true;
+}
+
+/* Slow path, pos is already bumped past newPos by the caller. */
+static bool
+growIfNeeded(k_ArenaConcurrent* pSelf, ssize_t newPos)
+{
+    K_TYPEOF(pSelf->priv)* s = &pSelf->priv;
+
+    if (newPos > s->reserved) return false;
+
+    bool bOk = true;
+    k_MutexLock(&s->mtxCommit);
+    {
+        const ssize_t commited = k_AtomicSsizeLoadRelaxed(&s->atomCommited);
+        if (newPos > commited)
+        {
+            const ssize_t aligned = K_ALIGN_UP_PO2(newPos, k_getPageSize());
+            const ssize_t newCommited = K_MIN(K_MAX(aligned, commited * 2), s->reserved);
+            bOk = commit((uint8_t*)s->pData + commited, newCommited - commited);
+            if (bOk) k_AtomicSsizeStoreRelease(&s->atomCommited, newCommited);
+        }
+    }
+    k_MutexUnlock(&s->mtxCommit);
+
+    return bOk;
+}
+
+/* Gives a failed bump back, which only works if nobody bumped after it. Otherwise pos stays past the end until reset. */
+static void
+rollBack(k_ArenaConcurrent* s, ssize_t bumpedPos, ssize_t pos)
+{
+    ssize_t expected = bumpedPos;
+    k_AtomicSsizeCasAcqRel(&s->priv.atomPos, &expected, pos);
+}
+
+bool
+k_ArenaConcurrentInit(k_ArenaConcurrent* s, ssize_t reserveSize, ssize_t commitSize)
+{
+    static const k_IAllocatorVTable s_vTable = {
+        .malloc = k_ArenaConcurrentMalloc,
+        .zalloc = k_ArenaConcurrentZalloc,
+        .realloc = k_ArenaConcurrentRealloc,
+        .free = k_ArenaConcurrentFree,
+    };
+    s->base.pVTable = &s_vTable;
+    s->priv.pData = NULL;
+
+    assert(reserveSize > 0);
+
+    const ssize_t pageSize = k_getPageSize();
+    const ssize_t realReserved = K_ALIGN_UP_PO2(reserveSize, pageSize);
+
+#ifdef K_ARENA_MMAP
+    void* pRes = mmap(NULL, realReserved, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (pRes == MAP_FAILED) return false;
+#elif defined K_ARENA_WIN32
+    void* pRes = VirtualAlloc(NULL, realReserved, MEM_RESERVE, PAGE_READWRITE);
+    if (!pRes) return false;
+#else
+    void* pRes = NULL;
+    return false;
+#endif
+
+    s->priv.pData = pRes;
+    s->priv.atomPos.volNum = 0;
+    s->priv.atomCommited.volNum = 0;
+    s->priv.reserved = realReserved;
+    if (!k_MutexInitPlain(&s->priv.mtxCommit)) goto fail;
+
+    if (commitSize > 0)
+    {
+        const ssize_t realCommit = K_MIN(K_ALIGN_UP_PO2(commitSize, pageSize), realReserved);
+        if (!commit(s->priv.pData, realCommit))
+        {
+            k_MutexDestroy(&s->priv.mtxCommit);
+            goto fail;
+        }
+        s->priv.atomCommited.volNum = realCommit;
+    }
+
+    return true;
+
+fail:
+#ifdef K_ARENA_MMAP
+    munmap(pRes, realReserved);
+#elif defined K_ARENA_WIN32
+    VirtualFree(pRes, 0, MEM_RELEASE);
+#endif
+    s->priv.pData = NULL;
+    return false;
+}
+
+void
+k_ArenaConcurrentDestroy(k_ArenaConcurrent* s)
+{
+    if (!s->priv.pData) return;
+
+#ifdef K_ARENA_MMAP
+    int err = munmap(s->priv.pData, s->priv.reserved);
+    (void)err;
+    assert(err != -1);
+#elif defined K_ARENA_WIN32
+    VirtualFree(s->priv.pData, 0, MEM_RELEASE);
+#else
+#endif
+
+    k_MutexDestroy(&s->priv.mtxCommit);
+    *s = (k_ArenaConcurrent){0};
+}
+
+void*
+k_ArenaConcurrentMalloc(void* pSelf, ssize_t nBytes)
+{
+    k_ArenaConcurrent* s = (k_ArenaConcurrent*)pSelf;
+    const ssize_t realSize = K_ALIGN_UP8(nBytes);
+    const ssize_t pos = k_AtomicSsizeFetchAddRelaxed(&s->priv.atomPos, realSize);
+    const ssize_t newPos = pos + realSize;
+
+    if (newPos > k_AtomicSsizeLoadAcquire(&s->priv.atomCommited))
+    {
+        if (!growIfNeeded(s, newPos))
+        {
+            rollBack(s, newPos, pos);
+            return NULL;
+        }
+    }
+
+    return (uint8_t*)s->priv.pData + pos;
+}
+
+void*
+k_ArenaConcurrentZalloc(void* s, ssize_t nBytes)
+{
+    void* pMem = k_ArenaConcurrentMalloc(s, nBytes);
+    if (pMem) memset(pMem, 0, nBytes);
+    return pMem;
+}
+
+void*
+k_ArenaConcurrentRealloc(void* pSelf, void* p, ssize_t oldNBytes, ssize_t newNBytes)
+{
+    k_ArenaConcurrent* s = (k_ArenaConcurrent*)pSelf;
+    if (!p) return k_ArenaConcurrentMalloc(s, newNBytes);
+    if (newNBytes <= oldNBytes) return p;
+
+    /* Try to extend in place if nobody allocated after p. */
+    const ssize_t off = (uint8_t*)p - (uint8_t*)s->priv.pData;
+    ssize_t expected = off + K_ALIGN_UP8(oldNBytes);
+    const ssize_t newPos = off + K_ALIGN_UP8(newNBytes);
+    if (newPos <= s->priv.reserved && k_AtomicSsizeCasAcqRel(&s->priv.atomPos, &expected, newPos))
+    {
+        if (newPos > k_AtomicSsizeLoadAcquire(&s->priv.atomCommited))
+        {
+            if (!growIfNeeded(s, newPos))
+            {
+                rollBack(s, newPos, off + K_ALIGN_UP8(oldNBytes));
+                return NULL;
+            }
+        }
+        return p;
+    }
+
+    void* pMem = k_ArenaConcurrentMalloc(s, newNBytes);
+    if (pMem) memcpy(pMem, p, oldNBytes);
+    return pMem;
+}
+
+void
+k_ArenaConcurrentReset(k_ArenaConcurrent* s)
+{
+    k_AtomicSsizeStoreRelease(&s->priv.atomPos, 0);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "IAllocator.h"
+#include "Thread.h"
+#include "atomic.h"
+
+/* Thread safe bump allocator. Allocations only do one atomic add, committing new pages takes a mutex.
+ * A failed allocation takes its bump back, unless another thread allocated in the meantime: then pos stays past
+ * the reserve and every allocation fails until k_ArenaConcurrentReset(). */
+typedef struct k_ArenaConcurrent
+{
+    k_IAllocator base;
+
+    struct
+    {
+        void* pData;
+        k_atomic_Ssize atomPos;
+        k_atomic_Ssize atomCommited;
+        ssize_t reserved;
+        k_Mutex mtxCommit;
+    } priv;
+} k_ArenaConcurrent;
+
+bool k_ArenaConcurrentInit(k_ArenaConcurrent* s, ssize_t reserveSize, ssize_t commitSize);
+void k_ArenaConcurrentDestroy(k_ArenaConcurrent* s);
+K_NO_DISCARD void* k_ArenaConcurrentMalloc(void* s, ssize_t nBytes);
+K_NO_DISCARD void* k_ArenaConcurrentZalloc(void* s, ssize_t nBytes);
+K_NO_DISCARD void* k_ArenaConcurrentRealloc(void* s, void* p, ssize_t oldNBytes, ssize_t newNBytes);
+static inline void k_ArenaConcurrentFree(void* s, void* ptr) { (void)s, (void)ptr; /* noop */ }
+void k_ArenaConcurrentReset(k_ArenaConcurrent* s); /* NOTE: No allocations should be in flight. */
+static inline ssize_t k_ArenaConcurrentMemoryReserved(k_ArenaConcurrent* s);
+static inline ssize_t k_ArenaConcurrentMemoryUsed(k_ArenaConcurrent* s);
+
+static inline ssize_t
+k_ArenaConcurrentMemoryReserved(k_ArenaConcurrent* s)
+{
+    return s->priv.reserved;
+}
+
+static inline ssize_t
+k_ArenaConcurrentMemoryUsed(k_ArenaConcurrent* s)
+{
+    return K_MIN(k_AtomicSsizeLoadAcquire(&s->priv.atomPos), s->priv.reserved);
+}
@@ -0,0 +1,542 @@
+#include "MapDecl.h"
+#include "IAllocator.h"
+
+#include <assert.h>
+
+#ifndef K_NAME
+    #error "K_NAME is not defined"
+#endif
+
+#ifndef K_KEY_T
+    #error "K_KEY_T is not defined"
+#endif
+
+#ifndef K_VALUE_T
+    #error "K_VALUE_T is not defined"
+#endif
+
+#ifndef K_FN_KEY_CMP
+    #error "K_FN_KEY_CMP is not defined" /* Ordering: < 0, 0, > 0. */
+#endif
+
+#ifndef K_BTREE_LEAF_CAP
+    #define K_BTREE_LEAF_CAP 32
+#endif
+
+#ifndef K_BTREE_INNER_CAP
+    #define K_BTREE_INNER_CAP 32 /* Separator keys, K_BTREE_INNER_CAP + 1 children. */
+#endif
+
+#ifndef K_DECL_MOD
+    #define K_DECL_MOD static inline
+#endif
+
+#if !defined K_GEN_DECLS && !defined K_GEN_CODE
+    #define K_GEN_DECLS
+    #define K_GEN_CODE
+#endif
+
+/* B+-tree ordered map. Keys and values live in leaves, kept in key order and linked for range iteration,
+ * inner nodes only hold separators (child i + 1 has keys >= aKeys[i]).
+ * Node arrays have one spare slot, so inserts overflow a node first and split it afterwards.
+ * Remove doesn't merge underfull nodes, Compact() rebuilds the tree if that matters. */
+
+#define K_METHOD(M) K_GLUE(K_NAME, M)
+#define K_NODE K_METHOD(Node)
+#define K_LEAF K_METHOD(Leaf)
+#define K_INNER K_METHOD(Inner)
+#define K_IT K_METHOD(It)
+#define K_SPLIT K_METHOD(Split)
+
+#ifdef K_GEN_DECLS
+
+typedef struct K_NODE
+{
+    int32_t nKeys;
+    bool bLeaf;
+} K_NODE;
+
+typedef struct K_LEAF
+{
+    K_NODE base;
+    struct K_LEAF* pNext;
+    K_KEY_T aKeys[K_BTREE_LEAF_CAP + 1];
+    K_VALUE_T aValues[K_BTREE_LEAF_CAP + 1];
+} K_LEAF;
+
+typedef struct K_INNER
+{
+    K_NODE base;
+    K_KEY_T aKeys[K_BTREE_INNER_CAP + 1];
+    K_NODE* apChildren[K_BTREE_INNER_CAP + 2];
+} K_INNER;
+
+typedef struct K_IT
+{
+    K_LEAF* pLeaf; /* NULL at the end. */
+    int32_t i;
+} K_IT;
+
+typedef struct K_NAME
+{
+    K_NODE* pRoot;
+    K_LEAF* pFirst;
+    ssize_t size;
+    int height; /* 1 if the root is a leaf. */
+} K_NAME;
+
+typedef struct K_SPLIT
+{
+    K_KEY_T key;
+    K_NODE* pRight; /* NULL if no split. */
+} K_SPLIT;
+
+K_DECL_MOD void K_METHOD(Destroy)(K_NAME* pSelf, k_IAllocator* pAlloc);
+K_DECL_MOD K_MAP_RESULT_STATUS K_METHOD(Insert)(K_NAME* pSelf, k_IAllocator* pAlloc, const K_KEY_T* pKey, const K_VALUE_T* pVal); /* Overwrites. */
+K_DECL_MOD K_VALUE_T* K_METHOD(Search)(K_NAME* pSelf, const K_KEY_T* pKey); /* NULL if absent. */
+K_DECL_MOD bool K_METHOD(Remove)(K_NAME* pSelf, const K_KEY_T* pKey);
+
+/* Sorted, strictly increasing pKeys. Replaces the contents, leaves are filled completely. */
+K_DECL_MOD bool K_METHOD(BulkLoad)(K_NAME* pSelf, k_IAllocator* pAlloc, const K_KEY_T* pKeys, const K_VALUE_T* pVals, ssize_t n);
+K_DECL_MOD bool K_METHOD(Compact)(K_NAME* pSelf, k_IAllocator* pAlloc);
+
+K_DECL_MOD K_IT K_METHOD(Begin)(K_NAME* pSelf);
+K_DECL_MOD K_IT K_METHOD(LowerBound)(K_NAME* pSelf, const K_KEY_T* pKey); /* First key >= pKey. */
+K_DECL_MOD K_IT K_METHOD(UpperBound)(K_NAME* pSelf, const K_KEY_T* pKey); /* First key > pKey. */
+K_DECL_MOD void K_METHOD(ItNext)(K_IT* pIt);
+static inline bool K_METHOD(ItValid)(K_IT it) { return it.pLeaf != NULL; }
+static inline K_KEY_T* K_METHOD(ItKey)(K_IT it) { return &it.pLeaf->aKeys[it.i]; }
+static inline K_VALUE_T* K_METHOD(ItValue)(K_IT it) { return &it.pLeaf->aValues[it.i]; }
+
+#endif /* K_GEN_DECLS */
+
+#ifdef K_GEN_CODE
+
+/* First i with aKeys[i] >= key. */
+static inline int32_t
+K_METHOD(LowerI)(const K_KEY_T* aKeys, int32_t n, const K_KEY_T* pKey)
+{
+    int32_t lo = 0, hi = n;
+    while (lo < hi)
+    {
+        const int32_t mid = lo + (hi - lo) / 2;
+        if (K_FN_KEY_CMP(&aKeys[mid], pKey) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+/* First i with aKeys[i] > key, which is also the child to descend into. */
+static inline int32_t
+K_METHOD(UpperI)(const K_KEY_T* aKeys, int32_t n, const K_KEY_T* pKey)
+{
+    int32_t lo = 0, hi = n;
+    while (lo < hi)
+    {
+        const int32_t mid = lo + (hi - lo) / 2;
+        if (K_FN_KEY_CMP(&aKeys[mid], pKey) <= 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static inline K_LEAF*
+K_METHOD(FindLeaf)(K_NAME* pSelf, const K_KEY_T* pKey)
+{
+    K_NODE* pNode = pSelf->pRoot;
+    if (!pNode) return NULL;
+
+    while (!pNode->bLeaf)
+    {
+        K_INNER* pInner = (K_INNER*)pNode;
+        pNode = pInner->apChildren[K_METHOD(UpperI)(pInner->aKeys, pNode->nKeys, pKey)];
+    }
+
+    return (K_LEAF*)pNode;
+}
+
+static inline void
+K_METHOD(DestroyNode)(K_NODE* pNode, k_IAllocator* pAlloc)
+{
+    if (!pNode->bLeaf)
+    {
+        K_INNER* pInner = (K_INNER*)pNode;
+        for (int32_t i = 0; i <= pNode->nKeys; ++i)
+            K_METHOD(DestroyNode)(pInner->apChildren[i], pAlloc);
+    }
+
+    k_IAllocatorFree(pAlloc, pNode);
+}
+
+K_DECL_MOD void
+K_METHOD(Destroy)(K_NAME* pSelf, k_IAllocator* pAlloc)
+{
+    if (pSelf->pRoot) K_METHOD(DestroyNode)(pSelf->pRoot, pAlloc);
+    *pSelf = (K_NAME){0};
+}
+
+/* Nodes for all the splits one insert causes, allocated before the tree is touched. */
+typedef struct K_METHOD(Spare)
+{
+    K_LEAF* pLeaf;
+    K_INNER* apInner[64]; /* Every inner node has 2+ children, the height can't get near 64. */
+    int nInner;
+} K_METHOD(Spare);
+
+/* pKey isn't in the tree yet. */
+static inline void
+K_METHOD(InsertRec)(K_NODE* pNode, K_METHOD(Spare)* pSpare, const K_KEY_T* pKey, const K_VALUE_T* pVal, K_SPLIT* pSplit)
+{
+    pSplit->pRight = NULL;
+
+    if (pNode->bLeaf)
+    {
+        K_LEAF* pLeaf = (K_LEAF*)pNode;
+        const int32_t n = pNode->nKeys;
+        const int32_t i = K_METHOD(LowerI)(pLeaf->aKeys, n, pKey);
+
+        memmove(&pLeaf->aKeys[i + 1], &pLeaf->aKeys[i], sizeof(K_KEY_T) * (n - i));
+        memmove(&pLeaf->aValues[i + 1], &pLeaf->aValues[i], sizeof(K_VALUE_T) * (n - i));
+        pLeaf->aKeys[i] = *pKey;
+        pLeaf->aValues[i] = *pVal;
+        ++pNode->nKeys;
+
+        if (pNode->nKeys > K_BTREE_LEAF_CAP)
+        {
+            K_LEAF* pRight = pSpare->pLeaf;
+            pSpare->pLeaf = NULL;
+            assert(pRight);
+
+            const int32_t leftN = pNode->nKeys / 2;
+            const int32_t rightN = pNode->nKeys - leftN;
+
+            pRight->base = (K_NODE){.nKeys = rightN, .bLeaf = true};
+            memcpy(pRight->aKeys, &pLeaf->aKeys[leftN], sizeof(K_KEY_T) * rightN);
+            memcpy(pRight->aValues, &pLeaf->aValues[leftN], sizeof(K_VALUE_T) * rightN);
+            pRight->pNext = pLeaf->pNext;
+            pLeaf->pNext = pRight;
+            pNode->nKeys = leftN;
+
+            pSplit->key = pRight->aKeys[0];
+            pSplit->pRight = &pRight->base;
+        }
+
+        return;
+    }
+
+    K_INNER* pInner = (K_INNER*)pNode;
+    const int32_t childI = K_METHOD(UpperI)(pInner->aKeys, pNode->nKeys, pKey);
+
+    K_SPLIT childSplit;
+    K_METHOD(InsertRec)(pInner->apChildren[childI], pSpare, pKey, pVal, &childSplit);
+    if (!childSplit.pRight) return;
+
+    const int32_t n = pNode->nKeys;
+    memmove(&pInner->aKeys[childI + 1], &pInner->aKeys[childI], sizeof(K_KEY_T) * (n - childI));
+    memmove(&pInner->apChildren[childI + 2], &pInner->apChildren[childI + 1], sizeof(K_NODE*) * (n - childI));
+    pInner->aKeys[childI] = childSplit.key;
+    pInner->apChildren[childI + 1] = childSplit.pRight;
+    ++pNode->nKeys;
+
+    if (pNode->nKeys > K_BTREE_INNER_CAP)
+    {
+        assert(pSpare->nInner > 0);
+        K_INNER* pRight = pSpare->apInner[--pSpare->nInner];
+
+        /* Middle separator moves up, it isn't kept in either half. */
+        const int32_t midI = pNode->nKeys / 2;
+        const int32_t rightN = pNode->nKeys - midI - 1;
+
+        pRight->base = (K_NODE){.nKeys = rightN, .bLeaf = false};
+        memcpy(pRight->aKeys, &pInner->aKeys[midI + 1], sizeof(K_KEY_T) * rightN);
+        memcpy(pRight->apChildren, &pInner->apChildren[midI + 1], sizeof(K_NODE*) * (rightN + 1));
+        pNode->nKeys = midI;
+
+        pSplit->key = pInner->aKeys[midI];
+        pSplit->pRight = &pRight->base;
+    }
+}
+
+K_DECL_MOD K_MAP_RESULT_STATUS
+K_METHOD(Insert)(K_NAME* pSelf, k_IAllocator* pAlloc, const K_KEY_T* pKey, const K_VALUE_T* pVal)
+{
+    if (!pSelf->pRoot)
+    {
+        K_LEAF* pLeaf = k_IAllocatorZalloc(pAlloc, sizeof(K_LEAF));
+        if (!pLeaf) return K_MAP_RESULT_STATUS_FAILED;
+
+        pLeaf->base.bLeaf = true;
+        pSelf->pRoot = &pLeaf->base;
+        pSelf->pFirst = pLeaf;
+        pSelf->height = 1;
+    }
+
+    /* Walk down once: overwrite in place, or count the full nodes that will split right above the leaf. */
+    K_NODE* pNode = pSelf->pRoot;
+    int nFullRun = 0;
+    while (!pNode->bLeaf)
+    {
+        K_INNER* pInner = (K_INNER*)pNode;
+        nFullRun = pNode->nKeys >= K_BTREE_INNER_CAP ? nFullRun + 1 : 0;
+        pNode = pInner->apChildren[K_METHOD(UpperI)(pInner->aKeys, pNode->nKeys, pKey)];
+    }
+
+    K_LEAF* pLeaf = (K_LEAF*)pNode;
+    const int32_t i = K_METHOD(LowerI)(pLeaf->aKeys, pNode->nKeys, pKey);
+    if (i < pNode->nKeys && K_FN_KEY_CMP(&pLeaf->aKeys[i], pKey) == 0)
+    {
+        pLeaf->aValues[i] = *pVal;
+        return K_MAP_RESULT_STATUS_FOUND;
+    }
+
+    /* Allocate everything up front, so running out of memory leaves the tree as it was. */
+    K_METHOD(Spare) spare = {0};
+    if (pNode->nKeys >= K_BTREE_LEAF_CAP)
+    {
+        const bool bNewRoot = nFullRun == pSelf->height - 1;
+        const int nInner = nFullRun + bNewRoot;
+        assert(nInner <= (int)K_ASIZE(spare.apInner));
+
+        spare.pLeaf = k_IAllocatorMalloc(pAlloc, sizeof(K_LEAF));
+        for (; spare.pLeaf && spare.nInner < nInner; ++spare.nInner)
+        {
+            spare.apInner[spare.nInner] = k_IAllocatorMalloc(pAlloc, sizeof(K_INNER));
+            if (!spare.apInner[spare.nInner]) break;
+        }
+
+        if (!spare.pLeaf || spare.nInner < nInner)
+        {
+            for (int j = 0; j < spare.nInner; ++j) k_IAllocatorFree(pAlloc, spare.apInner[j]);
+            if (spare.pLeaf) k_IAllocatorFree(pAlloc, spare.pLeaf);
+            return K_MAP_RESULT_STATUS_FAILED;
+        }
+    }
+
+    K_SPLIT split;
+    K_METHOD(InsertRec)(pSelf->pRoot, &spare, pKey, pVal, &split);
+    ++pSelf->size;
+
+    if (split.pRight)
+    {
+        assert(spare.nInner == 1);
+        K_INNER* pNewRoot = spare.apInner[--spare.nInner];
+
+        pNewRoot->base = (K_NODE){.nKeys = 1, .bLeaf = false};
+        pNewRoot->aKeys[0] = split.key;
+        pNewRoot->apChildren[0] = pSelf->pRoot;
+        pNewRoot->apChildren[1] = split.pRight;
+        pSelf->pRoot = &pNewRoot->base;
+        ++pSelf->height;
+    }
+    assert(spare.nInner == 0 && !spare.pLeaf);
+
+    return K_MAP_RESULT_STATUS_INSERTED;
+}
+
+K_DECL_MOD K_VALUE_T*
+K_METHOD(Search)(K_NAME* pSelf, const K_KEY_T* pKey)
+{
+    K_LEAF* pLeaf = K_METHOD(FindLeaf)(pSelf, pKey);
+    if (!pLeaf) return NULL;
+
+    const int32_t i = K_METHOD(LowerI)(pLeaf->aKeys, pLeaf->base.nKeys, pKey);
+    if (i < pLeaf->base.nKeys && K_FN_KEY_CMP(&pLeaf->aKeys[i], pKey) == 0)
+        return &pLeaf->aValues[i];
+
+    return NULL;
+}
+
+K_DECL_MOD bool
+K_METHOD(Remove)(K_NAME* pSelf, const K_KEY_T* pKey)
+{
+    K_LEAF* pLeaf = K_METHOD(FindLeaf)(pSelf, pKey);
+    if (!pLeaf) return false;
+
+    const int32_t n = pLeaf->base.nKeys;
+    const int32_t i = K_METHOD(LowerI)(pLeaf->aKeys, n, pKey);
+    if (i >= n || K_FN_KEY_CMP(&pLeaf->aKeys[i], pKey) != 0) return false;
+
+    /* Separators above stay valid bounds, empty leaves are skipped by iteration. */
+    memmove(&pLeaf->aKeys[i], &pLeaf->aKeys[i + 1], sizeof(K_KEY_T) * (n - i - 1));
+    memmove(&pLeaf->aValues[i], &pLeaf->aValues[i + 1], sizeof(K_VALUE_T) * (n - i - 1));
+    --pLeaf->base.nKeys;
+    --pSelf->size;
+
+    return true;
+}
+
+K_DECL_MOD bool
+K_METHOD(BulkLoad)(K_NAME* pSelf, k_IAllocator* pAlloc, const K_KEY_T* pKeys, const K_VALUE_T* pVals, ssize_t n)
+{
+    K_METHOD(Destroy)(pSelf, pAlloc);
+    if (n <= 0) return true;
+
+    /* Level being built: nodes and the smallest key under each. */
+    ssize_t levelSize = (n + K_BTREE_LEAF_CAP - 1) / K_BTREE_LEAF_CAP;
+    K_NODE** apLevel = K_IMALLOC_T(pAlloc, K_NODE*, levelSize);
+    K_KEY_T* aMinKeys = K_IMALLOC_T(pAlloc, K_KEY_T, levelSize);
+    if (!apLevel || !aMinKeys) goto fail;
+
+    K_LEAF* pPrev = NULL;
+    for (ssize_t leafI = 0; leafI < levelSize; ++leafI)
+    {
+        K_LEAF* pLeaf = k_IAllocatorMalloc(pAlloc, sizeof(K_LEAF));
+        if (!pLeaf)
+        {
+            levelSize = leafI;
+            goto failLevel;
+        }
+
+        const ssize_t off = leafI * K_BTREE_LEAF_CAP;
+        const int32_t leafN = (int32_t)K_MIN(K_BTREE_LEAF_CAP, n - off);
+        pLeaf->base = (K_NODE){.nKeys = leafN, .bLeaf = true};
+        pLeaf->pNext = NULL;
+        memcpy(pLeaf->aKeys, &pKeys[off], sizeof(K_KEY_T) * leafN);
+        memcpy(pLeaf->aValues, &pVals[off], sizeof(K_VALUE_T) * leafN);
+
+        if (pPrev) pPrev->pNext = pLeaf;
+        else pSelf->pFirst = pLeaf;
+        pPrev = pLeaf;
+
+        apLevel[leafI] = &pLeaf->base;
+        aMinKeys[leafI] = pKeys[off];
+    }
+    pSelf->height = 1;
+
+    /* Group K_BTREE_INNER_CAP + 1 children per parent, in place: the parent level is always shorter. */
+    while (levelSize > 1)
+    {
+        const ssize_t fanout = K_BTREE_INNER_CAP + 1;
+        const ssize_t parentSize = (levelSize + fanout - 1) / fanout;
+
+        for (ssize_t parentI = 0; parentI < parentSize; ++parentI)
+        {
+            K_INNER* pInner = k_IAllocatorMalloc(pAlloc, sizeof(K_INNER));
+            if (!pInner)
+            {
+                /* Children from parentI * fanout on are still unattached, free them with the built parents. */
+                for (ssize_t i = parentI * fanout; i < levelSize; ++i)
+                    K_METHOD(DestroyNode)(apLevel[i], pAlloc);
+                levelSize = parentI;
+                goto failLevel;
+            }
+
+            const ssize_t off = parentI * fanout;
+            const int32_t nChildren = (int32_t)K_MIN(fanout, levelSize - off);
+            pInner->base = (K_NODE){.nKeys = nChildren - 1, .bLeaf = false};
+            for (int32_t i = 0; i < nChildren; ++i)
+            {
+                pInner->apChildren[i] = apLevel[off + i];
+                if (i > 0) pInner->aKeys[i - 1] = aMinKeys[off + i];
+            }
+
+            apLevel[parentI] = &pInner->base;
+            aMinKeys[parentI] = aMinKeys[off];
+        }
+
+        levelSize = parentSize;
+        ++pSelf->height;
+    }
+
+    pSelf->pRoot = apLevel[0];
+    pSelf->size = n;
+    k_IAllocatorFree(pAlloc, aMinKeys);
+    k_IAllocatorFree(pAlloc, apLevel);
+    return true;
+
+failLevel:
+    for (ssize_t i = 0; i < levelSize; ++i)
+        K_METHOD(DestroyNode)(apLevel[i], pAlloc);
+fail:
+    k_IAllocatorFree(pAlloc, aMinKeys);
+    k_IAllocatorFree(pAlloc, apLevel);
+    *pSelf = (K_NAME){0};
+    return false;
+}
+
+K_DECL_MOD bool
+K_METHOD(Compact)(K_NAME* pSelf, k_IAllocator* pAlloc)
+{
+    const ssize_t n = pSelf->size;
+    K_KEY_T* aKeys = K_IMALLOC_T(pAlloc, K_KEY_T, K_MAX(1, n));
+    K_VALUE_T* aVals = K_IMALLOC_T(pAlloc, K_VALUE_T, K_MAX(1, n));
+    bool bOk = false;
+    if (!aKeys || !aVals) goto done;
+
+    ssize_t i = 0;
+    for (K_IT it = K_METHOD(Begin)(pSelf); K_METHOD(ItValid)(it); K_METHOD(ItNext)(&it), ++i)
+    {
+        aKeys[i] = *K_METHOD(ItKey)(it);
+        aVals[i] = *K_METHOD(ItValue)(it);
+    }
+
+    bOk = K_METHOD(BulkLoad)(pSelf, pAlloc, aKeys, aVals, n);
+
+done:
+    k_IAllocatorFree(pAlloc, aVals);
+    k_IAllocatorFree(pAlloc, aKeys);
+    return bOk;
+}
+
+/* Steps over the end of a leaf and over empty leaves. */
+static inline K_IT
+K_METHOD(ItNormalize)(K_IT it)
+{
+    while (it.pLeaf && it.i >= it.pLeaf->base.nKeys)
+    {
+        it.pLeaf = it.pLeaf->pNext;
+        it.i = 0;
+    }
+
+    return it;
+}
+
+K_DECL_MOD K_IT
+K_METHOD(Begin)(K_NAME* pSelf)
+{
+    return K_METHOD(ItNormalize)((K_IT){.pLeaf = pSelf->pFirst, .i = 0});
+}
+
+K_DECL_MOD K_IT
+K_METHOD(LowerBound)(K_NAME* pSelf, const K_KEY_T* pKey)
+{
+    K_LEAF* pLeaf = K_METHOD(FindLeaf)(pSelf, pKey);
+    if (!pLeaf) return (K_IT){0};
+
+    return K_METHOD(ItNormalize)((K_IT){.pLeaf = pLeaf, .i = K_METHOD(LowerI)(pLeaf->aKeys, pLeaf->base.nKeys, pKey)});
+}
+
+K_DECL_MOD K_IT
+K_METHOD(UpperBound)(K_NAME* pSelf, const K_KEY_T* pKey)
+{
+    K_LEAF* pLeaf = K_METHOD(FindLeaf)(pSelf, pKey);
+    if (!pLeaf) return (K_IT){0};
+
+    return K_METHOD(ItNormalize)((K_IT){.pLeaf = pLeaf, .i = K_METHOD(UpperI)(pLeaf->aKeys, pLeaf->base.nKeys, pKey)});
+}
+
+K_DECL_MOD void
+K_METHOD(ItNext)(K_IT* pIt)
+{
+    ++pIt->i;
+    *pIt = K_METHOD(ItNormalize)(*pIt);
+}
+
+#endif /* K_GEN_CODE */
+
+#undef K_METHOD
+#undef K_NODE
+#undef K_LEAF
+#undef K_INNER
+#undef K_IT
+#undef K_SPLIT
+
+#undef K_NAME
+#undef K_KEY_T
+#undef K_VALUE_T
+#undef K_FN_KEY_CMP
+#undef K_BTREE_LEAF_CAP
+#undef K_BTREE_INNER_CAP
+#undef K_DECL_MOD
+#undef K_GEN_DECLS
+#undef K_GEN_CODE
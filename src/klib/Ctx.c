@@ -4,6 +4,23 @@
 
 k_Ctx* k_g_pContext;
 
+static K_THREAD_LOCAL k_Arena stl_aScratch[K_CTX_SCRATCH_COUNT];
+
+static void
+destroyScratchForThisThread(void)
+{
+    for (ssize_t i = 0; i < K_CTX_SCRATCH_COUNT; ++i)
+        if (k_ArenaMemoryReserved(&stl_aScratch[i]) > 0) k_ArenaDestroy(&stl_aScratch[i]);
+}
+
+static void
+workerLoopEnd(void* pArg)
+{
+    k_Ctx* s = pArg;
+    destroyScratchForThisThread();
+    if (s->pfnUserLoopEnd) s->pfnUserLoopEnd(s->pUserLoopEndArg);
+}
+
 k_Ctx*
 k_CtxInitGlobal(k_LoggerInitOpts loggerOpts, k_ThreadPoolInitOpts threadPoolOpts)
 {
@@ -31,14 +48,24 @@ k_CtxInitGlobal(k_LoggerInitOpts loggerOpts, k_ThreadPoolInitOpts threadPoolOpts
         }
     }
 
+    pNew->scratchReserve = threadPoolOpts.arenaReserve;
+    pNew->pfnUserLoopEnd = threadPoolOpts.pfnLoopEnd;
+    pNew->pUserLoopEndArg = threadPoolOpts.pLoopEndArg;
+    threadPoolOpts.pfnLoopEnd = workerLoopEnd;
+    threadPoolOpts.pLoopEndArg = pNew;
+
+    /* Workers may log right away. */
+    k_g_pContext = pNew;
+
     if (!k_ThreadPoolInit(&pNew->threadPool, threadPoolOpts))
     {
         k_LoggerDestroy(&pNew->logger);
         k_print_MapDealloc(&pNew->pPrintMap);
         free(pNew);
+        return k_g_pContext = NULL;
     }
 
-    return k_g_pContext = pNew;
+    return pNew;
 }
 
 k_Arena*
@@ -53,6 +80,7 @@ void
 k_CtxDestroyArenaForThisThread(void)
 {
     k_ArenaDestroy(k_ThreadPoolArena(&k_g_pContext->threadPool));
+    destroyScratchForThisThread();
 }
 
 void
@@ -60,7 +88,47 @@ k_CtxDestroyGlobal(void)
 {
     k_LoggerDestroy(&k_g_pContext->logger);
     k_ThreadPoolDestroy(&k_g_pContext->threadPool);
+    destroyScratchForThisThread();
     k_print_MapDealloc(&k_g_pContext->pPrintMap);
     free(k_g_pContext);
     k_g_pContext = NULL;
 }
+
+k_Arena*
+k_CtxScratchArena(k_Arena* pConflictOrNull)
+{
+    for (ssize_t i = 0; i < K_CTX_SCRATCH_COUNT; ++i)
+    {
+        k_Arena* pArena = &stl_aScratch[i];
+        if (pArena == pConflictOrNull) continue;
+
+        if (k_ArenaMemoryReserved(pArena) <= 0)
+        {
+            if (!k_ArenaInit(pArena, k_g_pContext->scratchReserve, K_SIZE_1K*4)) return NULL;
+        }
+
+        return pArena;
+    }
+
+    return NULL;
+}
+
+k_Arena*
+k_ScratchBegin(k_ArenaState* pState, k_Arena* pConflictOrNull)
+{
+    k_Arena* pArena = k_CtxScratchArena(pConflictOrNull);
+    if (!pArena)
+    {
+        pState->state.pArena = NULL;
+        return NULL;
+    }
+
+    k_ArenaStatePush(pState, pArena);
+    return pArena;
+}
+
+void
+k_ScratchEnd(k_ArenaState* pState)
+{
+    if (pState->state.pArena) k_ArenaStateRestore(pState);
+}
@@ -4,12 +4,17 @@
 #include "Logger.h"
 #include "print.h"
 
+#define K_CTX_SCRATCH_COUNT 2 /* Thread local scratch arenas per thread. */
+
 /* Usefull runtime globals. */
 typedef struct k_Ctx
 {
     k_ThreadPool threadPool;
     k_Logger logger;
     k_print_Map* pPrintMap;
+    ssize_t scratchReserve; /* Same as threadPool.arenaReserve. */
+    void (*pfnUserLoopEnd)(void*); /* Thread pool pfnLoopEnd, called after worker's scratch arenas are destroyed. */
+    void* pUserLoopEndArg;
 } k_Ctx;
 
 extern k_Ctx* k_g_pContext;
@@ -25,6 +30,15 @@ k_Arena* k_CtxInitArenaForThisThread(ssize_t reserveSize);
 void k_CtxDestroyArenaForThisThread(void);
 void k_CtxDestroyGlobal(void);
 
+/* Thread local arena that is not pConflictOrNull, lazily reserved on first use. NULL if reserve failed. */
+k_Arena* k_CtxScratchArena(k_Arena* pConflictOrNull);
+/* Arena the K_CTX_LOG_* messages are built on: a scratch arena, or k_CtxArena() if it couldn't be reserved. */
+static inline k_Arena* k_CtxLogArena(void);
+/* Pushes the state of k_CtxScratchArena(pConflictOrNull) into pState. Results can be allocated on pConflictOrNull
+ * while the temporaries live on the returned arena. */
+k_Arena* k_ScratchBegin(k_ArenaState* pState, k_Arena* pConflictOrNull);
+void k_ScratchEnd(k_ArenaState* pState);
+
 static inline k_Ctx*
 k_CtxSetGlobal(k_Ctx* s)
 {
@@ -61,26 +75,41 @@ k_CtxPrintMap(void)
     return k_g_pContext->pPrintMap;
 }
 
+static inline k_Arena*
+k_CtxLogArena(void)
+{
+    k_Arena* pArena = k_CtxScratchArena(k_CtxArena());
+    return pArena ? pArena : k_CtxArena();
+}
+
+#define K_SCRATCH_SCOPE_VAR(pConflictOrNull, pScratch, name)                                                           \
+    for (k_ArenaState name, *K_GLUE(_pState, name) = NULL; !K_GLUE(_pState, name);                                     \
+         K_GLUE(_pState, name) = (k_ScratchEnd(&name), (k_ArenaState*)K_NPOS64))                                       \
+        for (k_Arena* pScratch = k_ScratchBegin(&name, pConflictOrNull); pScratch; pScratch = NULL)
+
+#define K_SCRATCH_SCOPE(pConflictOrNull, pScratch) K_SCRATCH_SCOPE_VAR(pConflictOrNull, pScratch, K_GLUE(_scratchState, __COUNTER__))
+
+/* Log messages are built on k_CtxLogArena(), so logging doesn't break in place growth of the last k_CtxArena() allocation. */
 #if !defined K_CTX_LOG_LEVEL || (K_CTX_LOG_LEVEL >= 1)
-    #define K_CTX_LOG_ERROR(...) k_LoggerPost(k_CtxLogger(), k_CtxArena(), K_LOG_LEVEL_ERROR, __FILE__, __LINE__, __VA_ARGS__)
+    #define K_CTX_LOG_ERROR(...) k_LoggerPost(k_CtxLogger(), k_CtxLogArena(), K_LOG_LEVEL_ERROR, __FILE__, __LINE__, __VA_ARGS__)
 #else
     #define K_CTX_LOG_ERROR(...) (void)0
 #endif
 
 #if !defined K_CTX_LOG_LEVEL || (K_CTX_LOG_LEVEL >= 2)
-    #define K_CTX_LOG_WARN(...) k_LoggerPost(k_CtxLogger(), k_CtxArena(), K_LOG_LEVEL_WARNING, __FILE__, __LINE__, __VA_ARGS__)
+    #define K_CTX_LOG_WARN(...) k_LoggerPost(k_CtxLogger(), k_CtxLogArena(), K_LOG_LEVEL_WARNING, __FILE__, __LINE__, __VA_ARGS__)
 #else
     #define K_CTX_LOG_WARN(...) (void)0
 #endif
 
 #if !defined K_CTX_LOG_LEVEL || (K_CTX_LOG_LEVEL >= 3)
-    #define K_CTX_LOG_INFO(...) k_LoggerPost(k_CtxLogger(), k_CtxArena(), K_LOG_LEVEL_INFO, __FILE__, __LINE__, __VA_ARGS__)
+    #define K_CTX_LOG_INFO(...) k_LoggerPost(k_CtxLogger(), k_CtxLogArena(), K_LOG_LEVEL_INFO, __FILE__, __LINE__, __VA_ARGS__)
 #else
     #define K_CTX_LOG_INFO(...) (void)0
 #endif
 
 #if !defined K_CTX_LOG_LEVEL || (K_CTX_LOG_LEVEL >= 4)
-    #define K_CTX_LOG_DEBUG(...) k_LoggerPost(k_CtxLogger(), k_CtxArena(), K_LOG_LEVEL_DEBUG, __FILE__, __LINE__, __VA_ARGS__)
+    #define K_CTX_LOG_DEBUG(...) k_LoggerPost(k_CtxLogger(), k_CtxLogArena(), K_LOG_LEVEL_DEBUG, __FILE__, __LINE__, __VA_ARGS__)
 #else
     #define K_CTX_LOG_DEBUG(...) (void)0
 #endif
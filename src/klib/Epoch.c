@@ -0,0 +1,159 @@
+#include "Epoch.h"
+
+#include <assert.h>
+
+bool
+k_EpochInit(k_Epoch* s, k_IAllocator* pAlloc)
+{
+    *s = (k_Epoch){0};
+
+    s->priv.pSlots = k_IAllocatorZalloc(pAlloc, sizeof(k_EpochSlot) * K_EPOCH_MAX_THREADS);
+    if (!s->priv.pSlots) return false;
+
+    if (!k_MutexInitPlain(&s->priv.mtx))
+    {
+        k_IAllocatorFree(pAlloc, s->priv.pSlots);
+        return false;
+    }
+
+    for (ssize_t i = 0; i < K_EPOCH_MAX_THREADS; ++i)
+        k_AtomicSsizeStoreRelease(&s->priv.pSlots[i].atomEpoch, K_EPOCH_OFFLINE);
+
+    s->priv.pAlloc = pAlloc;
+    k_AtomicSsizeStoreRelease(&s->priv.atomEpoch, 1);
+    return true;
+}
+
+void
+k_EpochDestroy(k_Epoch* s)
+{
+    for (ssize_t i = 0; i < s->priv.retiredSize; ++i)
+    {
+        k_EpochRetired* pR = &s->priv.pRetired[i];
+        pR->pfn(pR->pUser, pR->p);
+    }
+
+    k_IAllocatorFree(s->priv.pAlloc, s->priv.pRetired);
+    k_IAllocatorFree(s->priv.pAlloc, s->priv.pSlots);
+    k_MutexDestroy(&s->priv.mtx);
+    *s = (k_Epoch){0};
+}
+
+ssize_t
+k_EpochRegister(k_Epoch* s)
+{
+    for (ssize_t i = 0; i < K_EPOCH_MAX_THREADS; ++i)
+    {
+        if (k_AtomicIntExchangeAcquire(&s->priv.pSlots[i].atomBUsed, 1) == 0)
+        {
+            k_EpochOnline(s, i);
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+void
+k_EpochUnregister(k_Epoch* s, ssize_t slotI)
+{
+    assert(slotI >= 0 && slotI < K_EPOCH_MAX_THREADS);
+
+    k_EpochOffline(s, slotI);
+    k_AtomicIntStoreRelease(&s->priv.pSlots[slotI].atomBUsed, 0);
+}
+
+void
+k_EpochQuiescent(k_Epoch* s, ssize_t slotI)
+{
+    /* Release: reads of retired memory happen before the slot shows the new epoch. */
+    k_AtomicSsizeStoreRelease(&s->priv.pSlots[slotI].atomEpoch, k_AtomicSsizeLoadAcquire(&s->priv.atomEpoch));
+}
+
+void
+k_EpochOffline(k_Epoch* s, ssize_t slotI)
+{
+    k_AtomicSsizeStoreRelease(&s->priv.pSlots[slotI].atomEpoch, K_EPOCH_OFFLINE);
+}
+
+void
+k_EpochOnline(k_Epoch* s, ssize_t slotI)
+{
+    k_AtomicSsizeStoreRelease(&s->priv.pSlots[slotI].atomEpoch, k_AtomicSsizeLoadAcquire(&s->priv.atomEpoch));
+
+    /* Pairs with the fence in collect(): either the collector sees this slot,
+     * or this thread sees every pointer published before the collector's epoch bump. */
+    k_AtomicFenceSeqCst();
+}
+
+bool
+k_EpochRetire(k_Epoch* s, void* p, k_EpochFreePfn pfn, void* pUser)
+{
+    bool bOk = true;
+
+    k_MutexLock(&s->priv.mtx);
+    {
+        if (s->priv.retiredSize >= s->priv.retiredCap)
+        {
+            const ssize_t newCap = K_MAX(8, s->priv.retiredCap * 2);
+            k_EpochRetired* pNew = k_IAllocatorRealloc(s->priv.pAlloc, s->priv.pRetired,
+                sizeof(k_EpochRetired) * s->priv.retiredCap, sizeof(k_EpochRetired) * newCap
+            );
+            if (!pNew)
+            {
+                bOk = false;
+                goto done;
+            }
+            s->priv.pRetired = pNew;
+            s->priv.retiredCap = newCap;
+        }
+
+        /* Unpublishing p happens before the bump, so threads that see the new epoch can't reach p anymore. */
+        k_AtomicFenceSeqCst();
+        const ssize_t epoch = k_AtomicSsizeFetchAddRelaxed(&s->priv.atomEpoch, 1) + 1;
+
+        s->priv.pRetired[s->priv.retiredSize++] = (k_EpochRetired){.p = p, .pfn = pfn, .pUser = pUser, .epoch = epoch};
+        k_AtomicSsizeFetchAddRelaxed(&s->priv.atomNRetired, 1);
+    }
+done:
+    k_MutexUnlock(&s->priv.mtx);
+
+    return bOk;
+}
+
+ssize_t
+k_EpochCollect(k_Epoch* s)
+{
+    if (k_EpochPending(s) <= 0) return 0;
+
+    ssize_t nPending;
+    k_MutexLock(&s->priv.mtx);
+    {
+        k_AtomicFenceSeqCst();
+
+        ssize_t minEpoch = K_EPOCH_OFFLINE;
+        for (ssize_t i = 0; i < K_EPOCH_MAX_THREADS; ++i)
+            minEpoch = K_MIN(minEpoch, k_AtomicSsizeLoadAcquire(&s->priv.pSlots[i].atomEpoch));
+
+        ssize_t keepI = 0;
+        for (ssize_t i = 0; i < s->priv.retiredSize; ++i)
+        {
+            k_EpochRetired r = s->priv.pRetired[i];
+            if (r.epoch <= minEpoch) r.pfn(r.pUser, r.p);
+            else s->priv.pRetired[keepI++] = r;
+        }
+
+        k_AtomicSsizeFetchAddRelaxed(&s->priv.atomNRetired, keepI - s->priv.retiredSize);
+        s->priv.retiredSize = nPending = keepI;
+    }
+    k_MutexUnlock(&s->priv.mtx);
+
+    return nPending;
+}
+
+void
+k_EpochSynchronize(k_Epoch* s)
+{
+    while (k_EpochCollect(s) > 0)
+        k_ThreadYield();
+}
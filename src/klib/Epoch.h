@@ -0,0 +1,63 @@
+#pragma once
+
+#include "IAllocator.h"
+#include "Thread.h"
+#include "atomic.h"
+
+#define K_EPOCH_MAX_THREADS 64
+#define K_EPOCH_OFFLINE ((ssize_t)INT64_MAX) /* Slot epoch of threads that hold no references. */
+
+typedef void (*k_EpochFreePfn)(void* pUser, void* p);
+
+typedef struct k_EpochSlot
+{
+    k_atomic_Ssize atomEpoch; /* Last global epoch this thread has seen in a quiescent state, or K_EPOCH_OFFLINE. */
+    k_atomic_Int atomBUsed;
+    uint8_t aPad[64]; /* Keep neighbouring slots on different cache lines. */
+} k_EpochSlot;
+
+typedef struct k_EpochRetired
+{
+    void* p;
+    k_EpochFreePfn pfn;
+    void* pUser;
+    ssize_t epoch; /* Safe to free once every online thread reached it. */
+} k_EpochRetired;
+
+/* Quiescent-state based reclamation. Readers take no locks and announce nothing while reading,
+ * instead every registered thread calls k_EpochQuiescent() between operations (k_ThreadPool workers do it after each task).
+ * Pointers retired by writers are freed once all online threads passed a quiescent state.
+ * Threads that block for long (waiting for tasks) go offline so they don't hold up reclamation. */
+typedef struct k_Epoch
+{
+    struct
+    {
+        k_atomic_Ssize atomEpoch;
+        k_atomic_Ssize atomNRetired;
+        k_EpochSlot* pSlots;
+        k_IAllocator* pAlloc;
+        k_Mutex mtx; /* Guards the retired list. */
+        k_EpochRetired* pRetired;
+        ssize_t retiredSize;
+        ssize_t retiredCap;
+    } priv;
+} k_Epoch;
+
+bool k_EpochInit(k_Epoch* s, k_IAllocator* pAlloc);
+void k_EpochDestroy(k_Epoch* s); /* NOTE: Frees everything still retired, no thread may be reading. */
+
+ssize_t k_EpochRegister(k_Epoch* s); /* Returns slot for this thread (online), or -1 if all K_EPOCH_MAX_THREADS are taken. */
+void k_EpochUnregister(k_Epoch* s, ssize_t slotI);
+void k_EpochQuiescent(k_Epoch* s, ssize_t slotI); /* Pointers loaded before this call must not be used after it. */
+void k_EpochOffline(k_Epoch* s, ssize_t slotI);
+void k_EpochOnline(k_Epoch* s, ssize_t slotI);
+
+bool k_EpochRetire(k_Epoch* s, void* p, k_EpochFreePfn pfn, void* pUser); /* p must be unreachable for new readers already. */
+ssize_t k_EpochCollect(k_Epoch* s); /* Frees what is safe, returns number still pending. */
+void k_EpochSynchronize(k_Epoch* s); /* Waits until everything retired so far is freed. NOTE: Calling thread must be offline or unregistered. */
+
+static inline ssize_t
+k_EpochPending(k_Epoch* s)
+{
+    return k_AtomicSsizeLoadRelaxed(&s->priv.atomNRetired);
+}
@@ -4,6 +4,10 @@
 
 #include <string.h>
 
+#ifdef _MSC_VER
+    #include <intrin.h>
+#endif
+
 #ifdef K_ASAN
     #include "sanitizer/asan_interface.h"
     #define K_ASAN_POISON ASAN_POISON_MEMORY_REGION
@@ -58,8 +62,8 @@ k_IAllocatorAlloc(void* pSelf, void* p, ssize_t size)
     return ret;
 }
 
-#define K_ALIGN_UP_PO2(x, to) ((x) + to - 1) & (~(to - 1))
-#define K_ALIGN_DOWN_PO2(x, to) (x & ~(to - 1))
+#define K_ALIGN_UP_PO2(x, to) (((x) + (to) - 1) & ~((to) - 1))
+#define K_ALIGN_DOWN_PO2(x, to) ((x) & ~((to) - 1))
 #define K_ALIGN_UP8(x) K_ALIGN_UP_PO2(x, 8)
 #define K_ALIGN_DOWN8(x) K_ALIGN_DOWN_PO2(x, 8)
 
@@ -77,6 +81,8 @@ k_IAllocatorAlloc(void* pSelf, void* p, ssize_t size)
 
 ssize_t k_getPageSize(void);
 static inline ssize_t k_NextPowerofTwo64(ssize_t x);
+static inline int k_clz64(uint64_t x); /* Undefined for 0. */
+static inline int k_ctz64(uint64_t x); /* Undefined for 0. */
 static inline bool k_isPowerOf2(ssize_t x) { return (x & (x - 1)) == 0; }
 static inline void k_nullDeleter(void** pp) { *pp = NULL; }
 
@@ -94,3 +100,27 @@ k_NextPowerofTwo64(ssize_t x)
 
     return ++x;
 }
+
+static inline int
+k_clz64(uint64_t x)
+{
+#ifdef _MSC_VER
+    unsigned long i;
+    _BitScanReverse64(&i, x);
+    return 63 - (int)i;
+#else
+    return __builtin_clzll(x);
+#endif
+}
+
+static inline int
+k_ctz64(uint64_t x)
+{
+#ifdef _MSC_VER
+    unsigned long i;
+    _BitScanForward64(&i, x);
+    return (int)i;
+#else
+    return __builtin_ctzll(x);
+#endif
+}
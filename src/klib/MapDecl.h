@@ -2,6 +2,8 @@
 
 #include "common.h"
 
+#include <string.h>
+
 typedef uint8_t K_MAP_RESULT_STATUS;
 static const uint8_t K_MAP_RESULT_STATUS_NOT_FOUND = 0;
 static const uint8_t K_MAP_RESULT_STATUS_FOUND = 1;
@@ -15,3 +17,112 @@ static const uint8_t K_MAP_BUCKET_FLAG_OCCUPIED = 1;
 static const uint8_t K_MAP_BUCKET_FLAG_DELETED = 2;
 
 static const float K_MAP_LOAD_FACTOR = 0.5f;
+
+static const ssize_t K_MAP_MIGRATE_STEP = 64; /* Old buckets moved per insert with K_MAP_INCREMENTAL. */
+
+#define K_MAP_SHARDED_BATCH 64 /* Keys hashed and grouped per shard at once by MapShardedGen batch calls. */
+#define K_MAP_SEARCH_BATCH 16 /* Lookups in flight per SearchBatch round. */
+
+/* Snapshot written by Serialize() and viewed by LoadView(): header, then the bucket and flag arrays as they are in memory. */
+typedef struct k_MapSnapshotHeader
+{
+    uint32_t magic;
+    uint32_t bucketSize; /* Catches key/value type mismatches. */
+    uint32_t mode; /* K_MAP_SNAPSHOT_MODE_* bits. */
+    uint32_t pad;
+    int64_t cap;
+    int64_t size;
+    int64_t nDeleted;
+    uint64_t seed;
+} k_MapSnapshotHeader;
+
+static const uint32_t K_MAP_SNAPSHOT_MAGIC = 0x50414d4b; /* "KMAP". */
+static const uint32_t K_MAP_SNAPSHOT_MODE_SWISS = 1 << 0;
+static const uint32_t K_MAP_SNAPSHOT_MODE_STORE_HASH = 1 << 1;
+static const uint32_t K_MAP_SNAPSHOT_MODE_NO_VALUE = 1 << 2;
+static const uint32_t K_MAP_SNAPSHOT_MODE_SEEDED = 1 << 3;
+
+#define K_MAP_SNAPSHOT_HEADER_SIZE 64 /* Buckets start cache line aligned in a mapped file. */
+
+/* K_MAP_SWISS control bytes: full buckets store the low 7 bits of the hash (h2). */
+static const uint8_t K_MAP_CTRL_EMPTY = 0x80;
+static const uint8_t K_MAP_CTRL_DELETED = 0xfe;
+
+static const float K_MAP_SWISS_LOAD_FACTOR = 0.875f;
+
+#define K_MAP_GROUP_SIZE 16
+
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+    #define K_MAP_GROUP_SSE2
+    #include <emmintrin.h>
+#endif
+
+static inline bool k_MapCtrlIsFull(uint8_t ctrl) { return (ctrl & 0x80) == 0; }
+
+/* Group matches return a bitmask with bit i set for control byte i of the 16 byte group. */
+static inline uint32_t k_MapGroupMatch(const uint8_t* pCtrl, uint8_t h2);
+static inline uint32_t k_MapGroupMatchEmpty(const uint8_t* pCtrl);
+static inline uint32_t k_MapGroupMatchEmptyOrDeleted(const uint8_t* pCtrl);
+
+#ifndef K_MAP_GROUP_SSE2
+
+/* Gathers the high bit of each byte into the low 8 bits. */
+static inline uint32_t
+k_MapSwarMovemask(uint64_t x)
+{
+    return (uint32_t)(((x & 0x8080808080808080LLU) * 0x0002040810204081LLU) >> 56);
+}
+
+static inline uint64_t
+k_MapSwarLoad(const uint8_t* p)
+{
+    uint64_t x;
+    memcpy(&x, p, sizeof(x));
+    return x;
+}
+
+static inline uint64_t
+k_MapSwarZeroBytes(uint64_t x)
+{
+    const uint64_t low7 = 0x7f7f7f7f7f7f7f7fLLU;
+    return ~(((x & low7) + low7) | x | low7);
+}
+
+#endif
+
+static inline uint32_t
+k_MapGroupMatch(const uint8_t* pCtrl, uint8_t h2)
+{
+#ifdef K_MAP_GROUP_SSE2
+    const __m128i group = _mm_loadu_si128((const __m128i*)pCtrl);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)h2)));
+#else
+    const uint64_t pattern = 0x0101010101010101LLU * h2;
+    const uint64_t lo = k_MapSwarZeroBytes(k_MapSwarLoad(pCtrl) ^ pattern);
+    const uint64_t hi = k_MapSwarZeroBytes(k_MapSwarLoad(pCtrl + 8) ^ pattern);
+    return k_MapSwarMovemask(lo) | (k_MapSwarMovemask(hi) << 8);
+#endif
+}
+
+static inline uint32_t
+k_MapGroupMatchEmpty(const uint8_t* pCtrl)
+{
+#ifdef K_MAP_GROUP_SSE2
+    return k_MapGroupMatch(pCtrl, K_MAP_CTRL_EMPTY);
+#else
+    /* Empty is the only special byte with bit 1 clear. */
+    const uint64_t lo = k_MapSwarLoad(pCtrl);
+    const uint64_t hi = k_MapSwarLoad(pCtrl + 8);
+    return k_MapSwarMovemask(lo & ~(lo << 6)) | (k_MapSwarMovemask(hi & ~(hi << 6)) << 8);
+#endif
+}
+
+static inline uint32_t
+k_MapGroupMatchEmptyOrDeleted(const uint8_t* pCtrl)
+{
+#ifdef K_MAP_GROUP_SSE2
+    return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)pCtrl));
+#else
+    return k_MapSwarMovemask(k_MapSwarLoad(pCtrl)) | (k_MapSwarMovemask(k_MapSwarLoad(pCtrl + 8)) << 8);
+#endif
+}
@@ -1,5 +1,7 @@
 #include "MapDecl.h"
 #include "IAllocator.h"
+#include "Span.h"
+#include "hash.h"
 
 #include <assert.h>
 
@@ -11,7 +13,7 @@
     #error "K_KEY_T is not defined"
 #endif
 
-#ifndef K_VALUE_T
+#if !defined K_VALUE_T && !defined K_MAP_NO_VALUE
     #error "K_VALUE_T is not defined"
 #endif
 
@@ -32,16 +34,75 @@
     #define K_GEN_CODE
 #endif
 
+/* K_MAP_SWISS: control bytes hold 7 hash bits and are probed a group of K_MAP_GROUP_SIZE at a time,
+ * K_MAP_SWISS_LOAD_FACTOR instead of K_MAP_LOAD_FACTOR. Otherwise linear probing over flags.
+ * K_MAP_INCREMENTAL: growth keeps the old array and each insert moves K_MAP_MIGRATE_STEP of its buckets over.
+ * K_MAP_STORE_HASH: buckets keep their full hash, so growth and purges never call K_FN_HASH
+ * and K_FN_KEY_CMP only runs on hash matches. Costs 8 bytes per bucket.
+ * K_MAP_NO_VALUE: buckets only hold keys, Insert takes no value. Adds set algebra, see SetGen-inl.h.
+ * K_MAP_SEEDED: K_FN_HASH(pKey, seed) with a random per-map seed picked by Init(), so colliding keys can't be
+ * precomputed against the table. Growth and Clone() keep the seed. */
+
 #define K_METHOD(M) K_GLUE(K_NAME, M)
 #define K_BUCKET K_METHOD(Bucket)
 #define K_MAP_RESULT K_METHOD(Result)
 
+#ifdef K_MAP_SWISS
+    #define K_IS_OCCUPIED(flag) k_MapCtrlIsFull(flag)
+    #define K_FLAG_DELETED K_MAP_CTRL_DELETED
+#else
+    #define K_IS_OCCUPIED(flag) ((flag) == K_MAP_BUCKET_FLAG_OCCUPIED)
+    #define K_FLAG_DELETED K_MAP_BUCKET_FLAG_DELETED
+#endif
+
+#ifdef K_MAP_SEEDED
+    #define K_HASH(pSelf, pKey) K_FN_HASH(pKey, (pSelf)->seed)
+    /* Hash of pSrc's bucket for lookups in pMap. */
+    #define K_BUCKET_HASH_FOR(pMap, pSrc, pBucket)                                                                       \
+        ((pMap)->seed == (pSrc)->seed ? K_BUCKET_HASH(pSrc, pBucket) : K_HASH(pMap, &(pBucket)->key))
+#else
+    #define K_HASH(pSelf, pKey) K_FN_HASH(pKey)
+    #define K_BUCKET_HASH_FOR(pMap, pSrc, pBucket) K_BUCKET_HASH(pSrc, pBucket)
+#endif
+
+#ifdef K_MAP_STORE_HASH
+    #define K_BUCKET_HASH(pSelf, pBucket) ((pBucket)->hash)
+    #define K_KEY_EQ(pBucket, pKey, h) ((pBucket)->hash == (h) && K_FN_KEY_CMP(&(pBucket)->key, pKey) == 0)
+#else
+    #define K_BUCKET_HASH(pSelf, pBucket) K_HASH(pSelf, &(pBucket)->key)
+    #define K_KEY_EQ(pBucket, pKey, h) (K_FN_KEY_CMP(&(pBucket)->key, pKey) == 0)
+#endif
+
+#ifdef K_MAP_NO_VALUE
+    #define K_VAL_PARAM
+    #define K_VAL_ARG
+    #define K_SET_VALUE(pBucket) ((void)0)
+    #define K_ZERO_VALUE(pBucket) ((void)0)
+#else
+    #define K_VAL_PARAM , const K_VALUE_T* pVal
+    #define K_VAL_ARG , pVal
+    #define K_SET_VALUE(pBucket) ((pBucket)->value = *pVal)
+    #define K_ZERO_VALUE(pBucket) ((pBucket)->value = (K_VALUE_T){0})
+#endif
+
+/* Buckets in pBuckets, size also counts the ones still waiting in the old array. */
+#ifdef K_MAP_INCREMENTAL
+    #define K_NEW_SIZE(pSelf) ((pSelf)->size - (pSelf)->oldSize)
+#else
+    #define K_NEW_SIZE(pSelf) ((pSelf)->size)
+#endif
+
 #ifdef K_GEN_DECLS
 
 typedef struct K_BUCKET
 {
     K_KEY_T key;
+#ifndef K_MAP_NO_VALUE
     K_VALUE_T value;
+#endif
+#ifdef K_MAP_STORE_HASH
+    uint64_t hash;
+#endif
 } K_BUCKET;
 
 typedef struct K_MAP_RESULT
@@ -57,15 +118,33 @@ typedef struct K_NAME
     K_BUCKET* pBuckets;
     ssize_t size; /* N occupied buckets. */
     ssize_t cap; /* Real array capacity. */
+#ifdef K_MAP_SEEDED
+    uint64_t seed;
+#endif
+#ifdef K_MAP_SWISS
+    ssize_t nDeleted; /* Tombstones, count towards the load factor. */
+#endif
+#ifdef K_MAP_INCREMENTAL
+    K_BUCKET* pOldBuckets; /* Array being migrated, NULL if none. */
+    ssize_t oldCap;
+    ssize_t oldSize; /* Live buckets not migrated yet. */
+    ssize_t migrateI; /* Next old bucket to migrate. */
+#endif
 } K_NAME;
 
 K_DECL_MOD bool K_METHOD(Init)(K_NAME* pSelf, k_IAllocator* pAlloc, ssize_t prealloc);
+#ifdef K_MAP_SEEDED
+K_DECL_MOD bool K_METHOD(InitSeeded)(K_NAME* pSelf, k_IAllocator* pAlloc, ssize_t prealloc, uint64_t seed); /* Fixed seed, e.g. for MapShardedGen. */
+K_DECL_MOD bool K_METHOD(InitIfEmpty)(K_NAME* pSelf, k_IAllocator* pAlloc); /* Before hashing for InsertHashed() on a {0} map. */
+#endif
 K_DECL_MOD K_NAME K_METHOD(Create)(k_IAllocator* pAlloc, ssize_t prealloc);
 K_DECL_MOD void K_METHOD(Destroy)(K_NAME* pSelf, k_IAllocator* pAlloc);
-K_DECL_MOD K_MAP_RESULT K_METHOD(Insert)(K_NAME* pSelf, k_IAllocator* pAlloc, const K_KEY_T* pKey, const K_VALUE_T* pVal);
-K_DECL_MOD K_MAP_RESULT K_METHOD(TryInsert)(K_NAME* pSelf, k_IAllocator* pAlloc, const K_KEY_T* pKey, const K_VALUE_T* pVal);
+K_DECL_MOD bool K_METHOD(Clone)(K_NAME* pSelf, k_IAllocator* pAlloc, K_NAME* pDst); /* Doesn't modify pSelf. */
+K_DECL_MOD K_MAP_RESULT K_METHOD(Insert)(K_NAME* pSelf, k_IAllocator* pAlloc, const K_KEY_T* pKey K_VAL_PARAM);
+K_DECL_MOD K_MAP_RESULT K_METHOD(TryInsert)(K_NAME* pSelf, k_IAllocator* pAlloc, const K_KEY_T* pKey K_VAL_PARAM);
 K_DECL_MOD K_MAP_RESULT K_METHOD(Remove)(K_NAME* pSelf, const K_KEY_T* pKey);
 K_DECL_MOD K_MAP_RESULT K_METHOD(Search)(K_NAME* pSelf, const K_KEY_T* pKey);
+K_DECL_MOD ssize_t K_METHOD(SearchBatch)(K_NAME* pSelf, const K_KEY_T* pKeys, ssize_t n, K_MAP_RESULT* pResults); /* Returns number of found keys. */
 K_DECL_MOD ssize_t K_METHOD(FirstI)(K_NAME* pSelf);
 K_DECL_MOD ssize_t K_METHOD(LastI)(K_NAME* pSelf);
 K_DECL_MOD ssize_t K_METHOD(NextI)(K_NAME* pSelf, ssize_t i);
@@ -75,15 +154,61 @@ K_DECL_MOD ssize_t K_METHOD(EndI)(K_NAME* pSelf);
 K_DECL_MOD K_MAP_BUCKET_FLAG* K_METHOD(Flags)(K_NAME* pSelf);
 K_DECL_MOD float K_METHOD(LoadFactor)(K_NAME* pSelf);
 K_DECL_MOD bool K_METHOD(Rehash)(K_NAME* pSelf, k_IAllocator* pAlloc, ssize_t newCap);
+K_DECL_MOD bool K_METHOD(Reserve)(K_NAME* pSelf, k_IAllocator* pAlloc, ssize_t n); /* Grows once so that n keys fit without rehashing. */
+
+/* Flat snapshots for POD keys and values (no pointers), K_FN_HASH must hash the same way in the loading process. */
+K_DECL_MOD ssize_t K_METHOD(SerializedSize)(K_NAME* pSelf);
+K_DECL_MOD bool K_METHOD(Serialize)(K_NAME* pSelf, k_Span spOut); /* spOut needs SerializedSize() bytes. */
+/* Read-only map over sp (e.g. from k_file_map()), no copy. Only search it, don't Destroy(). sp must be 8 byte aligned. */
+K_DECL_MOD bool K_METHOD(LoadView)(K_NAME* pSelf, k_Span sp);
 K_DECL_MOD ssize_t K_METHOD(InsertionI)(K_NAME* pSelf, const K_KEY_T* pKey, uint64_t hash);
-K_DECL_MOD K_MAP_RESULT K_METHOD(InsertHashed)(K_NAME* pSelf, k_IAllocator* pAlloc, const K_KEY_T* pKey, const K_VALUE_T* pVal, uint64_t hash);
-K_DECL_MOD void K_METHOD(RemoveI)(K_NAME* pSelf, ssize_t i);
+K_DECL_MOD K_MAP_RESULT K_METHOD(InsertHashed)(K_NAME* pSelf, k_IAllocator* pAlloc, const K_KEY_T* pKey K_VAL_PARAM, uint64_t hash);
+K_DECL_MOD void K_METHOD(RemoveI)(K_NAME* pSelf, ssize_t i); /* NOTE: may move a later bucket into i (wrapping around). */
 K_DECL_MOD K_MAP_RESULT K_METHOD(SearchHashed)(K_NAME* pSelf, const K_KEY_T* pKey, uint64_t hash);
+#ifdef K_MAP_SWISS
+K_DECL_MOD ssize_t K_METHOD(FreeI)(K_NAME* pSelf, uint64_t hash); /* First empty or deleted bucket on the probe sequence. */
+K_DECL_MOD void K_METHOD(RehashInPlace)(K_NAME* pSelf); /* Purges tombstones without allocating. */
+#endif
+K_DECL_MOD void K_METHOD(PlaceNew)(K_NAME* pSelf, const K_BUCKET* pBucket, uint64_t hash); /* Key must be absent, doesn't touch size. */
+K_DECL_MOD bool K_METHOD(Grow)(K_NAME* pSelf, k_IAllocator* pAlloc, ssize_t newCap);
+K_DECL_MOD K_MAP_RESULT K_METHOD(SearchTable)(K_NAME* pSelf, const K_KEY_T* pKey, uint64_t hash); /* pBuckets only. */
+#ifdef K_MAP_INCREMENTAL
+/* Moves up to nBuckets old buckets, frees the drained old array if pAllocOrNull is given. */
+K_DECL_MOD void K_METHOD(Migrate)(K_NAME* pSelf, k_IAllocator* pAllocOrNull, ssize_t nBuckets);
+K_DECL_MOD K_NAME K_METHOD(OldTable)(K_NAME* pSelf);
+#endif
+
+#ifdef K_MAP_NO_VALUE
+/* Bulk set algebra. Hashes are reused (stored ones with K_MAP_STORE_HASH) and the result is sized once.
+ * pDst is created by the call and must not alias pA or pB. */
+K_DECL_MOD bool K_METHOD(UnionWith)(K_NAME* pSelf, k_IAllocator* pAlloc, K_NAME* pOther);
+K_DECL_MOD bool K_METHOD(Intersect)(K_NAME* pDst, k_IAllocator* pAlloc, K_NAME* pA, K_NAME* pB);
+K_DECL_MOD bool K_METHOD(Difference)(K_NAME* pDst, k_IAllocator* pAlloc, K_NAME* pA, K_NAME* pB); /* Keys of pA not in pB. */
+#endif
 
 #endif /* K_GEN_DECLS */
 
 #ifdef K_GEN_CODE
 
+#ifdef K_MAP_SEEDED
+
+K_DECL_MOD bool
+K_METHOD(InitSeeded)(K_NAME* pSelf, k_IAllocator* pAlloc, ssize_t prealloc, uint64_t seed)
+{
+    if (!K_METHOD(Init)(pSelf, pAlloc, prealloc)) return false;
+    pSelf->seed = seed;
+    return true;
+}
+
+/* Init() picks the seed, so a {0} map has to get it before the first key is hashed. */
+K_DECL_MOD bool
+K_METHOD(InitIfEmpty)(K_NAME* pSelf, k_IAllocator* pAlloc)
+{
+    return pSelf->cap > 0 || K_METHOD(Init)(pSelf, pAlloc, 8);
+}
+
+#endif
+
 K_DECL_MOD bool
 K_METHOD(Init)(K_NAME* pSelf, k_IAllocator* pAlloc, ssize_t prealloc)
 {
@@ -91,13 +216,31 @@ K_METHOD(Init)(K_NAME* pSelf, k_IAllocator* pAlloc, ssize_t prealloc)
     assert(pAlloc != NULL);
     assert(pSelf != NULL);
 
+#ifdef K_MAP_SWISS
+    const ssize_t cap = k_NextPowerofTwo64(K_MAX(prealloc, K_MAP_GROUP_SIZE));
+#else
     const ssize_t cap = k_NextPowerofTwo64(K_MAX(prealloc, 8));
+#endif
 
     pSelf->pBuckets = k_IAllocatorZalloc(pAlloc, (sizeof(K_BUCKET) + sizeof(K_MAP_BUCKET_FLAG))*cap);
     if (!pSelf->pBuckets) return false;
     pSelf->cap = cap;
     pSelf->size = 0;
 
+#ifdef K_MAP_SEEDED
+    pSelf->seed = k_hash_randomSeed();
+#endif
+#ifdef K_MAP_SWISS
+    pSelf->nDeleted = 0;
+    memset(K_METHOD(Flags)(pSelf), K_MAP_CTRL_EMPTY, cap);
+#endif
+#ifdef K_MAP_INCREMENTAL
+    pSelf->pOldBuckets = NULL;
+    pSelf->oldCap = 0;
+    pSelf->oldSize = 0;
+    pSelf->migrateI = 0;
+#endif
+
     return true;
 }
 
@@ -112,11 +255,60 @@ K_METHOD(Create)(k_IAllocator* pAlloc, ssize_t prealloc)
 K_DECL_MOD void
 K_METHOD(Destroy)(K_NAME* pSelf, k_IAllocator* pAlloc)
 {
+#ifdef K_MAP_INCREMENTAL
+    k_IAllocatorFree(pAlloc, pSelf->pOldBuckets);
+    pSelf->pOldBuckets = NULL;
+    pSelf->oldCap = pSelf->oldSize = pSelf->migrateI = 0;
+#endif
     k_IAllocatorFree(pAlloc, pSelf->pBuckets);
     pSelf->pBuckets = NULL;
     pSelf->cap = 0;
 }
 
+K_DECL_MOD bool
+K_METHOD(Clone)(K_NAME* pSelf, k_IAllocator* pAlloc, K_NAME* pDst)
+{
+#ifdef K_MAP_INCREMENTAL
+    if (pSelf->pOldBuckets)
+    {
+        /* Collapse both arrays into one instead of migrating pSelf. */
+        K_NAME mNew = K_METHOD(Create)(pAlloc, pSelf->cap);
+        if (!mNew.pBuckets) return false;
+#ifdef K_MAP_SEEDED
+        mNew.seed = pSelf->seed;
+#endif
+
+        K_NAME aTables[2] = {K_METHOD(OldTable)(pSelf), *pSelf};
+        for (ssize_t t = 0; t < 2; ++t)
+        {
+            K_MAP_BUCKET_FLAG* pEFlags = K_METHOD(Flags)(&aTables[t]);
+            for (ssize_t i = 0; i < aTables[t].cap; ++i)
+            {
+                if (K_IS_OCCUPIED(pEFlags[i]))
+                    K_METHOD(PlaceNew)(&mNew, &aTables[t].pBuckets[i], K_BUCKET_HASH(pSelf, &aTables[t].pBuckets[i]));
+            }
+        }
+
+        mNew.size = pSelf->size;
+        *pDst = mNew;
+        return true;
+    }
+#endif
+
+    const ssize_t nBytes = (sizeof(K_BUCKET) + sizeof(K_MAP_BUCKET_FLAG))*pSelf->cap;
+    K_BUCKET* pNew = NULL;
+    if (nBytes > 0)
+    {
+        pNew = k_IAllocatorMalloc(pAlloc, nBytes);
+        if (!pNew) return false;
+        memcpy(pNew, pSelf->pBuckets, nBytes);
+    }
+
+    *pDst = *pSelf;
+    pDst->pBuckets = pNew;
+    return true;
+}
+
 K_DECL_MOD K_MAP_BUCKET_FLAG*
 K_METHOD(Flags)(K_NAME* s)
 {
@@ -131,17 +323,48 @@ K_METHOD(LoadFactor)(K_NAME* pSelf)
     return (float)pSelf->size / (float)(pSelf->cap);
 }
 
+K_DECL_MOD void
+K_METHOD(PlaceNew)(K_NAME* pSelf, const K_BUCKET* pBucket, uint64_t hash)
+{
+#ifdef K_MAP_SWISS
+    const ssize_t idx = K_METHOD(FreeI)(pSelf, hash);
+    uint8_t* pCtrl = K_METHOD(Flags)(pSelf);
+    if (pCtrl[idx] == K_MAP_CTRL_DELETED) --pSelf->nDeleted;
+    pCtrl[idx] = (uint8_t)(hash & 0x7f);
+#else
+    const ssize_t mask = pSelf->cap - 1;
+    K_MAP_BUCKET_FLAG* pEFlags = K_METHOD(Flags)(pSelf);
+    ssize_t idx = (ssize_t)(hash & (uint64_t)mask);
+    while (pEFlags[idx] == K_MAP_BUCKET_FLAG_OCCUPIED)
+        idx = (idx + 1) & mask;
+    pEFlags[idx] = K_MAP_BUCKET_FLAG_OCCUPIED;
+#endif
+
+    pSelf->pBuckets[idx] = *pBucket;
+}
+
 K_DECL_MOD bool
 K_METHOD(Rehash)(K_NAME* pSelf, k_IAllocator* pAlloc, ssize_t newCap)
 {
+#ifdef K_MAP_INCREMENTAL
+    K_METHOD(Migrate)(pSelf, pAlloc, pSelf->oldCap);
+#endif
+
     K_NAME mNew = K_METHOD(Create)(pAlloc, newCap);
     if (!mNew.pBuckets) return false;
+#ifdef K_MAP_SEEDED
+    mNew.seed = pSelf->seed;
+#endif
 
+    /* Keys are unique, no need to search. */
     K_MAP_BUCKET_FLAG* pEFlags = K_METHOD(Flags)(pSelf);
     for (ssize_t i = 0; i < pSelf->cap; ++i)
     {
-        if (pEFlags[i] == K_MAP_BUCKET_FLAG_OCCUPIED)
-            K_METHOD(Insert)(&mNew, pAlloc, &pSelf->pBuckets[i].key, &pSelf->pBuckets[i].value);
+        if (K_IS_OCCUPIED(pEFlags[i]))
+        {
+            K_METHOD(PlaceNew)(&mNew, &pSelf->pBuckets[i], K_BUCKET_HASH(pSelf, &pSelf->pBuckets[i]));
+            ++mNew.size;
+        }
     }
 
     k_IAllocatorFree(pAlloc, pSelf->pBuckets);
@@ -149,6 +372,283 @@ K_METHOD(Rehash)(K_NAME* pSelf, k_IAllocator* pAlloc, ssize_t newCap)
     return true;
 }
 
+K_DECL_MOD bool
+K_METHOD(Grow)(K_NAME* pSelf, k_IAllocator* pAlloc, ssize_t newCap)
+{
+#ifdef K_MAP_INCREMENTAL
+    /* Previous migration didn't keep up, finish it now. */
+    K_METHOD(Migrate)(pSelf, pAlloc, pSelf->oldCap);
+
+    K_NAME mNew = K_METHOD(Create)(pAlloc, newCap);
+    if (!mNew.pBuckets) return false;
+#ifdef K_MAP_SEEDED
+    mNew.seed = pSelf->seed;
+#endif
+
+    mNew.size = pSelf->size;
+    mNew.pOldBuckets = pSelf->pBuckets;
+    mNew.oldCap = pSelf->cap;
+    mNew.oldSize = pSelf->size;
+    mNew.migrateI = 0;
+    *pSelf = mNew;
+    return true;
+#else
+    return K_METHOD(Rehash)(pSelf, pAlloc, newCap);
+#endif
+}
+
+K_DECL_MOD bool
+K_METHOD(Reserve)(K_NAME* pSelf, k_IAllocator* pAlloc, ssize_t n)
+{
+#ifdef K_MAP_SWISS
+    const float loadFactor = K_MAP_SWISS_LOAD_FACTOR;
+#else
+    const float loadFactor = K_MAP_LOAD_FACTOR;
+#endif
+
+    const ssize_t cap = k_NextPowerofTwo64((ssize_t)((float)(n + 1) / loadFactor) + 1);
+    if (cap <= pSelf->cap) return true;
+    if (pSelf->cap <= 0) return K_METHOD(Init)(pSelf, pAlloc, cap);
+    return K_METHOD(Rehash)(pSelf, pAlloc, cap);
+}
+
+static inline uint32_t
+K_METHOD(SnapshotMode)(void)
+{
+    uint32_t mode = 0;
+#ifdef K_MAP_SWISS
+    mode |= K_MAP_SNAPSHOT_MODE_SWISS;
+#endif
+#ifdef K_MAP_STORE_HASH
+    mode |= K_MAP_SNAPSHOT_MODE_STORE_HASH;
+#endif
+#ifdef K_MAP_NO_VALUE
+    mode |= K_MAP_SNAPSHOT_MODE_NO_VALUE;
+#endif
+#ifdef K_MAP_SEEDED
+    mode |= K_MAP_SNAPSHOT_MODE_SEEDED;
+#endif
+    return mode;
+}
+
+K_DECL_MOD ssize_t
+K_METHOD(SerializedSize)(K_NAME* pSelf)
+{
+    return K_MAP_SNAPSHOT_HEADER_SIZE + (ssize_t)(sizeof(K_BUCKET) + sizeof(K_MAP_BUCKET_FLAG))*pSelf->cap;
+}
+
+K_DECL_MOD bool
+K_METHOD(Serialize)(K_NAME* pSelf, k_Span spOut)
+{
+    if (spOut.size < K_METHOD(SerializedSize)(pSelf)) return false;
+
+    k_MapSnapshotHeader header = {
+        .magic = K_MAP_SNAPSHOT_MAGIC,
+        .bucketSize = sizeof(K_BUCKET),
+        .mode = K_METHOD(SnapshotMode)(),
+        .cap = pSelf->cap,
+        .size = pSelf->size,
+    };
+#ifdef K_MAP_SWISS
+    header.nDeleted = pSelf->nDeleted;
+#endif
+#ifdef K_MAP_SEEDED
+    header.seed = pSelf->seed;
+#endif
+
+    memset(spOut.pData, 0, K_MAP_SNAPSHOT_HEADER_SIZE);
+    memcpy(spOut.pData, &header, sizeof(header));
+    if (pSelf->cap <= 0) return true;
+
+    K_NAME view = *pSelf;
+    view.pBuckets = (K_BUCKET*)((uint8_t*)spOut.pData + K_MAP_SNAPSHOT_HEADER_SIZE);
+    memcpy(view.pBuckets, pSelf->pBuckets, (sizeof(K_BUCKET) + sizeof(K_MAP_BUCKET_FLAG))*pSelf->cap);
+
+#ifdef K_MAP_INCREMENTAL
+    /* Finish the migration in the copy, pSelf stays as is. */
+    K_NAME old = K_METHOD(OldTable)(pSelf);
+    const K_MAP_BUCKET_FLAG* pOldFlags = old.pBuckets ? K_METHOD(Flags)(&old) : NULL;
+    for (ssize_t i = 0; i < old.cap; ++i)
+    {
+        if (K_IS_OCCUPIED(pOldFlags[i]))
+            K_METHOD(PlaceNew)(&view, &old.pBuckets[i], K_BUCKET_HASH(pSelf, &old.pBuckets[i]));
+    }
+    #ifdef K_MAP_SWISS
+    /* PlaceNew() may have reused tombstones. */
+    header.nDeleted = view.nDeleted;
+    memcpy(spOut.pData, &header, sizeof(header));
+    #endif
+#endif
+
+    return true;
+}
+
+K_DECL_MOD bool
+K_METHOD(LoadView)(K_NAME* pSelf, k_Span sp)
+{
+    k_MapSnapshotHeader header;
+    if (!sp.pData || sp.size < K_MAP_SNAPSHOT_HEADER_SIZE || ((uintptr_t)sp.pData & 7) != 0) return false;
+    memcpy(&header, sp.pData, sizeof(header));
+
+    if (header.magic != K_MAP_SNAPSHOT_MAGIC ||
+        header.bucketSize != sizeof(K_BUCKET) ||
+        header.mode != K_METHOD(SnapshotMode)() ||
+        header.cap < 0 || (header.cap & (header.cap - 1)) != 0 ||
+        header.size < 0 || header.size > header.cap ||
+        (sp.size - K_MAP_SNAPSHOT_HEADER_SIZE) / (ssize_t)(sizeof(K_BUCKET) + sizeof(K_MAP_BUCKET_FLAG)) < header.cap
+    )
+    {
+        return false;
+    }
+
+    *pSelf = (K_NAME){0};
+    pSelf->pBuckets = header.cap > 0 ? (K_BUCKET*)((uint8_t*)sp.pData + K_MAP_SNAPSHOT_HEADER_SIZE) : NULL;
+    pSelf->cap = header.cap;
+    pSelf->size = header.size;
+#ifdef K_MAP_SWISS
+    pSelf->nDeleted = header.nDeleted;
+#endif
+#ifdef K_MAP_SEEDED
+    pSelf->seed = header.seed;
+#endif
+
+    return true;
+}
+
+#ifdef K_MAP_INCREMENTAL
+
+K_DECL_MOD K_NAME
+K_METHOD(OldTable)(K_NAME* pSelf)
+{
+    K_NAME old = {.pBuckets = pSelf->pOldBuckets, .size = pSelf->oldSize, .cap = pSelf->oldCap};
+#ifdef K_MAP_SEEDED
+    old.seed = pSelf->seed;
+#endif
+    return old;
+}
+
+K_DECL_MOD void
+K_METHOD(Migrate)(K_NAME* pSelf, k_IAllocator* pAllocOrNull, ssize_t nBuckets)
+{
+    if (!pSelf->pOldBuckets) return;
+
+    K_MAP_BUCKET_FLAG* pOldFlags = (K_MAP_BUCKET_FLAG*)(pSelf->pOldBuckets + pSelf->oldCap);
+    const ssize_t endI = K_MIN(pSelf->oldCap, pSelf->migrateI + nBuckets);
+    for (; pSelf->migrateI < endI; ++pSelf->migrateI)
+    {
+        const ssize_t i = pSelf->migrateI;
+        if (!K_IS_OCCUPIED(pOldFlags[i])) continue;
+
+        K_METHOD(PlaceNew)(pSelf, &pSelf->pOldBuckets[i], K_BUCKET_HASH(pSelf, &pSelf->pOldBuckets[i]));
+        /* Tombstone keeps old probe chains intact for the keys that are still there. */
+        pOldFlags[i] = K_FLAG_DELETED;
+        --pSelf->oldSize;
+    }
+
+    if (pSelf->migrateI >= pSelf->oldCap && pAllocOrNull)
+    {
+        k_IAllocatorFree(pAllocOrNull, pSelf->pOldBuckets);
+        pSelf->pOldBuckets = NULL;
+        pSelf->oldCap = 0;
+        pSelf->migrateI = 0;
+    }
+}
+
+#endif
+
+#ifdef K_MAP_SWISS
+
+K_DECL_MOD ssize_t
+K_METHOD(FreeI)(K_NAME* pSelf, uint64_t hash)
+{
+    const ssize_t mask = pSelf->cap - 1;
+    const uint8_t* pCtrl = K_METHOD(Flags)(pSelf);
+    ssize_t groupI = (ssize_t)(hash >> 7) & mask & ~(ssize_t)(K_MAP_GROUP_SIZE - 1);
+
+    /* Triangular steps over groups visit every group when the number of groups is a power of two. */
+    for (ssize_t step = K_MAP_GROUP_SIZE; ; step += K_MAP_GROUP_SIZE)
+    {
+        const uint32_t freeMask = k_MapGroupMatchEmptyOrDeleted(pCtrl + groupI);
+        if (freeMask) return groupI + k_ctz64(freeMask);
+        groupI = (groupI + step) & mask;
+    }
+}
+
+K_DECL_MOD void
+K_METHOD(RehashInPlace)(K_NAME* pSelf)
+{
+    if (pSelf->nDeleted <= 0) return;
+
+    uint8_t* pCtrl = K_METHOD(Flags)(pSelf);
+
+    /* Tombstones become empty, full buckets become deleted, meaning "not placed yet". */
+    for (ssize_t i = 0; i < pSelf->cap; ++i)
+        pCtrl[i] = k_MapCtrlIsFull(pCtrl[i]) ? K_MAP_CTRL_DELETED : K_MAP_CTRL_EMPTY;
+
+    for (ssize_t i = 0; i < pSelf->cap; ++i)
+    {
+        if (pCtrl[i] != K_MAP_CTRL_DELETED) continue;
+
+        const uint64_t hash = K_BUCKET_HASH(pSelf, &pSelf->pBuckets[i]);
+        const uint8_t h2 = (uint8_t)(hash & 0x7f);
+        const ssize_t targetI = K_METHOD(FreeI)(pSelf, hash);
+        const ssize_t groupMask = ~(ssize_t)(K_MAP_GROUP_SIZE - 1);
+
+        if ((targetI & groupMask) == (i & groupMask))
+        {
+            /* Already in the first group its probe can use. */
+            pCtrl[i] = h2;
+        }
+        else if (pCtrl[targetI] == K_MAP_CTRL_EMPTY)
+        {
+            pSelf->pBuckets[targetI] = pSelf->pBuckets[i];
+            pCtrl[targetI] = h2;
+            pCtrl[i] = K_MAP_CTRL_EMPTY;
+        }
+        else
+        {
+            /* Target holds another unplaced bucket: swap and place that one next. */
+            const K_BUCKET tmp = pSelf->pBuckets[targetI];
+            pSelf->pBuckets[targetI] = pSelf->pBuckets[i];
+            pSelf->pBuckets[i] = tmp;
+            pCtrl[targetI] = h2;
+            --i;
+        }
+    }
+
+    pSelf->nDeleted = 0;
+}
+
+K_DECL_MOD ssize_t
+K_METHOD(InsertionI)(K_NAME* pSelf, const K_KEY_T* pKey, uint64_t hash)
+{
+    const ssize_t mask = pSelf->cap - 1;
+    const uint8_t h2 = (uint8_t)(hash & 0x7f);
+    const uint8_t* pCtrl = K_METHOD(Flags)(pSelf);
+    ssize_t groupI = (ssize_t)(hash >> 7) & mask & ~(ssize_t)(K_MAP_GROUP_SIZE - 1);
+    ssize_t freeI = K_NPOS;
+
+    for (ssize_t step = K_MAP_GROUP_SIZE; ; step += K_MAP_GROUP_SIZE)
+    {
+        for (uint32_t match = k_MapGroupMatch(pCtrl + groupI, h2); match; match &= match - 1)
+        {
+            const ssize_t idx = groupI + k_ctz64(match);
+            if (K_KEY_EQ(&pSelf->pBuckets[idx], pKey, hash)) return idx;
+        }
+
+        if (freeI == K_NPOS)
+        {
+            const uint32_t freeMask = k_MapGroupMatchEmptyOrDeleted(pCtrl + groupI);
+            if (freeMask) freeI = groupI + k_ctz64(freeMask);
+        }
+
+        if (k_MapGroupMatchEmpty(pCtrl + groupI)) return freeI;
+        groupI = (groupI + step) & mask;
+    }
+}
+
+#else
+
 K_DECL_MOD ssize_t
 K_METHOD(InsertionI)(K_NAME* pSelf, const K_KEY_T* pKey, uint64_t hash)
 {
@@ -157,56 +657,116 @@ K_METHOD(InsertionI)(K_NAME* pSelf, const K_KEY_T* pKey, uint64_t hash)
 
     while (pEFlags[idx] == K_MAP_BUCKET_FLAG_OCCUPIED)
     {
-        if (K_FN_KEY_CMP(&pSelf->pBuckets[idx].key, pKey) == 0) break;
+        if (K_KEY_EQ(&pSelf->pBuckets[idx], pKey, hash)) break;
         idx = (idx + 1) & (pSelf->cap - 1);
     }
 
     return idx;
 }
 
+#endif
+
 K_DECL_MOD K_MAP_RESULT
-K_METHOD(InsertHashed)(K_NAME* pSelf, k_IAllocator* pAlloc, const K_KEY_T* pKey, const K_VALUE_T* pVal, uint64_t hash)
+K_METHOD(InsertHashed)(K_NAME* pSelf, k_IAllocator* pAlloc, const K_KEY_T* pKey K_VAL_PARAM, uint64_t hash)
 {
     if (pSelf->cap <= 0)
     {
         if (!K_METHOD(Init)(pSelf, pAlloc, 8))
             return (K_MAP_RESULT){.eStatus = K_MAP_RESULT_STATUS_FAILED, .hash = hash};
     }
-    else if (K_METHOD(LoadFactor)(pSelf) >= K_MAP_LOAD_FACTOR)
+#ifdef K_MAP_SWISS
+    else if ((float)(K_NEW_SIZE(pSelf) + pSelf->nDeleted + 1) > (float)pSelf->cap * K_MAP_SWISS_LOAD_FACTOR)
     {
-        if (!K_METHOD(Rehash)(pSelf, pAlloc, K_MAX(8, pSelf->cap * 2)))
+        /* Mostly tombstones: purge them without growing. */
+        if ((float)K_NEW_SIZE(pSelf) * 2.0f < (float)pSelf->cap * K_MAP_SWISS_LOAD_FACTOR)
+            K_METHOD(RehashInPlace)(pSelf);
+        else if (!K_METHOD(Grow)(pSelf, pAlloc, pSelf->cap * 2))
             return (K_MAP_RESULT){.eStatus = K_MAP_RESULT_STATUS_FAILED, .hash = hash};
     }
+#else
+    else if ((float)K_NEW_SIZE(pSelf) / (float)pSelf->cap >= K_MAP_LOAD_FACTOR)
+    {
+        if (!K_METHOD(Grow)(pSelf, pAlloc, K_MAX(8, pSelf->cap * 2)))
+            return (K_MAP_RESULT){.eStatus = K_MAP_RESULT_STATUS_FAILED, .hash = hash};
+    }
+#endif
+
+#ifdef K_MAP_INCREMENTAL
+    K_METHOD(Migrate)(pSelf, pAlloc, K_MAP_MIGRATE_STEP);
+    if (pSelf->oldSize > 0)
+    {
+        K_NAME old = K_METHOD(OldTable)(pSelf);
+        K_MAP_RESULT res = K_METHOD(SearchTable)(&old, pKey, hash);
+        if (res.eStatus == K_MAP_RESULT_STATUS_FOUND)
+        {
+            K_SET_VALUE(res.pBucket);
+            return res;
+        }
+    }
+#endif
 
+#ifdef K_MAP_SWISS
     const ssize_t idx = K_METHOD(InsertionI)(pSelf, pKey, hash);
     K_BUCKET* pBucket = &pSelf->pBuckets[idx];
     K_MAP_BUCKET_FLAG* pEFlag = K_METHOD(Flags)(pSelf) + idx;
 
-    *pEFlag = K_MAP_BUCKET_FLAG_OCCUPIED;
-    pBucket->value = *pVal;
+    if (k_MapCtrlIsFull(*pEFlag))
+    {
+        K_SET_VALUE(pBucket);
+        return (K_MAP_RESULT){.pBucket = pBucket, .hash = hash, .eFlag = K_MAP_BUCKET_FLAG_OCCUPIED, .eStatus = K_MAP_RESULT_STATUS_FOUND};
+    }
+
+    if (*pEFlag == K_MAP_CTRL_DELETED) --pSelf->nDeleted;
+    *pEFlag = (uint8_t)(hash & 0x7f);
+    pBucket->key = *pKey;
+    K_SET_VALUE(pBucket);
+#ifdef K_MAP_STORE_HASH
+    pBucket->hash = hash;
+#endif
+    ++pSelf->size;
+
+    return (K_MAP_RESULT){.pBucket = pBucket, .hash = hash, .eFlag = K_MAP_BUCKET_FLAG_OCCUPIED, .eStatus = K_MAP_RESULT_STATUS_INSERTED};
+#else
+    const ssize_t idx = K_METHOD(InsertionI)(pSelf, pKey, hash);
+    K_BUCKET* pBucket = &pSelf->pBuckets[idx];
+    K_MAP_BUCKET_FLAG* pEFlag = K_METHOD(Flags)(pSelf) + idx;
 
-    if (K_FN_KEY_CMP(&pBucket->key, pKey) == 0)
+    K_SET_VALUE(pBucket);
+
+    /* InsertionI only stops on an occupied bucket if it holds the key. */
+    if (*pEFlag == K_MAP_BUCKET_FLAG_OCCUPIED)
         return (K_MAP_RESULT){.pBucket = pBucket, .hash = hash, .eFlag = *pEFlag, .eStatus = K_MAP_RESULT_STATUS_FOUND};
 
+    *pEFlag = K_MAP_BUCKET_FLAG_OCCUPIED;
     pBucket->key = *pKey;
+#ifdef K_MAP_STORE_HASH
+    pBucket->hash = hash;
+#endif
     ++pSelf->size;
 
     return (K_MAP_RESULT){.pBucket = pBucket, .hash = hash, .eFlag = *pEFlag, .eStatus = K_MAP_RESULT_STATUS_INSERTED};
+#endif
 }
 
 K_DECL_MOD K_MAP_RESULT
-K_METHOD(Insert)(K_NAME* pSelf, k_IAllocator* pAlloc, const K_KEY_T* pKey, const K_VALUE_T* pVal)
+K_METHOD(Insert)(K_NAME* pSelf, k_IAllocator* pAlloc, const K_KEY_T* pKey K_VAL_PARAM)
 {
-    return K_METHOD(InsertHashed)(pSelf, pAlloc, pKey, pVal, K_FN_HASH(pKey));
+#ifdef K_MAP_SEEDED
+    if (!K_METHOD(InitIfEmpty)(pSelf, pAlloc)) return (K_MAP_RESULT){.eStatus = K_MAP_RESULT_STATUS_FAILED};
+#endif
+    return K_METHOD(InsertHashed)(pSelf, pAlloc, pKey K_VAL_ARG, K_HASH(pSelf, pKey));
 }
 
 K_DECL_MOD K_MAP_RESULT
-K_METHOD(TryInsert)(K_NAME* pSelf, k_IAllocator* pAlloc, const K_KEY_T* pKey, const K_VALUE_T* pVal)
+K_METHOD(TryInsert)(K_NAME* pSelf, k_IAllocator* pAlloc, const K_KEY_T* pKey K_VAL_PARAM)
 {
-    const uint64_t hash = K_FN_HASH(pKey);
+#ifdef K_MAP_SEEDED
+    if (!K_METHOD(InitIfEmpty)(pSelf, pAlloc)) return (K_MAP_RESULT){.eStatus = K_MAP_RESULT_STATUS_FAILED};
+#endif
+    const uint64_t hash = K_HASH(pSelf, pKey);
     K_MAP_RESULT r = K_METHOD(SearchHashed)(pSelf, pKey, hash);
     if (r.eStatus == K_MAP_RESULT_STATUS_FOUND) return r;
-    else return K_METHOD(InsertHashed)(pSelf, pAlloc, pKey, pVal, hash);
+    else return K_METHOD(InsertHashed)(pSelf, pAlloc, pKey K_VAL_ARG, hash);
 }
 
 K_DECL_MOD void
@@ -215,12 +775,39 @@ K_METHOD(RemoveI)(K_NAME* pSelf, ssize_t i)
     assert(pSelf);
     assert(i >= 0 && i < pSelf->cap);
 
-    K_BUCKET* pBucket = &pSelf->pBuckets[i];
-    K_MAP_BUCKET_FLAG* pEFlag = K_METHOD(Flags)(pSelf) + i;
+#ifdef K_MAP_SWISS
+    pSelf->pBuckets[i].key = (K_KEY_T){0};
+    K_ZERO_VALUE(&pSelf->pBuckets[i]);
 
-    pBucket->key = (K_KEY_T){0};
-    pBucket->value = (K_VALUE_T){0};
-    *pEFlag = K_MAP_BUCKET_FLAG_DELETED;
+    /* Probes never continue past a group that has an empty bucket, so nothing can depend on this one. */
+    uint8_t* pCtrl = K_METHOD(Flags)(pSelf);
+    if (k_MapGroupMatchEmpty(pCtrl + (i & ~(ssize_t)(K_MAP_GROUP_SIZE - 1))))
+    {
+        pCtrl[i] = K_MAP_CTRL_EMPTY;
+    }
+    else
+    {
+        pCtrl[i] = K_MAP_CTRL_DELETED;
+        ++pSelf->nDeleted;
+    }
+#else
+    /* Backward shift: pull following buckets of the cluster into the gap unless it would move them before their home. */
+    const ssize_t mask = pSelf->cap - 1;
+    K_MAP_BUCKET_FLAG* pEFlags = K_METHOD(Flags)(pSelf);
+    for (ssize_t j = (i + 1) & mask; pEFlags[j] == K_MAP_BUCKET_FLAG_OCCUPIED; j = (j + 1) & mask)
+    {
+        const ssize_t home = (ssize_t)(K_BUCKET_HASH(pSelf, &pSelf->pBuckets[j]) & (uint64_t)mask);
+        if (((j - home) & mask) >= ((j - i) & mask))
+        {
+            pSelf->pBuckets[i] = pSelf->pBuckets[j];
+            i = j;
+        }
+    }
+
+    pSelf->pBuckets[i].key = (K_KEY_T){0};
+    K_ZERO_VALUE(&pSelf->pBuckets[i]);
+    pEFlags[i] = K_MAP_BUCKET_FLAG_NONE;
+#endif
 
     --pSelf->size;
 }
@@ -228,30 +815,74 @@ K_METHOD(RemoveI)(K_NAME* pSelf, ssize_t i)
 K_DECL_MOD K_MAP_RESULT
 K_METHOD(Remove)(K_NAME* pSelf, const K_KEY_T* pKey)
 {
-    K_MAP_RESULT res = K_METHOD(Search(pSelf, pKey));
-    if (res.eStatus == K_MAP_RESULT_STATUS_NOT_FOUND)
+    const uint64_t hash = K_HASH(pSelf, pKey);
+    K_MAP_RESULT res = K_METHOD(SearchTable)(pSelf, pKey, hash);
+    if (res.eStatus == K_MAP_RESULT_STATUS_FOUND)
+    {
+        K_METHOD(RemoveI)(pSelf, res.pBucket - pSelf->pBuckets);
+        res.eStatus = K_MAP_RESULT_STATUS_REMOVED;
         return res;
+    }
+
+#ifdef K_MAP_INCREMENTAL
+    if (pSelf->oldSize > 0)
+    {
+        K_NAME old = K_METHOD(OldTable)(pSelf);
+        res = K_METHOD(SearchTable)(&old, pKey, hash);
+        if (res.eStatus == K_MAP_RESULT_STATUS_FOUND)
+        {
+            const ssize_t i = res.pBucket - pSelf->pOldBuckets;
+            res.pBucket->key = (K_KEY_T){0};
+            K_ZERO_VALUE(res.pBucket);
+            K_METHOD(Flags)(&old)[i] = K_FLAG_DELETED;
+            --pSelf->oldSize;
+            --pSelf->size;
+            res.eStatus = K_MAP_RESULT_STATUS_REMOVED;
+        }
+    }
+#endif
 
-    const ssize_t idx = res.pBucket - pSelf->pBuckets;
-    K_METHOD(RemoveI)(pSelf, idx);
-    res.eStatus = K_MAP_RESULT_STATUS_REMOVED;
     return res;
 }
 
 K_DECL_MOD K_MAP_RESULT
-K_METHOD(SearchHashed)(K_NAME* pSelf, const K_KEY_T* pKey, uint64_t hash)
+K_METHOD(SearchTable)(K_NAME* pSelf, const K_KEY_T* pKey, uint64_t hash)
 {
     K_MAP_RESULT res = {.eStatus = K_MAP_RESULT_STATUS_NOT_FOUND, .hash = hash};
 
     if (pSelf->size <= 0) return res;
 
+#ifdef K_MAP_SWISS
+    const ssize_t mask = pSelf->cap - 1;
+    const uint8_t h2 = (uint8_t)(hash & 0x7f);
+    const uint8_t* pCtrl = K_METHOD(Flags)(pSelf);
+    ssize_t groupI = (ssize_t)(hash >> 7) & mask & ~(ssize_t)(K_MAP_GROUP_SIZE - 1);
+
+    for (ssize_t step = K_MAP_GROUP_SIZE; ; step += K_MAP_GROUP_SIZE)
+    {
+        for (uint32_t match = k_MapGroupMatch(pCtrl + groupI, h2); match; match &= match - 1)
+        {
+            const ssize_t idx = groupI + k_ctz64(match);
+            if (K_KEY_EQ(&pSelf->pBuckets[idx], pKey, hash))
+            {
+                res.pBucket = &pSelf->pBuckets[idx];
+                res.eFlag = K_MAP_BUCKET_FLAG_OCCUPIED;
+                res.eStatus = K_MAP_RESULT_STATUS_FOUND;
+                return res;
+            }
+        }
+
+        if (k_MapGroupMatchEmpty(pCtrl + groupI)) return res;
+        groupI = (groupI + step) & mask;
+    }
+#else
     ssize_t idx = (ssize_t)(hash & (uint64_t)(pSelf->cap - 1));
     K_MAP_BUCKET_FLAG* pEFlags = K_METHOD(Flags)(pSelf);
 
     while (pEFlags[idx] != K_MAP_BUCKET_FLAG_NONE) /* deleted or occupied */
     {
         if (pEFlags[idx] != K_MAP_BUCKET_FLAG_DELETED &&
-            K_FN_KEY_CMP(&pSelf->pBuckets[idx].key, pKey) == 0
+            K_KEY_EQ(&pSelf->pBuckets[idx], pKey, hash)
         )
         {
             res.pBucket = (K_BUCKET*)(&pSelf->pBuckets[idx]);
@@ -264,20 +895,85 @@ K_METHOD(SearchHashed)(K_NAME* pSelf, const K_KEY_T* pKey, uint64_t hash)
     }
 
     return res;
+#endif
+}
+
+K_DECL_MOD K_MAP_RESULT
+K_METHOD(SearchHashed)(K_NAME* pSelf, const K_KEY_T* pKey, uint64_t hash)
+{
+#ifdef K_MAP_INCREMENTAL
+    K_MAP_RESULT res = K_METHOD(SearchTable)(pSelf, pKey, hash);
+    if (res.eStatus == K_MAP_RESULT_STATUS_FOUND || pSelf->oldSize <= 0) return res;
+
+    K_NAME old = K_METHOD(OldTable)(pSelf);
+    return K_METHOD(SearchTable)(&old, pKey, hash);
+#else
+    return K_METHOD(SearchTable)(pSelf, pKey, hash);
+#endif
 }
 
 K_DECL_MOD K_MAP_RESULT
 K_METHOD(Search)(K_NAME* pSelf, const K_KEY_T* pKey)
 {
-    return K_METHOD(SearchHashed)(pSelf, pKey, K_FN_HASH(pKey));
+    return K_METHOD(SearchHashed)(pSelf, pKey, K_HASH(pSelf, pKey));
+}
+
+K_DECL_MOD ssize_t
+K_METHOD(SearchBatch)(K_NAME* pSelf, const K_KEY_T* pKeys, ssize_t n, K_MAP_RESULT* pResults)
+{
+    uint64_t aHashes[K_MAP_SEARCH_BATCH];
+    ssize_t nFound = 0;
+    const ssize_t mask = pSelf->cap - 1;
+    const K_MAP_BUCKET_FLAG* pEFlags = pSelf->cap > 0 ? K_METHOD(Flags)(pSelf) : NULL;
+
+    for (ssize_t off = 0; off < n; off += K_MAP_SEARCH_BATCH)
+    {
+        const ssize_t batchSize = K_MIN(K_MAP_SEARCH_BATCH, n - off);
+
+        /* Hash everything first so the misses on the home buckets overlap. */
+        for (ssize_t i = 0; i < batchSize; ++i)
+        {
+            const uint64_t hash = aHashes[i] = K_HASH(pSelf, &pKeys[off + i]);
+            if (!pEFlags) continue;
+#ifdef K_MAP_SWISS
+            K_PREFETCH(pEFlags + ((ssize_t)(hash >> 7) & mask & ~(ssize_t)(K_MAP_GROUP_SIZE - 1)));
+#else
+            K_PREFETCH(pEFlags + ((ssize_t)hash & mask));
+            K_PREFETCH(&pSelf->pBuckets[(ssize_t)hash & mask]);
+#endif
+        }
+
+#ifdef K_MAP_SWISS
+        /* Control groups are in cache now, prefetch the buckets the first match points to. */
+        for (ssize_t i = 0; pEFlags && i < batchSize; ++i)
+        {
+            const ssize_t groupI = (ssize_t)(aHashes[i] >> 7) & mask & ~(ssize_t)(K_MAP_GROUP_SIZE - 1);
+            const uint32_t match = k_MapGroupMatch(pEFlags + groupI, (uint8_t)(aHashes[i] & 0x7f));
+            if (match) K_PREFETCH(&pSelf->pBuckets[groupI + k_ctz64(match)]);
+        }
+#endif
+
+        for (ssize_t i = 0; i < batchSize; ++i)
+        {
+            pResults[off + i] = K_METHOD(SearchHashed)(pSelf, &pKeys[off + i], aHashes[i]);
+            if (pResults[off + i].eStatus == K_MAP_RESULT_STATUS_FOUND) ++nFound;
+        }
+    }
+
+    return nFound;
 }
 
 K_DECL_MOD ssize_t
 K_METHOD(FirstI)(K_NAME* pSelf)
 {
+#ifdef K_MAP_INCREMENTAL
+    /* Iteration only walks pBuckets. The drained old array is freed by the next insert. */
+    K_METHOD(Migrate)(pSelf, NULL, pSelf->oldCap);
+#endif
+
     ssize_t i = 0;
     K_MAP_BUCKET_FLAG* pEFlags = K_METHOD(Flags)(pSelf);
-    while (i < pSelf->cap && pEFlags[i] != K_MAP_BUCKET_FLAG_OCCUPIED)
+    while (i < pSelf->cap && !K_IS_OCCUPIED(pEFlags[i]))
         ++i;
 
     return i;
@@ -286,9 +982,13 @@ K_METHOD(FirstI)(K_NAME* pSelf)
 K_DECL_MOD ssize_t
 K_METHOD(LastI)(K_NAME* pSelf)
 {
+#ifdef K_MAP_INCREMENTAL
+    K_METHOD(Migrate)(pSelf, NULL, pSelf->oldCap);
+#endif
+
     K_MAP_BUCKET_FLAG* pEFlags = K_METHOD(Flags)(pSelf);
     ssize_t i = pSelf->cap - 1;
-    while (i >= 0 && pEFlags[i] != K_MAP_BUCKET_FLAG_OCCUPIED)
+    while (i >= 0 && !K_IS_OCCUPIED(pEFlags[i]))
         --i;
 
     return i;
@@ -299,7 +999,7 @@ K_METHOD(NextI)(K_NAME* pSelf, ssize_t i)
 {
     K_MAP_BUCKET_FLAG* pEFlags = K_METHOD(Flags)(pSelf);
     do ++i;
-    while (i < pSelf->cap && pEFlags[i] != K_MAP_BUCKET_FLAG_OCCUPIED);
+    while (i < pSelf->cap && !K_IS_OCCUPIED(pEFlags[i]));
 
     return i;
 }
@@ -316,11 +1016,90 @@ K_METHOD(EndI)(K_NAME* pSelf)
     return pSelf->cap;
 }
 
+#ifdef K_MAP_NO_VALUE
+
+K_DECL_MOD bool
+K_METHOD(UnionWith)(K_NAME* pSelf, k_IAllocator* pAlloc, K_NAME* pOther)
+{
+    if (!K_METHOD(Reserve)(pSelf, pAlloc, pSelf->size + pOther->size)) return false;
+
+    for (ssize_t i = K_METHOD(FirstI)(pOther); i != K_METHOD(EndI)(pOther); i = K_METHOD(NextI)(pOther, i))
+    {
+        const K_BUCKET* pBucket = &pOther->pBuckets[i];
+        if (K_METHOD(InsertHashed)(pSelf, pAlloc, &pBucket->key, K_BUCKET_HASH_FOR(pSelf, pOther, pBucket)).eStatus == K_MAP_RESULT_STATUS_FAILED)
+            return false;
+    }
+
+    return true;
+}
+
+K_DECL_MOD bool
+K_METHOD(Intersect)(K_NAME* pDst, k_IAllocator* pAlloc, K_NAME* pA, K_NAME* pB)
+{
+    /* Walk the smaller one, probe the bigger one. */
+    if (pA->size > pB->size) K_SWAP(pA, pB);
+
+    *pDst = (K_NAME){0};
+    if (!K_METHOD(Reserve)(pDst, pAlloc, pA->size)) return false;
+#ifdef K_MAP_SEEDED
+    pDst->seed = pA->seed; /* Buckets are copied from pA as they are. */
+#endif
+
+    for (ssize_t i = K_METHOD(FirstI)(pA); i != K_METHOD(EndI)(pA); i = K_METHOD(NextI)(pA, i))
+    {
+        const K_BUCKET* pBucket = &pA->pBuckets[i];
+        const uint64_t hash = K_BUCKET_HASH(pA, pBucket);
+        if (K_METHOD(SearchHashed)(pB, &pBucket->key, K_BUCKET_HASH_FOR(pB, pA, pBucket)).eStatus == K_MAP_RESULT_STATUS_FOUND)
+        {
+            K_METHOD(PlaceNew)(pDst, pBucket, hash);
+            ++pDst->size;
+        }
+    }
+
+    return true;
+}
+
+K_DECL_MOD bool
+K_METHOD(Difference)(K_NAME* pDst, k_IAllocator* pAlloc, K_NAME* pA, K_NAME* pB)
+{
+    *pDst = (K_NAME){0};
+    if (!K_METHOD(Reserve)(pDst, pAlloc, pA->size)) return false;
+#ifdef K_MAP_SEEDED
+    pDst->seed = pA->seed; /* Buckets are copied from pA as they are. */
+#endif
+
+    for (ssize_t i = K_METHOD(FirstI)(pA); i != K_METHOD(EndI)(pA); i = K_METHOD(NextI)(pA, i))
+    {
+        const K_BUCKET* pBucket = &pA->pBuckets[i];
+        const uint64_t hash = K_BUCKET_HASH(pA, pBucket);
+        if (K_METHOD(SearchHashed)(pB, &pBucket->key, K_BUCKET_HASH_FOR(pB, pA, pBucket)).eStatus != K_MAP_RESULT_STATUS_FOUND)
+        {
+            K_METHOD(PlaceNew)(pDst, pBucket, hash);
+            ++pDst->size;
+        }
+    }
+
+    return true;
+}
+
+#endif
+
 #endif /* K_GEN_CODE */
 
 #undef K_BUCKET
 #undef K_METHOD
 #undef K_MAP_RESULT
+#undef K_IS_OCCUPIED
+#undef K_FLAG_DELETED
+#undef K_NEW_SIZE
+#undef K_BUCKET_HASH
+#undef K_BUCKET_HASH_FOR
+#undef K_HASH
+#undef K_KEY_EQ
+#undef K_VAL_PARAM
+#undef K_VAL_ARG
+#undef K_SET_VALUE
+#undef K_ZERO_VALUE
 
 #undef K_NAME
 #undef K_KEY_T
@@ -328,8 +1107,11 @@ K_METHOD(EndI)(K_NAME* pSelf)
 #undef K_FN_HASH
 #undef K_FN_KEY_CMP
 #undef K_DECL_MOD
-
-#undef K_DECL_MOD
+#undef K_MAP_SWISS
+#undef K_MAP_INCREMENTAL
+#undef K_MAP_STORE_HASH
+#undef K_MAP_NO_VALUE
+#undef K_MAP_SEEDED
 
 #undef K_GEN_DECLS
 #undef K_GEN_CODE
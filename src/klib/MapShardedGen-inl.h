@@ -0,0 +1,309 @@
+#include "MapDecl.h"
+#include "Thread.h"
+#include "hash.h"
+
+#ifndef K_NAME
+    #error "K_NAME is not defined"
+#endif
+
+#ifndef K_MAP
+    #error "K_MAP is not defined"
+#endif
+
+#ifndef K_KEY_T
+    #error "K_KEY_T is not defined"
+#endif
+
+#ifndef K_VALUE_T
+    #error "K_VALUE_T is not defined"
+#endif
+
+#ifndef K_FN_HASH
+    #error "K_FN_HASH is not defined"
+#endif
+
+#ifndef K_DECL_MOD
+    #define K_DECL_MOD static inline
+#endif
+
+#if !defined K_GEN_DECLS && !defined K_GEN_CODE
+    #define K_GEN_DECLS
+    #define K_GEN_CODE
+#endif
+
+/* Thread safe map: keys are split across a power of two number of shards,
+ * each one a K_MAP table (generated with MapGen-inl.h beforehand, same key/value/hash) with its own mutex.
+ * Shard is picked by the high bits of the mixed hash, tables index with the low ones, so the hash is computed once.
+ * Values are copied out under the lock, no bucket pointers escape.
+ * pAlloc has to be thread safe.
+ * K_MAP_SEEDED: K_MAP has to be generated with K_MAP_SEEDED as well, one random seed is shared by all shards. */
+
+#define K_METHOD(M) K_GLUE(K_NAME, M)
+#define K_MAP_METHOD(M) K_GLUE(K_MAP, M)
+#define K_SHARD K_METHOD(Shard)
+
+#ifdef K_MAP_SEEDED
+    #define K_HASH(pSelf, pKey) K_FN_HASH(pKey, (pSelf)->seed)
+#else
+    #define K_HASH(pSelf, pKey) K_FN_HASH(pKey)
+#endif
+
+#ifdef K_GEN_DECLS
+
+typedef struct K_SHARD
+{
+    k_Mutex mtx;
+    K_MAP map;
+    uint8_t aPad[64]; /* Keep neighbouring locks on different cache lines. */
+} K_SHARD;
+
+typedef struct K_NAME
+{
+    K_SHARD* pShards;
+    ssize_t nShards;
+#ifdef K_MAP_SEEDED
+    uint64_t seed;
+#endif
+} K_NAME;
+
+K_DECL_MOD bool K_METHOD(Init)(K_NAME* pSelf, k_IAllocator* pAlloc, ssize_t nShards, ssize_t prealloc); /* nShards is rounded up to a power of two. */
+K_DECL_MOD void K_METHOD(Destroy)(K_NAME* pSelf, k_IAllocator* pAlloc);
+K_DECL_MOD K_SHARD* K_METHOD(ShardOf)(K_NAME* pSelf, uint64_t hash);
+K_DECL_MOD K_MAP_RESULT_STATUS K_METHOD(Insert)(K_NAME* pSelf, k_IAllocator* pAlloc, const K_KEY_T* pKey, const K_VALUE_T* pVal);
+K_DECL_MOD K_MAP_RESULT_STATUS K_METHOD(TryInsert)(K_NAME* pSelf, k_IAllocator* pAlloc, const K_KEY_T* pKey, const K_VALUE_T* pVal);
+K_DECL_MOD bool K_METHOD(Remove)(K_NAME* pSelf, const K_KEY_T* pKey);
+K_DECL_MOD bool K_METHOD(Get)(K_NAME* pSelf, const K_KEY_T* pKey, K_VALUE_T* pValOut);
+K_DECL_MOD ssize_t K_METHOD(Size)(K_NAME* pSelf);
+
+/* Batches lock each shard once per K_MAP_SHARDED_BATCH keys. */
+K_DECL_MOD bool K_METHOD(InsertMany)(K_NAME* pSelf, k_IAllocator* pAlloc, const K_KEY_T* pKeys, const K_VALUE_T* pVals, ssize_t n); /* false if any insert failed. */
+K_DECL_MOD ssize_t K_METHOD(GetMany)(K_NAME* pSelf, const K_KEY_T* pKeys, ssize_t n, K_VALUE_T* pValsOut, bool* pbFoundOut); /* Returns number of found keys. */
+
+#endif /* K_GEN_DECLS */
+
+#ifdef K_GEN_CODE
+
+K_DECL_MOD bool
+K_METHOD(Init)(K_NAME* pSelf, k_IAllocator* pAlloc, ssize_t nShards, ssize_t prealloc)
+{
+    nShards = k_NextPowerofTwo64(K_MAX(1, nShards));
+
+    pSelf->pShards = k_IAllocatorZalloc(pAlloc, sizeof(K_SHARD) * nShards);
+    if (!pSelf->pShards) return false;
+
+#ifdef K_MAP_SEEDED
+    /* Shards get the same seed, the hash computed here is reused by the shard table. */
+    pSelf->seed = k_hash_randomSeed();
+    #define K_SHARD_INIT(pMap) K_MAP_METHOD(InitSeeded)(pMap, pAlloc, shardPrealloc, pSelf->seed)
+#else
+    #define K_SHARD_INIT(pMap) K_MAP_METHOD(Init)(pMap, pAlloc, shardPrealloc)
+#endif
+
+    const ssize_t shardPrealloc = K_MAX(8, prealloc / nShards);
+    for (ssize_t i = 0; i < nShards; ++i)
+    {
+        if (!k_MutexInitPlain(&pSelf->pShards[i].mtx) || !K_SHARD_INIT(&pSelf->pShards[i].map))
+        {
+            pSelf->nShards = i + 1;
+            K_METHOD(Destroy)(pSelf, pAlloc);
+            return false;
+        }
+    }
+
+#undef K_SHARD_INIT
+
+    pSelf->nShards = nShards;
+    return true;
+}
+
+K_DECL_MOD void
+K_METHOD(Destroy)(K_NAME* pSelf, k_IAllocator* pAlloc)
+{
+    for (ssize_t i = 0; i < pSelf->nShards; ++i)
+    {
+        K_MAP_METHOD(Destroy)(&pSelf->pShards[i].map, pAlloc);
+        k_MutexDestroy(&pSelf->pShards[i].mtx);
+    }
+
+    k_IAllocatorFree(pAlloc, pSelf->pShards);
+    *pSelf = (K_NAME){0};
+}
+
+K_DECL_MOD K_SHARD*
+K_METHOD(ShardOf)(K_NAME* pSelf, uint64_t hash)
+{
+    /* Mixed, so hashes with only 32 good bits (k_hash_crc32) still spread. */
+    return &pSelf->pShards[(ssize_t)((hash * 0x9e3779b97f4a7c15LLU) >> 40) & (pSelf->nShards - 1)];
+}
+
+K_DECL_MOD K_MAP_RESULT_STATUS
+K_METHOD(Insert)(K_NAME* pSelf, k_IAllocator* pAlloc, const K_KEY_T* pKey, const K_VALUE_T* pVal)
+{
+    const uint64_t hash = K_HASH(pSelf, pKey);
+    K_SHARD* pShard = K_METHOD(ShardOf)(pSelf, hash);
+
+    k_MutexLock(&pShard->mtx);
+    const K_MAP_RESULT_STATUS eStatus = K_MAP_METHOD(InsertHashed)(&pShard->map, pAlloc, pKey, pVal, hash).eStatus;
+    k_MutexUnlock(&pShard->mtx);
+
+    return eStatus;
+}
+
+K_DECL_MOD K_MAP_RESULT_STATUS
+K_METHOD(TryInsert)(K_NAME* pSelf, k_IAllocator* pAlloc, const K_KEY_T* pKey, const K_VALUE_T* pVal)
+{
+    const uint64_t hash = K_HASH(pSelf, pKey);
+    K_SHARD* pShard = K_METHOD(ShardOf)(pSelf, hash);
+    K_MAP_RESULT_STATUS eStatus;
+
+    k_MutexLock(&pShard->mtx);
+    {
+        eStatus = K_MAP_METHOD(SearchHashed)(&pShard->map, pKey, hash).eStatus;
+        if (eStatus != K_MAP_RESULT_STATUS_FOUND)
+            eStatus = K_MAP_METHOD(InsertHashed)(&pShard->map, pAlloc, pKey, pVal, hash).eStatus;
+    }
+    k_MutexUnlock(&pShard->mtx);
+
+    return eStatus;
+}
+
+K_DECL_MOD bool
+K_METHOD(Remove)(K_NAME* pSelf, const K_KEY_T* pKey)
+{
+    K_SHARD* pShard = K_METHOD(ShardOf)(pSelf, K_HASH(pSelf, pKey));
+
+    k_MutexLock(&pShard->mtx);
+    const bool bRemoved = K_MAP_METHOD(Remove)(&pShard->map, pKey).eStatus == K_MAP_RESULT_STATUS_REMOVED;
+    k_MutexUnlock(&pShard->mtx);
+
+    return bRemoved;
+}
+
+K_DECL_MOD bool
+K_METHOD(Get)(K_NAME* pSelf, const K_KEY_T* pKey, K_VALUE_T* pValOut)
+{
+    const uint64_t hash = K_HASH(pSelf, pKey);
+    K_SHARD* pShard = K_METHOD(ShardOf)(pSelf, hash);
+
+    k_MutexLock(&pShard->mtx);
+    K_GLUE(K_MAP, Result) res = K_MAP_METHOD(SearchHashed)(&pShard->map, pKey, hash);
+    const bool bFound = res.eStatus == K_MAP_RESULT_STATUS_FOUND;
+    if (bFound && pValOut) *pValOut = res.pBucket->value;
+    k_MutexUnlock(&pShard->mtx);
+
+    return bFound;
+}
+
+K_DECL_MOD ssize_t
+K_METHOD(Size)(K_NAME* pSelf)
+{
+    ssize_t size = 0;
+    for (ssize_t i = 0; i < pSelf->nShards; ++i)
+    {
+        k_MutexLock(&pSelf->pShards[i].mtx);
+        size += pSelf->pShards[i].map.size;
+        k_MutexUnlock(&pSelf->pShards[i].mtx);
+    }
+
+    return size;
+}
+
+K_DECL_MOD bool
+K_METHOD(InsertMany)(K_NAME* pSelf, k_IAllocator* pAlloc, const K_KEY_T* pKeys, const K_VALUE_T* pVals, ssize_t n)
+{
+    uint64_t aHashes[K_MAP_SHARDED_BATCH];
+    K_SHARD* apShards[K_MAP_SHARDED_BATCH];
+    bool bOk = true;
+
+    for (ssize_t off = 0; off < n; off += K_MAP_SHARDED_BATCH)
+    {
+        const ssize_t batchSize = K_MIN(K_MAP_SHARDED_BATCH, n - off);
+        for (ssize_t i = 0; i < batchSize; ++i)
+        {
+            aHashes[i] = K_HASH(pSelf, &pKeys[off + i]);
+            apShards[i] = K_METHOD(ShardOf)(pSelf, aHashes[i]);
+        }
+
+        /* Take the first pending shard, do all of its keys, mark them done. */
+        for (ssize_t i = 0; i < batchSize; ++i)
+        {
+            K_SHARD* pShard = apShards[i];
+            if (!pShard) continue;
+
+            k_MutexLock(&pShard->mtx);
+            for (ssize_t j = i; j < batchSize; ++j)
+            {
+                if (apShards[j] != pShard) continue;
+
+                const K_MAP_RESULT_STATUS eStatus = K_MAP_METHOD(InsertHashed)(
+                    &pShard->map, pAlloc, &pKeys[off + j], &pVals[off + j], aHashes[j]
+                ).eStatus;
+                if (eStatus == K_MAP_RESULT_STATUS_FAILED) bOk = false;
+                apShards[j] = NULL;
+            }
+            k_MutexUnlock(&pShard->mtx);
+        }
+    }
+
+    return bOk;
+}
+
+K_DECL_MOD ssize_t
+K_METHOD(GetMany)(K_NAME* pSelf, const K_KEY_T* pKeys, ssize_t n, K_VALUE_T* pValsOut, bool* pbFoundOut)
+{
+    uint64_t aHashes[K_MAP_SHARDED_BATCH];
+    K_SHARD* apShards[K_MAP_SHARDED_BATCH];
+    ssize_t nFound = 0;
+
+    for (ssize_t off = 0; off < n; off += K_MAP_SHARDED_BATCH)
+    {
+        const ssize_t batchSize = K_MIN(K_MAP_SHARDED_BATCH, n - off);
+        for (ssize_t i = 0; i < batchSize; ++i)
+        {
+            aHashes[i] = K_HASH(pSelf, &pKeys[off + i]);
+            apShards[i] = K_METHOD(ShardOf)(pSelf, aHashes[i]);
+        }
+
+        for (ssize_t i = 0; i < batchSize; ++i)
+        {
+            K_SHARD* pShard = apShards[i];
+            if (!pShard) continue;
+
+            k_MutexLock(&pShard->mtx);
+            for (ssize_t j = i; j < batchSize; ++j)
+            {
+                if (apShards[j] != pShard) continue;
+
+                K_GLUE(K_MAP, Result) res = K_MAP_METHOD(SearchHashed)(&pShard->map, &pKeys[off + j], aHashes[j]);
+                const bool bFound = res.eStatus == K_MAP_RESULT_STATUS_FOUND;
+                if (bFound)
+                {
+                    if (pValsOut) pValsOut[off + j] = res.pBucket->value;
+                    ++nFound;
+                }
+                if (pbFoundOut) pbFoundOut[off + j] = bFound;
+                apShards[j] = NULL;
+            }
+            k_MutexUnlock(&pShard->mtx);
+        }
+    }
+
+    return nFound;
+}
+
+#endif /* K_GEN_CODE */
+
+#undef K_METHOD
+#undef K_MAP_METHOD
+#undef K_SHARD
+#undef K_HASH
+
+#undef K_NAME
+#undef K_MAP
+#undef K_KEY_T
+#undef K_VALUE_T
+#undef K_FN_HASH
+#undef K_MAP_SEEDED
+#undef K_DECL_MOD
+#undef K_GEN_DECLS
+#undef K_GEN_CODE
@@ -0,0 +1,215 @@
+#include "MapDecl.h"
+#include "Epoch.h"
+
+#ifndef K_NAME
+    #error "K_NAME is not defined"
+#endif
+
+#ifndef K_MAP
+    #error "K_MAP is not defined"
+#endif
+
+#ifndef K_KEY_T
+    #error "K_KEY_T is not defined"
+#endif
+
+#ifndef K_VALUE_T
+    #error "K_VALUE_T is not defined"
+#endif
+
+#ifndef K_DECL_MOD
+    #define K_DECL_MOD static inline
+#endif
+
+#if !defined K_GEN_DECLS && !defined K_GEN_CODE
+    #define K_GEN_DECLS
+    #define K_GEN_CODE
+#endif
+
+/* Read-copy-update map for read-mostly tables. K_MAP is a table type generated with MapGen-inl.h beforehand.
+ * Readers load the current table pointer and search it without locks or stores.
+ * Writers serialize on a mutex, clone the table, modify the clone, publish it and retire the old one to pEpoch.
+ * Read() and Get() are only safe on threads registered online with pEpoch, the table stays valid until the thread's
+ * next k_EpochQuiescent()/k_EpochOffline(). For k_ThreadPool workers (with pEpochOrNull set) that is the end of the task.
+ * pAlloc has to be thread safe, retired tables are freed from whichever thread collects them. */
+
+#define K_METHOD(M) K_GLUE(K_NAME, M)
+#define K_MAP_METHOD(M) K_GLUE(K_MAP, M)
+#define K_UPDATE_PFN K_METHOD(UpdatePfn)
+
+#ifdef K_GEN_DECLS
+
+typedef bool (*K_UPDATE_PFN)(K_MAP* pCopy, k_IAllocator* pAlloc, void* pUser); /* Return false to discard the copy. */
+
+typedef struct K_NAME
+{
+    k_atomic_Ptr atomPMap; /* K_MAP*. */
+    k_Epoch* pEpoch;
+    k_IAllocator* pAlloc;
+    k_Mutex mtxWrite;
+} K_NAME;
+
+K_DECL_MOD bool K_METHOD(Init)(K_NAME* pSelf, k_IAllocator* pAlloc, k_Epoch* pEpoch, ssize_t prealloc);
+K_DECL_MOD void K_METHOD(Destroy)(K_NAME* pSelf); /* NOTE: No readers left. Retired tables are freed by pEpoch. */
+K_DECL_MOD K_MAP* K_METHOD(Read)(K_NAME* pSelf); /* Don't modify. */
+K_DECL_MOD bool K_METHOD(Get)(K_NAME* pSelf, const K_KEY_T* pKey, K_VALUE_T* pValOutOrNull);
+
+/* Each call copies the table once, batch updates with InsertMany() or Update(). */
+K_DECL_MOD bool K_METHOD(Update)(K_NAME* pSelf, K_UPDATE_PFN pfn, void* pUser);
+K_DECL_MOD bool K_METHOD(Insert)(K_NAME* pSelf, const K_KEY_T* pKey, const K_VALUE_T* pVal);
+K_DECL_MOD bool K_METHOD(InsertMany)(K_NAME* pSelf, const K_KEY_T* pKeys, const K_VALUE_T* pVals, ssize_t n);
+K_DECL_MOD bool K_METHOD(Remove)(K_NAME* pSelf, const K_KEY_T* pKey); /* Doesn't copy if the key is absent. */
+
+K_DECL_MOD void K_METHOD(FreeTable)(void* pAlloc, void* pMap); /* k_EpochFreePfn. */
+
+#endif /* K_GEN_DECLS */
+
+#ifdef K_GEN_CODE
+
+K_DECL_MOD bool
+K_METHOD(Init)(K_NAME* pSelf, k_IAllocator* pAlloc, k_Epoch* pEpoch, ssize_t prealloc)
+{
+    K_MAP* pMap = k_IAllocatorZalloc(pAlloc, sizeof(K_MAP));
+    if (!pMap) return false;
+
+    if (!K_MAP_METHOD(Init)(pMap, pAlloc, prealloc) || !k_MutexInitPlain(&pSelf->mtxWrite))
+    {
+        K_METHOD(FreeTable)(pAlloc, pMap);
+        return false;
+    }
+
+    pSelf->pEpoch = pEpoch;
+    pSelf->pAlloc = pAlloc;
+    k_AtomicPtrStoreRelease(&pSelf->atomPMap, pMap);
+    return true;
+}
+
+K_DECL_MOD void
+K_METHOD(Destroy)(K_NAME* pSelf)
+{
+    K_METHOD(FreeTable)(pSelf->pAlloc, k_AtomicPtrExchangeAcqRel(&pSelf->atomPMap, NULL));
+    k_MutexDestroy(&pSelf->mtxWrite);
+}
+
+K_DECL_MOD void
+K_METHOD(FreeTable)(void* pAlloc, void* pMap)
+{
+    K_MAP_METHOD(Destroy)(pMap, pAlloc);
+    k_IAllocatorFree(pAlloc, pMap);
+}
+
+K_DECL_MOD K_MAP*
+K_METHOD(Read)(K_NAME* pSelf)
+{
+    return k_AtomicPtrLoadAcquire(&pSelf->atomPMap);
+}
+
+K_DECL_MOD bool
+K_METHOD(Get)(K_NAME* pSelf, const K_KEY_T* pKey, K_VALUE_T* pValOutOrNull)
+{
+    K_GLUE(K_MAP, Result) res = K_MAP_METHOD(Search)(K_METHOD(Read)(pSelf), pKey);
+    if (res.eStatus != K_MAP_RESULT_STATUS_FOUND) return false;
+
+    if (pValOutOrNull) *pValOutOrNull = res.pBucket->value;
+    return true;
+}
+
+K_DECL_MOD bool
+K_METHOD(Update)(K_NAME* pSelf, K_UPDATE_PFN pfn, void* pUser)
+{
+    bool bOk = false;
+
+    k_MutexLock(&pSelf->mtxWrite);
+    {
+        K_MAP* pOld = k_AtomicPtrLoadAcquire(&pSelf->atomPMap);
+        K_MAP* pNew = k_IAllocatorMalloc(pSelf->pAlloc, sizeof(K_MAP));
+        if (!pNew) goto done;
+
+        if (!K_MAP_METHOD(Clone)(pOld, pSelf->pAlloc, pNew))
+        {
+            k_IAllocatorFree(pSelf->pAlloc, pNew);
+            goto done;
+        }
+
+        if (!pfn(pNew, pSelf->pAlloc, pUser))
+        {
+            K_METHOD(FreeTable)(pSelf->pAlloc, pNew);
+            goto done;
+        }
+
+        k_AtomicPtrStoreRelease(&pSelf->atomPMap, pNew);
+        /* If this fails pOld leaks: some reader may still hold it. */
+        bOk = k_EpochRetire(pSelf->pEpoch, pOld, K_METHOD(FreeTable), pSelf->pAlloc);
+    }
+done:
+    k_MutexUnlock(&pSelf->mtxWrite);
+
+    k_EpochCollect(pSelf->pEpoch);
+    return bOk;
+}
+
+typedef struct K_METHOD(ManyArgs)
+{
+    const K_KEY_T* pKeys;
+    const K_VALUE_T* pVals;
+    ssize_t n;
+} K_METHOD(ManyArgs);
+
+static inline bool
+K_METHOD(InsertManyPfn)(K_MAP* pCopy, k_IAllocator* pAlloc, void* pUser)
+{
+    K_METHOD(ManyArgs)* pArgs = pUser;
+    for (ssize_t i = 0; i < pArgs->n; ++i)
+    {
+        if (K_MAP_METHOD(Insert)(pCopy, pAlloc, &pArgs->pKeys[i], &pArgs->pVals[i]).eStatus == K_MAP_RESULT_STATUS_FAILED)
+            return false;
+    }
+
+    return true;
+}
+
+K_DECL_MOD bool
+K_METHOD(InsertMany)(K_NAME* pSelf, const K_KEY_T* pKeys, const K_VALUE_T* pVals, ssize_t n)
+{
+    K_METHOD(ManyArgs) args = {.pKeys = pKeys, .pVals = pVals, .n = n};
+    return K_METHOD(Update)(pSelf, K_METHOD(InsertManyPfn), &args);
+}
+
+K_DECL_MOD bool
+K_METHOD(Insert)(K_NAME* pSelf, const K_KEY_T* pKey, const K_VALUE_T* pVal)
+{
+    return K_METHOD(InsertMany)(pSelf, pKey, pVal, 1);
+}
+
+static inline bool
+K_METHOD(RemovePfn)(K_MAP* pCopy, k_IAllocator* pAlloc, void* pUser)
+{
+    return K_MAP_METHOD(Remove)(pCopy, pUser).eStatus == K_MAP_RESULT_STATUS_REMOVED;
+}
+
+K_DECL_MOD bool
+K_METHOD(Remove)(K_NAME* pSelf, const K_KEY_T* pKey)
+{
+    /* Current table can't be retired while the writer mutex is held. */
+    k_MutexLock(&pSelf->mtxWrite);
+    const bool bFound = K_MAP_METHOD(Search)(k_AtomicPtrLoadAcquire(&pSelf->atomPMap), pKey).eStatus == K_MAP_RESULT_STATUS_FOUND;
+    k_MutexUnlock(&pSelf->mtxWrite);
+
+    if (!bFound) return false;
+    return K_METHOD(Update)(pSelf, K_METHOD(RemovePfn), (void*)pKey);
+}
+
+#endif /* K_GEN_CODE */
+
+#undef K_METHOD
+#undef K_MAP_METHOD
+#undef K_UPDATE_PFN
+
+#undef K_NAME
+#undef K_MAP
+#undef K_KEY_T
+#undef K_VALUE_T
+#undef K_FN_HASH
+#undef K_DECL_MOD
+#undef K_GEN_DECLS
+#undef K_GEN_CODE
@@ -0,0 +1,197 @@
+#include "IAllocator.h"
+
+#ifndef K_NAME
+    #error "K_NAME is not defined"
+#endif
+
+#ifndef K_TYPE
+    #error "K_TYPE is not defined"
+#endif
+
+#ifndef K_SEGVEC_FIRST_CAP
+    #define K_SEGVEC_FIRST_CAP 16 /* Power of two. */
+#endif
+
+#ifndef K_SEGVEC_MAX_SEGS
+    #define K_SEGVEC_MAX_SEGS 48 /* Segments double, so that's 2^48 * K_SEGVEC_FIRST_CAP elements. */
+#endif
+
+#ifndef K_DECL_MOD
+    #define K_DECL_MOD static inline
+#endif
+
+#if !defined K_GEN_DECLS && !defined K_GEN_CODE
+    #define K_GEN_DECLS
+    #define K_GEN_CODE
+#endif
+
+/* Segmented vector: segment i holds K_SEGVEC_FIRST_CAP << i elements and is never moved or resized once allocated.
+ * Element pointers stay valid until Destroy() and growth never copies, it only allocates the next segment.
+ * Index i lives in segment msb(i + FIRST) - log2(FIRST), so lookups are a clz and a subtraction.
+ * Pop() keeps segments around for the next pushes. */
+
+#define K_METHOD(M) K_GLUE(K_NAME, M)
+#define K_FIRST_SHIFT (63 - k_clz64(K_SEGVEC_FIRST_CAP))
+
+#ifdef K_GEN_DECLS
+
+typedef struct K_NAME
+{
+    K_TYPE* apSegs[K_SEGVEC_MAX_SEGS];
+    ssize_t size;
+    ssize_t cap; /* Sum of allocated segment sizes. */
+    int nSegs;
+} K_NAME;
+
+K_DECL_MOD bool K_METHOD(Init)(K_NAME* s, k_IAllocator* pAlloc, ssize_t cap);
+K_DECL_MOD void K_METHOD(Destroy)(K_NAME* s, k_IAllocator* pAlloc);
+K_DECL_MOD bool K_METHOD(Reserve)(K_NAME* s, k_IAllocator* pAlloc, ssize_t cap); /* Allocates segments until s->cap >= cap. */
+K_DECL_MOD ssize_t K_METHOD(Push)(K_NAME* s, k_IAllocator* pAlloc, const K_TYPE* pVal);
+K_DECL_MOD ssize_t K_METHOD(PushMany)(K_NAME* s, k_IAllocator* pAlloc, const K_TYPE* p, ssize_t size);
+K_DECL_MOD K_TYPE* K_METHOD(Pop)(K_NAME* s);
+K_DECL_MOD K_TYPE K_METHOD(Get)(K_NAME* s, ssize_t i);
+K_DECL_MOD K_TYPE* K_METHOD(GetP)(K_NAME* s, ssize_t i);
+K_DECL_MOD void K_METHOD(Set)(K_NAME* s, ssize_t i, const K_TYPE* p);
+K_DECL_MOD ssize_t K_METHOD(SegCap)(int segI);
+K_DECL_MOD K_TYPE* K_METHOD(Segment)(K_NAME* s, int segI, ssize_t* pSizeOut); /* For chunk at a time loops, *pSizeOut gets the used part. */
+
+#endif /* K_GEN_DECLS */
+
+#ifdef K_GEN_CODE
+
+K_DECL_MOD bool
+K_METHOD(Init)(K_NAME* s, k_IAllocator* pAlloc, ssize_t cap)
+{
+    assert(k_isPowerOf2(K_SEGVEC_FIRST_CAP));
+
+    *s = (K_NAME){0};
+    return K_METHOD(Reserve)(s, pAlloc, cap);
+}
+
+K_DECL_MOD void
+K_METHOD(Destroy)(K_NAME* s, k_IAllocator* pAlloc)
+{
+    for (int i = 0; i < s->nSegs; ++i)
+        k_IAllocatorFree(pAlloc, s->apSegs[i]);
+
+    *s = (K_NAME){0};
+}
+
+K_DECL_MOD ssize_t
+K_METHOD(SegCap)(int segI)
+{
+    return (ssize_t)K_SEGVEC_FIRST_CAP << segI;
+}
+
+K_DECL_MOD bool
+K_METHOD(Reserve)(K_NAME* s, k_IAllocator* pAlloc, ssize_t cap)
+{
+    while (s->cap < cap)
+    {
+        if (s->nSegs >= K_SEGVEC_MAX_SEGS) return false;
+
+        const ssize_t segCap = K_METHOD(SegCap)(s->nSegs);
+        K_TYPE* pNew = K_IMALLOC_T(pAlloc, K_TYPE, segCap);
+        if (!pNew) return false;
+
+        s->apSegs[s->nSegs++] = pNew;
+        s->cap += segCap;
+    }
+
+    return true;
+}
+
+K_DECL_MOD K_TYPE*
+K_METHOD(GetP)(K_NAME* s, ssize_t i)
+{
+    assert(i >= 0 && i < s->size);
+
+    const uint64_t j = (uint64_t)i + K_SEGVEC_FIRST_CAP;
+    const int msb = 63 - k_clz64(j);
+    return s->apSegs[msb - K_FIRST_SHIFT] + (j - ((uint64_t)1 << msb));
+}
+
+K_DECL_MOD K_TYPE
+K_METHOD(Get)(K_NAME* s, ssize_t i)
+{
+    return *K_METHOD(GetP)(s, i);
+}
+
+K_DECL_MOD void
+K_METHOD(Set)(K_NAME* s, ssize_t i, const K_TYPE* p)
+{
+    *K_METHOD(GetP)(s, i) = *(K_TYPE*)p;
+}
+
+K_DECL_MOD ssize_t
+K_METHOD(Push)(K_NAME* s, k_IAllocator* pAlloc, const K_TYPE* pVal)
+{
+    if (s->size >= s->cap)
+    {
+        if (!K_METHOD(Reserve)(s, pAlloc, s->size + 1))
+            return K_NPOS;
+    }
+
+    ++s->size;
+    *K_METHOD(GetP)(s, s->size - 1) = *(K_TYPE*)pVal;
+    return s->size - 1;
+}
+
+K_DECL_MOD ssize_t
+K_METHOD(PushMany)(K_NAME* s, k_IAllocator* pAlloc, const K_TYPE* p, ssize_t size)
+{
+    if (size <= 0) return s->size;
+    if (!K_METHOD(Reserve)(s, pAlloc, s->size + size))
+        return K_NPOS;
+
+    const ssize_t first = s->size;
+    s->size += size;
+
+    /* One memcpy per segment touched. */
+    ssize_t done = 0;
+    while (done < size)
+    {
+        K_TYPE* pDst = K_METHOD(GetP)(s, first + done);
+        const uint64_t j = (uint64_t)(first + done) + K_SEGVEC_FIRST_CAP;
+        const ssize_t segLeft = (ssize_t)(((uint64_t)1 << (63 - k_clz64(j) + 1)) - j);
+        const ssize_t n = K_MIN(segLeft, size - done);
+
+        memcpy(pDst, p + done, sizeof(*p) * n);
+        done += n;
+    }
+
+    return first;
+}
+
+K_DECL_MOD K_TYPE*
+K_METHOD(Pop)(K_NAME* s)
+{
+    assert(s->size > 0);
+    K_TYPE* p = K_METHOD(GetP)(s, s->size - 1);
+    --s->size;
+    return p;
+}
+
+K_DECL_MOD K_TYPE*
+K_METHOD(Segment)(K_NAME* s, int segI, ssize_t* pSizeOut)
+{
+    assert(segI >= 0 && segI < s->nSegs);
+
+    const ssize_t start = K_METHOD(SegCap)(segI) - K_SEGVEC_FIRST_CAP;
+    *pSizeOut = K_MAX(0, K_MIN(K_METHOD(SegCap)(segI), s->size - start));
+    return s->apSegs[segI];
+}
+
+#endif /* K_GEN_CODE */
+
+#undef K_METHOD
+#undef K_FIRST_SHIFT
+
+#undef K_NAME
+#undef K_TYPE
+#undef K_SEGVEC_FIRST_CAP
+#undef K_SEGVEC_MAX_SEGS
+#undef K_DECL_MOD
+
+#undef K_GEN_DECLS
+#undef K_GEN_CODE
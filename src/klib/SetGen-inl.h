@@ -0,0 +1,22 @@
+/* Hash set: MapGen-inl.h with K_MAP_NO_VALUE, same probing modes (K_MAP_SWISS, K_MAP_INCREMENTAL, K_MAP_STORE_HASH),
+ * buckets hold only the key. Insert(pSelf, pAlloc, pKey) takes no value.
+ * Adds UnionWith/Intersect/Difference. */
+
+#ifndef K_NAME
+    #error "K_NAME is not defined"
+#endif
+
+#ifndef K_KEY_T
+    #error "K_KEY_T is not defined"
+#endif
+
+#ifndef K_FN_HASH
+    #error "K_FN_HASH is not defined"
+#endif
+
+#ifndef K_FN_KEY_CMP
+    #error "K_FN_KEY_CMP is not defined"
+#endif
+
+#define K_MAP_NO_VALUE
+#include "MapGen-inl.h"
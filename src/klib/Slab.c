@@ -0,0 +1,150 @@
+#include "Slab.h"
+
+#include <assert.h>
+
+static void*
+newBlock(k_Slab* pSelf, ssize_t classI)
+{
+    K_TYPEOF(pSelf->priv)* s = &pSelf->priv;
+    const ssize_t classSize = k_SlabClassSize(classI);
+
+    if (!s->aPBump[classI] || s->aPBumpEnd[classI] - s->aPBump[classI] < classSize)
+    {
+        /* The arena adds its redzone after the block, leave room for it so chunks stay K_SLAB_CHUNK_SIZE apart
+         * and ownedClassI() can divide. */
+        const ssize_t chunkUsable = K_SLAB_CHUNK_SIZE - K_ARENA_REDZONE_SIZE;
+        uint8_t* pChunk = k_ArenaMalloc(&s->arena, chunkUsable);
+        if (!pChunk) return NULL;
+
+        const ssize_t off = pChunk - (uint8_t*)s->arena.priv.pData;
+        assert(off % K_SLAB_CHUNK_SIZE == 0);
+        s->pChunkClasses[off / K_SLAB_CHUNK_SIZE] = (uint8_t)classI;
+        s->aPBump[classI] = pChunk;
+        s->aPBumpEnd[classI] = pChunk + chunkUsable;
+    }
+
+    void* pRet = s->aPBump[classI];
+    s->aPBump[classI] += classSize;
+    return pRet;
+}
+
+static ssize_t
+ownedClassI(k_Slab* s, const void* p)
+{
+    return s->priv.pChunkClasses[((const uint8_t*)p - (uint8_t*)s->priv.arena.priv.pData) / K_SLAB_CHUNK_SIZE];
+}
+
+bool
+k_SlabInit(k_Slab* s, k_IAllocator* pBackingAlloc, ssize_t reserveSize)
+{
+    static const k_IAllocatorVTable s_vTable = {
+        .malloc = k_SlabMalloc,
+        .zalloc = k_SlabZalloc,
+        .realloc = k_SlabRealloc,
+        .free = k_SlabFree,
+    };
+
+    assert(reserveSize > 0);
+    assert(pBackingAlloc);
+
+    const ssize_t realReserve = K_ALIGN_UP_PO2(reserveSize, K_SLAB_CHUNK_SIZE);
+    if (!k_ArenaInit(&s->priv.arena, realReserve, 0)) return false;
+
+    const ssize_t nChunks = s->priv.arena.priv.reserved / K_SLAB_CHUNK_SIZE;
+    s->priv.pChunkClasses = k_IAllocatorZalloc(pBackingAlloc, nChunks);
+    if (!s->priv.pChunkClasses)
+    {
+        k_ArenaDestroy(&s->priv.arena);
+        return false;
+    }
+
+    s->base.pVTable = &s_vTable;
+    s->priv.pBackingAlloc = pBackingAlloc;
+    for (ssize_t i = 0; i < K_SLAB_N_CLASSES; ++i)
+    {
+        s->priv.aLFree[i] = NULL;
+        s->priv.aPBump[i] = NULL;
+        s->priv.aPBumpEnd[i] = NULL;
+    }
+
+    return true;
+}
+
+void
+k_SlabDestroy(k_Slab* s)
+{
+    k_IAllocatorFree(s->priv.pBackingAlloc, s->priv.pChunkClasses);
+    k_ArenaDestroy(&s->priv.arena);
+    *s = (k_Slab){0};
+}
+
+void*
+k_SlabMalloc(void* pSelf, ssize_t nBytes)
+{
+    k_Slab* s = (k_Slab*)pSelf;
+
+    if (nBytes > K_SLAB_MAX_CLASS_SIZE)
+        return k_IAllocatorMalloc(s->priv.pBackingAlloc, nBytes);
+
+    const ssize_t classI = k_SlabClassI(nBytes);
+    k_SlabFreeNode* pNode = s->priv.aLFree[classI];
+    if (pNode)
+    {
+        K_ASAN_UNPOISON(pNode, k_SlabClassSize(classI));
+        s->priv.aLFree[classI] = pNode->pNext;
+        return pNode;
+    }
+
+    return newBlock(s, classI);
+}
+
+void*
+k_SlabZalloc(void* s, ssize_t nBytes)
+{
+    void* pMem = k_SlabMalloc(s, nBytes);
+    if (pMem) memset(pMem, 0, nBytes);
+    return pMem;
+}
+
+void*
+k_SlabRealloc(void* pSelf, void* p, ssize_t oldNBytes, ssize_t newNBytes)
+{
+    k_Slab* s = (k_Slab*)pSelf;
+    if (!p) return k_SlabMalloc(s, newNBytes);
+
+    if (k_SlabOwns(s, p))
+    {
+        /* Still fits the same class. */
+        if (newNBytes <= k_SlabClassSize(ownedClassI(s, p))) return p;
+    }
+    else if (newNBytes > K_SLAB_MAX_CLASS_SIZE)
+    {
+        return k_IAllocatorRealloc(s->priv.pBackingAlloc, p, oldNBytes, newNBytes);
+    }
+
+    void* pNew = k_SlabMalloc(s, newNBytes);
+    if (!pNew) return NULL;
+
+    memcpy(pNew, p, K_MIN(oldNBytes, newNBytes));
+    k_SlabFree(s, p);
+    return pNew;
+}
+
+void
+k_SlabFree(void* pSelf, void* p)
+{
+    k_Slab* s = (k_Slab*)pSelf;
+    if (!p) return;
+
+    if (!k_SlabOwns(s, p))
+    {
+        k_IAllocatorFree(s->priv.pBackingAlloc, p);
+        return;
+    }
+
+    const ssize_t classI = ownedClassI(s, p);
+    k_SlabFreeNode* pNode = p;
+    pNode->pNext = s->priv.aLFree[classI];
+    s->priv.aLFree[classI] = pNode;
+    K_ASAN_POISON(pNode, k_SlabClassSize(classI));
+}
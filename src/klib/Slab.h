@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Arena.h"
+
+#define K_SLAB_MIN_CLASS_SIZE 16
+#define K_SLAB_N_CLASSES 9 /* 16, 32, ..., 4096. */
+#define K_SLAB_MAX_CLASS_SIZE (K_SLAB_MIN_CLASS_SIZE << (K_SLAB_N_CLASSES - 1))
+#define K_SLAB_CHUNK_SIZE (K_SIZE_1K * 64) /* Every chunk serves only one size class. */
+
+typedef struct k_SlabFreeNode
+{
+    struct k_SlabFreeNode* pNext;
+} k_SlabFreeNode;
+
+/* Power of two size class allocator. Blocks up to K_SLAB_MAX_CLASS_SIZE are carved from chunks of reserved memory,
+ * bigger blocks go to the backing allocator. */
+typedef struct k_Slab
+{
+    k_IAllocator base;
+
+    struct
+    {
+        k_Arena arena; /* Chunks are bumped from here. */
+        k_IAllocator* pBackingAlloc; /* Big blocks and chunk class table. */
+        uint8_t* pChunkClasses; /* Size class index of every chunk. */
+        k_SlabFreeNode* aLFree[K_SLAB_N_CLASSES];
+        uint8_t* aPBump[K_SLAB_N_CLASSES]; /* Unused tail of the last chunk of each class. */
+        uint8_t* aPBumpEnd[K_SLAB_N_CLASSES];
+    } priv;
+} k_Slab;
+
+bool k_SlabInit(k_Slab* s, k_IAllocator* pBackingAlloc, ssize_t reserveSize);
+void k_SlabDestroy(k_Slab* s); /* NOTE: Big blocks still have to be freed by the user. */
+K_NO_DISCARD void* k_SlabMalloc(void* s, ssize_t nBytes);
+K_NO_DISCARD void* k_SlabZalloc(void* s, ssize_t nBytes);
+K_NO_DISCARD void* k_SlabRealloc(void* s, void* p, ssize_t oldNBytes, ssize_t newNBytes);
+void k_SlabFree(void* s, void* p);
+static inline ssize_t k_SlabClassI(ssize_t nBytes);
+static inline ssize_t k_SlabClassSize(ssize_t classI);
+static inline bool k_SlabOwns(k_Slab* s, const void* p);
+
+static inline ssize_t
+k_SlabClassI(ssize_t nBytes)
+{
+    if (nBytes <= K_SLAB_MIN_CLASS_SIZE) return 0;
+    return (64 - k_clz64((uint64_t)nBytes - 1)) - 4; /* log2(K_SLAB_MIN_CLASS_SIZE) */
+}
+
+static inline ssize_t
+k_SlabClassSize(ssize_t classI)
+{
+    return (ssize_t)K_SLAB_MIN_CLASS_SIZE << classI;
+}
+
+static inline bool
+k_SlabOwns(k_Slab* s, const void* p)
+{
+    const uint8_t* pData = s->priv.arena.priv.pData;
+    return (const uint8_t*)p >= pData && (const uint8_t*)p < pData + s->priv.arena.priv.reserved;
+}
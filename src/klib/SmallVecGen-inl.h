@@ -0,0 +1,242 @@
+#include "IAllocator.h"
+
+#ifndef K_NAME
+    #error "K_NAME is not defined"
+#endif
+
+#ifndef K_TYPE
+    #error "K_TYPE is not defined"
+#endif
+
+#ifndef K_INLINE_CAP
+    #define K_INLINE_CAP 16
+#endif
+
+#ifndef K_DECL_MOD
+    #define K_DECL_MOD static inline
+#endif
+
+#if !defined K_GEN_DECLS && !defined K_GEN_CODE
+    #define K_GEN_DECLS
+    #define K_GEN_CODE
+#endif
+
+/* VecGen-inl.h with the first K_INLINE_CAP elements stored inside the struct, pAlloc is only touched past that.
+ * pData is NULL while the elements are inline, so the struct can be copied by value and {0} is a valid empty vector,
+ * use Data() for the pointer. Shrinking to K_INLINE_CAP or less moves the elements back in and frees the heap array. */
+
+#define K_METHOD(M) K_GLUE(K_NAME, M)
+
+#ifdef K_GEN_DECLS
+
+typedef struct K_NAME
+{
+    K_TYPE* pData; /* NULL while inline. */
+    ssize_t size;
+    ssize_t cap; /* Heap capacity, K_INLINE_CAP is used while inline. */
+    K_TYPE aInline[K_INLINE_CAP];
+} K_NAME;
+
+K_DECL_MOD bool K_METHOD(Init)(K_NAME* s, k_IAllocator* pAlloc, ssize_t cap);
+K_DECL_MOD void K_METHOD(Destroy)(K_NAME* s, k_IAllocator* pAlloc);
+K_DECL_MOD bool K_METHOD(IsInline)(const K_NAME* s);
+K_DECL_MOD K_TYPE* K_METHOD(Data)(K_NAME* s);
+K_DECL_MOD ssize_t K_METHOD(Cap)(const K_NAME* s);
+K_DECL_MOD ssize_t K_METHOD(Push)(K_NAME* s, k_IAllocator* pAlloc, const K_TYPE* pVal);
+K_DECL_MOD ssize_t K_METHOD(PushMany)(K_NAME* s, k_IAllocator* pAlloc, const K_TYPE* p, ssize_t size);
+K_DECL_MOD K_TYPE* K_METHOD(Pop)(K_NAME* s);
+K_DECL_MOD bool K_METHOD(PopShrink)(K_NAME* s, k_IAllocator* pAlloc);
+K_DECL_MOD bool K_METHOD(Grow)(K_NAME* s, k_IAllocator* pAlloc, ssize_t newCap);
+K_DECL_MOD bool K_METHOD(Shrink)(K_NAME* s, k_IAllocator* pAlloc, ssize_t newCap);
+K_DECL_MOD bool K_METHOD(SetCap)(K_NAME* s, k_IAllocator* pAlloc, ssize_t newCap);
+K_DECL_MOD K_TYPE K_METHOD(Get)(K_NAME* s, ssize_t i);
+K_DECL_MOD K_TYPE* K_METHOD(GetP)(K_NAME* s, ssize_t i);
+K_DECL_MOD void K_METHOD(Set)(K_NAME* s, ssize_t i, const K_TYPE* p);
+
+#endif /* K_GEN_DECLS */
+
+#ifdef K_GEN_CODE
+
+K_DECL_MOD bool
+K_METHOD(Init)(K_NAME* s, k_IAllocator* pAlloc, ssize_t cap)
+{
+    s->pData = NULL;
+    s->size = 0;
+    s->cap = 0;
+
+    if (cap > K_INLINE_CAP) return K_METHOD(Grow)(s, pAlloc, cap);
+    return true;
+}
+
+K_DECL_MOD void
+K_METHOD(Destroy)(K_NAME* s, k_IAllocator* pAlloc)
+{
+    if (s->pData) k_IAllocatorFree(pAlloc, s->pData);
+    s->pData = NULL;
+    s->size = 0;
+    s->cap = 0;
+}
+
+K_DECL_MOD bool
+K_METHOD(IsInline)(const K_NAME* s)
+{
+    return s->pData == NULL;
+}
+
+K_DECL_MOD K_TYPE*
+K_METHOD(Data)(K_NAME* s)
+{
+    return s->pData ? s->pData : s->aInline;
+}
+
+K_DECL_MOD ssize_t
+K_METHOD(Cap)(const K_NAME* s)
+{
+    return s->pData ? s->cap : K_INLINE_CAP;
+}
+
+K_DECL_MOD ssize_t
+K_METHOD(Push)(K_NAME* s, k_IAllocator* pAlloc, const K_TYPE* pVal)
+{
+    const ssize_t cap = K_METHOD(Cap)(s);
+    if (s->size >= cap)
+    {
+        if (!K_METHOD(Grow)(s, pAlloc, K_MAX(8, cap * 2)))
+            return K_NPOS;
+    }
+
+    K_METHOD(Data)(s)[s->size++] = *(K_TYPE*)pVal;
+    return s->size - 1;
+}
+
+K_DECL_MOD ssize_t
+K_METHOD(PushMany)(K_NAME* s, k_IAllocator* pAlloc, const K_TYPE* p, ssize_t size)
+{
+    if (size <= 0) return s->size;
+    const ssize_t cap = K_METHOD(Cap)(s);
+    if (s->size + size > cap)
+    {
+        ssize_t newCap = cap * 2;
+        if (s->size + size > newCap) newCap = s->size + size;
+        if (!K_METHOD(Grow)(s, pAlloc, newCap))
+            return K_NPOS;
+    }
+
+    memcpy(K_METHOD(Data)(s) + s->size, p, sizeof(*p) * size);
+    s->size += size;
+    return s->size - size;
+}
+
+K_DECL_MOD K_TYPE*
+K_METHOD(Pop)(K_NAME* s)
+{
+    assert(s->size > 0);
+    return K_METHOD(Data)(s) + --s->size;
+}
+
+K_DECL_MOD bool
+K_METHOD(PopShrink)(K_NAME* s, k_IAllocator* pAlloc)
+{
+    assert(s->size > 0);
+    if (s->pData && s->size <= s->cap >> 2)
+    {
+        if (!K_METHOD(Shrink)(s, pAlloc, s->cap >> 1))
+            return false;
+    }
+    --s->size;
+    return true;
+}
+
+K_DECL_MOD bool
+K_METHOD(Grow)(K_NAME* s, k_IAllocator* pAlloc, ssize_t newCap)
+{
+    if (newCap <= K_METHOD(Cap)(s)) return true;
+
+    K_TYPE* pNew;
+    if (s->pData)
+    {
+        pNew = K_IREALLOC_T(pAlloc, K_TYPE, s->pData, s->size, newCap);
+        if (!pNew) return false;
+    }
+    else
+    {
+        /* Spill. */
+        pNew = K_IMALLOC_T(pAlloc, K_TYPE, newCap);
+        if (!pNew) return false;
+        memcpy(pNew, s->aInline, sizeof(K_TYPE) * s->size);
+    }
+
+    s->pData = pNew;
+    s->cap = newCap;
+
+    return true;
+}
+
+K_DECL_MOD bool
+K_METHOD(Shrink)(K_NAME* s, k_IAllocator* pAlloc, ssize_t newCap)
+{
+    if (!s->pData)
+    {
+        if (s->size > newCap) s->size = K_MAX(0, newCap);
+        return true;
+    }
+
+    if (newCap <= K_INLINE_CAP)
+    {
+        if (s->size > newCap) s->size = K_MAX(0, newCap);
+        memcpy(s->aInline, s->pData, sizeof(K_TYPE) * s->size);
+        k_IAllocatorFree(pAlloc, s->pData);
+        s->pData = NULL;
+        s->cap = 0;
+        return true;
+    }
+
+    K_TYPE* pNew = K_IREALLOC_T(pAlloc, K_TYPE, s->pData, newCap, newCap);
+    if (!pNew) return false;
+
+    s->pData = pNew;
+    s->cap = newCap;
+    if (s->size > s->cap) s->size = s->cap;
+
+    return true;
+}
+
+K_DECL_MOD bool
+K_METHOD(SetCap)(K_NAME* s, k_IAllocator* pAlloc, ssize_t newCap)
+{
+    if (newCap > K_METHOD(Cap)(s)) return K_METHOD(Grow)(s, pAlloc, newCap);
+    return K_METHOD(Shrink)(s, pAlloc, newCap);
+}
+
+K_DECL_MOD K_TYPE
+K_METHOD(Get)(K_NAME* s, ssize_t i)
+{
+    assert(i >= 0 && i < s->size);
+    return K_METHOD(Data)(s)[i];
+}
+
+K_DECL_MOD K_TYPE*
+K_METHOD(GetP)(K_NAME* s, ssize_t i)
+{
+    assert(i >= 0 && i < s->size);
+    return K_METHOD(Data)(s) + i;
+}
+
+K_DECL_MOD void
+K_METHOD(Set)(K_NAME* s, ssize_t i, const K_TYPE* p)
+{
+    assert(i >= 0 && i < s->size);
+    K_METHOD(Data)(s)[i] = *(K_TYPE*)p;
+}
+
+#endif /* K_GEN_CODE */
+
+#undef K_METHOD
+
+#undef K_NAME
+#undef K_TYPE
+#undef K_INLINE_CAP
+#undef K_DECL_MOD
+
+#undef K_GEN_DECLS
+#undef K_GEN_CODE
@@ -42,7 +42,13 @@ static inline void k_StringViewSet(const k_StringView* s, ssize_t i, char c);
 static inline uint64_t
 k_StringViewHash(const k_StringView* pSv)
 {
-    return k_hash_crc32((uint8_t*)pSv->pData, pSv->size, 0);
+    return k_hash_fast((uint8_t*)pSv->pData, pSv->size, 0);
+}
+
+static inline uint64_t
+k_StringViewHashSeeded(const k_StringView* pSv, uint64_t seed)
+{
+    return k_hash_fast((uint8_t*)pSv->pData, pSv->size, seed);
 }
 
 static inline bool
@@ -0,0 +1,310 @@
+#include "ThreadCache.h"
+
+#include <assert.h>
+
+#define HEADER_SIZE 16 /* alignof(max_align_t) on the usual 64 bit targets. */
+#define CLASS_BIG ((ssize_t)K_NPOS)
+
+static k_atomic_Int s_atomSlotCounter;
+static K_THREAD_LOCAL int stl_slotI = -1;
+
+static ssize_t
+classI(ssize_t nBytes)
+{
+    if (nBytes <= K_THREAD_CACHE_MIN_CLASS_SIZE) return 0;
+    return (64 - k_clz64((uint64_t)nBytes - 1)) - 4; /* log2(K_THREAD_CACHE_MIN_CLASS_SIZE) */
+}
+
+static ssize_t
+classSize(ssize_t classI)
+{
+    return (ssize_t)K_THREAD_CACHE_MIN_CLASS_SIZE << classI;
+}
+
+static ssize_t*
+header(void* p)
+{
+    return (ssize_t*)((uint8_t*)p - HEADER_SIZE);
+}
+
+static void*
+backingMalloc(k_ThreadCache* s, ssize_t nBytes, ssize_t classI)
+{
+    ssize_t* pHeader = k_IAllocatorMalloc(s->priv.pBackingAlloc, HEADER_SIZE + nBytes);
+    if (!pHeader) return NULL;
+    *pHeader = classI;
+    return (uint8_t*)pHeader + HEADER_SIZE;
+}
+
+static k_ThreadCacheSlot*
+tryLockSlot(k_ThreadCache* s)
+{
+    if (stl_slotI == -1)
+        stl_slotI = k_AtomicIntAddRelaxed(&s_atomSlotCounter, 1) & (K_THREAD_CACHE_N_SLOTS - 1);
+
+    k_ThreadCacheSlot* pSlot = &s->priv.pSlots[stl_slotI];
+    if (k_AtomicIntExchangeAcquire(&pSlot->atomBLocked, 1)) return NULL;
+    return pSlot;
+}
+
+static void
+unlockSlot(k_ThreadCacheSlot* pSlot)
+{
+    k_AtomicIntStoreRelease(&pSlot->atomBLocked, 0);
+}
+
+/* Under the mutex. */
+static void*
+depotPop(k_ThreadCache* s, ssize_t classI)
+{
+    void* p = s->priv.aLDepot[classI];
+    if (!p) return NULL;
+
+    s->priv.aLDepot[classI] = *(void**)p;
+    --s->priv.aDepotSizes[classI];
+    return p;
+}
+
+/* Under the mutex. A full depot frees a batch, so blocks freed on other threads don't pile up forever. */
+static void
+depotPush(k_ThreadCache* s, void* p, ssize_t classI)
+{
+    *(void**)p = s->priv.aLDepot[classI];
+    s->priv.aLDepot[classI] = p;
+
+    if (++s->priv.aDepotSizes[classI] > K_THREAD_CACHE_DEPOT_CAP)
+    {
+        for (ssize_t i = 0; i < K_THREAD_CACHE_BATCH; ++i)
+            k_IAllocatorFree(s->priv.pBackingAlloc, header(depotPop(s, classI)));
+        s->priv.nReleased += K_THREAD_CACHE_BATCH;
+    }
+}
+
+/* Fill half of the magazine from the depot, then from the backing allocator. Takes the mutex. */
+static void
+refill(k_ThreadCache* s, k_ThreadCacheMagazine* pMag, ssize_t classI)
+{
+    k_MutexLock(&s->priv.mtx);
+    {
+        ++s->priv.nRefills;
+
+        while (pMag->size < K_THREAD_CACHE_BATCH && s->priv.aLDepot[classI])
+            pMag->apBlocks[pMag->size++] = depotPop(s, classI);
+
+        while (pMag->size < K_THREAD_CACHE_BATCH)
+        {
+            void* p = backingMalloc(s, classSize(classI), classI);
+            if (!p) break;
+            pMag->apBlocks[pMag->size++] = p;
+        }
+    }
+    k_MutexUnlock(&s->priv.mtx);
+}
+
+/* Move the older half of the magazine to the depot. Takes the mutex. */
+static void
+flush(k_ThreadCache* s, k_ThreadCacheMagazine* pMag, ssize_t classI)
+{
+    k_MutexLock(&s->priv.mtx);
+    {
+        ++s->priv.nFlushes;
+
+        for (ssize_t i = 0; i < K_THREAD_CACHE_BATCH; ++i)
+            depotPush(s, pMag->apBlocks[i], classI);
+    }
+    k_MutexUnlock(&s->priv.mtx);
+
+    memmove(pMag->apBlocks, pMag->apBlocks + K_THREAD_CACHE_BATCH, sizeof(void*) * (pMag->size - K_THREAD_CACHE_BATCH));
+    pMag->size -= K_THREAD_CACHE_BATCH;
+}
+
+bool
+k_ThreadCacheInit(k_ThreadCache* s, k_IAllocator* pBackingAlloc)
+{
+    static const k_IAllocatorVTable s_vTable = {
+        .malloc = k_ThreadCacheMalloc,
+        .zalloc = k_ThreadCacheZalloc,
+        .realloc = k_ThreadCacheRealloc,
+        .free = k_ThreadCacheFree,
+    };
+
+    assert(pBackingAlloc);
+
+    s->priv.pSlots = K_IZALLOC_T(pBackingAlloc, k_ThreadCacheSlot, K_THREAD_CACHE_N_SLOTS);
+    if (!s->priv.pSlots) return false;
+
+    if (!k_MutexInitPlain(&s->priv.mtx))
+    {
+        k_IAllocatorFree(pBackingAlloc, s->priv.pSlots);
+        return false;
+    }
+
+    s->base.pVTable = &s_vTable;
+    s->priv.pBackingAlloc = pBackingAlloc;
+    for (ssize_t i = 0; i < K_THREAD_CACHE_N_CLASSES; ++i)
+    {
+        s->priv.aLDepot[i] = NULL;
+        s->priv.aDepotSizes[i] = 0;
+    }
+    s->priv.nRefills = 0;
+    s->priv.nFlushes = 0;
+    s->priv.nReleased = 0;
+    s->priv.nBypassMisses = 0;
+
+    return true;
+}
+
+void
+k_ThreadCacheDestroy(k_ThreadCache* s)
+{
+    k_IAllocator* pBacking = s->priv.pBackingAlloc;
+
+    for (ssize_t slotI = 0; slotI < K_THREAD_CACHE_N_SLOTS; ++slotI)
+    {
+        k_ThreadCacheSlot* pSlot = &s->priv.pSlots[slotI];
+        for (ssize_t classI = 0; classI < K_THREAD_CACHE_N_CLASSES; ++classI)
+        {
+            k_ThreadCacheMagazine* pMag = &pSlot->aMagazines[classI];
+            for (ssize_t i = 0; i < pMag->size; ++i)
+                k_IAllocatorFree(pBacking, header(pMag->apBlocks[i]));
+        }
+    }
+
+    for (ssize_t classI = 0; classI < K_THREAD_CACHE_N_CLASSES; ++classI)
+    {
+        for (void* p = s->priv.aLDepot[classI]; p; )
+        {
+            void* pNext = *(void**)p;
+            k_IAllocatorFree(pBacking, header(p));
+            p = pNext;
+        }
+    }
+
+    k_IAllocatorFree(pBacking, s->priv.pSlots);
+    k_MutexDestroy(&s->priv.mtx);
+    *s = (k_ThreadCache){0};
+}
+
+void*
+k_ThreadCacheMalloc(void* pSelf, ssize_t nBytes)
+{
+    k_ThreadCache* s = (k_ThreadCache*)pSelf;
+    void* pRet = NULL;
+
+    if (nBytes > K_THREAD_CACHE_MAX_CLASS_SIZE)
+    {
+        k_MutexLock(&s->priv.mtx);
+        pRet = backingMalloc(s, nBytes, CLASS_BIG);
+        k_MutexUnlock(&s->priv.mtx);
+        return pRet;
+    }
+
+    const ssize_t cI = classI(nBytes);
+    k_ThreadCacheSlot* pSlot = tryLockSlot(s);
+    if (!pSlot)
+    {
+        /* Slot is taken by another thread, go straight to the depot/backing allocator. */
+        k_MutexLock(&s->priv.mtx);
+        ++s->priv.nBypassMisses;
+        pRet = depotPop(s, cI);
+        if (!pRet) pRet = backingMalloc(s, classSize(cI), cI);
+        k_MutexUnlock(&s->priv.mtx);
+        return pRet;
+    }
+
+    k_ThreadCacheMagazine* pMag = &pSlot->aMagazines[cI];
+    if (pMag->size > 0)
+    {
+        ++pSlot->nHits;
+    }
+    else
+    {
+        ++pSlot->nMisses;
+        refill(s, pMag, cI);
+    }
+
+    if (pMag->size > 0) pRet = pMag->apBlocks[--pMag->size];
+    unlockSlot(pSlot);
+
+    return pRet;
+}
+
+void*
+k_ThreadCacheZalloc(void* s, ssize_t nBytes)
+{
+    void* pMem = k_ThreadCacheMalloc(s, nBytes);
+    if (pMem) memset(pMem, 0, nBytes);
+    return pMem;
+}
+
+void*
+k_ThreadCacheRealloc(void* pSelf, void* p, ssize_t oldNBytes, ssize_t newNBytes)
+{
+    k_ThreadCache* s = (k_ThreadCache*)pSelf;
+    if (!p) return k_ThreadCacheMalloc(s, newNBytes);
+
+    const ssize_t cI = *header(p);
+    if (cI != CLASS_BIG && newNBytes <= classSize(cI)) return p;
+
+    void* pNew = k_ThreadCacheMalloc(s, newNBytes);
+    if (!pNew) return NULL;
+
+    memcpy(pNew, p, K_MIN(oldNBytes, newNBytes));
+    k_ThreadCacheFree(s, p);
+    return pNew;
+}
+
+void
+k_ThreadCacheFree(void* pSelf, void* p)
+{
+    k_ThreadCache* s = (k_ThreadCache*)pSelf;
+    if (!p) return;
+
+    const ssize_t cI = *header(p);
+    k_ThreadCacheSlot* pSlot = NULL;
+    if (cI == CLASS_BIG || !(pSlot = tryLockSlot(s)))
+    {
+        k_MutexLock(&s->priv.mtx);
+        if (cI == CLASS_BIG)
+        {
+            k_IAllocatorFree(s->priv.pBackingAlloc, header(p));
+        }
+        else
+        {
+            depotPush(s, p, cI);
+        }
+        k_MutexUnlock(&s->priv.mtx);
+        return;
+    }
+
+    k_ThreadCacheMagazine* pMag = &pSlot->aMagazines[cI];
+    if (pMag->size >= K_THREAD_CACHE_MAGAZINE_CAP) flush(s, pMag, cI);
+    pMag->apBlocks[pMag->size++] = p;
+    unlockSlot(pSlot);
+}
+
+k_ThreadCacheStats
+k_ThreadCacheGetStats(k_ThreadCache* s)
+{
+    k_ThreadCacheStats ret = {0};
+
+    for (ssize_t i = 0; i < K_THREAD_CACHE_N_SLOTS; ++i)
+    {
+        k_ThreadCacheSlot* pSlot = &s->priv.pSlots[i];
+        while (k_AtomicIntExchangeAcquire(&pSlot->atomBLocked, 1))
+            k_ThreadYield();
+
+        ret.nHits += pSlot->nHits;
+        ret.nMisses += pSlot->nMisses;
+        unlockSlot(pSlot);
+    }
+
+    k_MutexLock(&s->priv.mtx);
+    ret.nMisses += s->priv.nBypassMisses;
+    ret.nRefills = s->priv.nRefills;
+    ret.nFlushes = s->priv.nFlushes;
+    ret.nReleased = s->priv.nReleased;
+    k_MutexUnlock(&s->priv.mtx);
+
+    return ret;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "IAllocator.h"
+#include "Thread.h"
+#include "atomic.h"
+
+#define K_THREAD_CACHE_N_SLOTS 32 /* Threads are spread over slots by a thread local index. */
+#define K_THREAD_CACHE_MIN_CLASS_SIZE 16
+#define K_THREAD_CACHE_N_CLASSES 8 /* 16, 32, ..., 2048. */
+#define K_THREAD_CACHE_MAX_CLASS_SIZE (K_THREAD_CACHE_MIN_CLASS_SIZE << (K_THREAD_CACHE_N_CLASSES - 1))
+#define K_THREAD_CACHE_MAGAZINE_CAP 32
+#define K_THREAD_CACHE_BATCH (K_THREAD_CACHE_MAGAZINE_CAP / 2) /* Blocks moved per refill/flush. */
+#define K_THREAD_CACHE_DEPOT_CAP (K_THREAD_CACHE_MAGAZINE_CAP * 8) /* Per class, a batch goes back to the backing allocator past that. */
+
+typedef struct k_ThreadCacheMagazine
+{
+    void* apBlocks[K_THREAD_CACHE_MAGAZINE_CAP];
+    ssize_t size;
+} k_ThreadCacheMagazine;
+
+typedef struct k_ThreadCacheSlot
+{
+    k_atomic_Int atomBLocked; /* Uncontended unless more threads than slots. */
+    ssize_t nHits;
+    ssize_t nMisses;
+    k_ThreadCacheMagazine aMagazines[K_THREAD_CACHE_N_CLASSES];
+    uint8_t aPad[64]; /* Keep neighbouring slots on different cache lines. */
+} k_ThreadCacheSlot;
+
+typedef struct k_ThreadCacheStats
+{
+    ssize_t nHits; /* Served from a magazine. */
+    ssize_t nMisses; /* Had to go to the shared depot or the backing allocator. */
+    ssize_t nRefills;
+    ssize_t nFlushes;
+    ssize_t nReleased; /* Blocks the full depot gave back to the backing allocator. */
+} k_ThreadCacheStats;
+
+/* Thread safe tcache-style front end for any k_IAllocator. Small blocks are cached in per-thread magazines,
+ * the backing allocator is only touched in batches under a mutex.
+ * Every block gets a 16 byte header with its size class, so blocks keep the backing allocator's alignment. */
+typedef struct k_ThreadCache
+{
+    k_IAllocator base;
+
+    struct
+    {
+        k_IAllocator* pBackingAlloc;
+        k_Mutex mtx; /* Guards pBackingAlloc, depot and refill/flush counters. */
+        k_ThreadCacheSlot* pSlots;
+        void* aLDepot[K_THREAD_CACHE_N_CLASSES]; /* Intrusive lists of blocks flushed from magazines. */
+        ssize_t aDepotSizes[K_THREAD_CACHE_N_CLASSES];
+        ssize_t nRefills;
+        ssize_t nFlushes;
+        ssize_t nReleased;
+        ssize_t nBypassMisses; /* Allocations made while the thread's slot was taken. */
+    } priv;
+} k_ThreadCache;
+
+bool k_ThreadCacheInit(k_ThreadCache* s, k_IAllocator* pBackingAlloc);
+void k_ThreadCacheDestroy(k_ThreadCache* s); /* NOTE: All cached blocks go back to the backing allocator. */
+K_NO_DISCARD void* k_ThreadCacheMalloc(void* s, ssize_t nBytes);
+K_NO_DISCARD void* k_ThreadCacheZalloc(void* s, ssize_t nBytes);
+K_NO_DISCARD void* k_ThreadCacheRealloc(void* s, void* p, ssize_t oldNBytes, ssize_t newNBytes);
+void k_ThreadCacheFree(void* s, void* p);
+k_ThreadCacheStats k_ThreadCacheGetStats(k_ThreadCache* s);
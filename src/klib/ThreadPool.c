@@ -12,6 +12,8 @@
 
 static K_THREAD_LOCAL k_Arena stl_arena = {0};
 static K_THREAD_LOCAL int stl_threadI = 0;
+static K_THREAD_LOCAL ssize_t stl_epochSlotI = -1;
+static K_THREAD_LOCAL k_Epoch* stl_pEpoch = NULL; /* Epoch stl_epochSlotI belongs to. */
 
 typedef struct TaskHeader
 {
@@ -111,9 +113,19 @@ execTask(TaskBuffer* s)
         k_ArenaStateRestore(&s->arenaState);
 }
 
+/* Runs queued tasks on the waiting thread. With an epoch the tasks are protected here too: a worker of this pool
+ * waiting inside its own task is online already, any other thread gets a slot for as long as it steals. */
 static void
 stealTasks(k_ThreadPool* s)
 {
+    ssize_t slotI = -1;
+    if (s->pEpoch && stl_pEpoch != s->pEpoch)
+    {
+        slotI = k_EpochRegister(s->pEpoch);
+        if (slotI == -1) return; /* No free slot, leave the tasks to the workers. */
+        k_EpochOffline(s->pEpoch, slotI);
+    }
+
 tryAgain:
     k_MutexLock(&s->mtxRb);
     if (k_RingBufferSize(&s->rbTasks) > 0)
@@ -122,7 +134,10 @@ tryAgain:
 
         popTask(&tb, s);
         k_MutexUnlock(&s->mtxRb);
+
+        if (slotI != -1) k_EpochOnline(s->pEpoch, slotI);
         execTask(&tb);
+        if (slotI != -1) k_EpochOffline(s->pEpoch, slotI);
 
         goto tryAgain;
     }
@@ -130,6 +145,8 @@ tryAgain:
     {
         k_MutexUnlock(&s->mtxRb);
     }
+
+    if (slotI != -1) k_EpochUnregister(s->pEpoch, slotI);
 }
 
 void
@@ -171,8 +188,20 @@ loop(void* pUser)
     k_ThreadPool* s = pUser;
 
     assert(s->arenaReserve > 0);
-    if (!k_ArenaInit(&stl_arena, s->arenaReserve, K_SIZE_1K*4)) goto fail;
+    if (!k_ArenaInitWithOpts(&stl_arena, (k_ArenaInitOpts){
+        .reserveSize = s->arenaReserve,
+        .commitSize = K_SIZE_1K*4,
+        .ePages = s->eArenaPages,
+        .trimResets = s->arenaTrimResets,
+    })) goto fail;
     if (s->pfnLoopStart) s->pfnLoopStart(s->pLoopStartArg);
+    if (s->pEpoch)
+    {
+        stl_epochSlotI = k_EpochRegister(s->pEpoch);
+        if (stl_epochSlotI == -1) goto fail;
+        stl_pEpoch = s->pEpoch;
+        k_EpochOffline(s->pEpoch, stl_epochSlotI);
+    }
     stl_threadI = k_AtomicIntAddRelaxed(&s->atomIdCounter, 1);
 
     while (true)
@@ -195,7 +224,16 @@ loop(void* pUser)
         }
         k_MutexUnlock(&s->mtxRb);
 
+        if (s->pEpoch) k_EpochOnline(s->pEpoch, stl_epochSlotI);
         execTask(&tb);
+        if (s->pEpoch)
+        {
+            k_EpochOffline(s->pEpoch, stl_epochSlotI);
+            if (k_EpochPending(s->pEpoch) > 0) k_EpochCollect(s->pEpoch);
+        }
+        /* Zero high-water with nothing used means k_ArenaReset() in the task already trimmed (or nothing was allocated). */
+        if (s->arenaTrimResets > 0 && k_ArenaMemoryUsed(&stl_arena) == 0 && stl_arena.priv.highWater > 0)
+            k_ArenaTrim(&stl_arena);
         k_AtomicIntSubRelease(&s->atomNActiveTasks, 1);
 
         k_MutexLock(&s->mtxRb);
@@ -206,6 +244,11 @@ loop(void* pUser)
 
 done:
     if (s->pfnLoopEnd) s->pfnLoopEnd(s->pLoopEndArg);
+    if (s->pEpoch)
+    {
+        k_EpochUnregister(s->pEpoch, stl_epochSlotI);
+        stl_pEpoch = NULL;
+    }
     k_ArenaDestroy(&stl_arena);
     return 0;
 
@@ -221,7 +264,12 @@ start(k_ThreadPool* s)
     for (ssize_t i = 0; i < s->nThreads; ++i)
         if (!k_ThreadInit(&s->pThreads[i], loop, s)) goto fail;
 
-    if (!k_ArenaInit(&stl_arena, s->arenaReserve, K_SIZE_1K*4)) goto fail;
+    if (!k_ArenaInitWithOpts(&stl_arena, (k_ArenaInitOpts){
+        .reserveSize = s->arenaReserve,
+        .commitSize = K_SIZE_1K*4,
+        .ePages = s->eArenaPages,
+        .trimResets = s->arenaTrimResets,
+    })) goto fail;
 
     s->bStarted = true;
 
@@ -261,6 +309,9 @@ k_ThreadPoolInit(k_ThreadPool* s, k_ThreadPoolInitOpts args)
     s->atomIdCounter.volNum = 0;
     s->bStarted = false;
     s->arenaReserve = args.arenaReserve;
+    s->eArenaPages = args.eArenaPages;
+    s->arenaTrimResets = args.arenaTrimResets;
+    s->pEpoch = args.pEpochOrNull;
 
     if (!start(s)) goto fail;
     return true;
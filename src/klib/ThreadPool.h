@@ -4,6 +4,7 @@
 #include "Thread.h"
 #include "RingBuffer.h"
 #include "atomic.h"
+#include "Epoch.h"
 
 ssize_t k_nLogicalCores(void);
 ssize_t k_optimalThreadCount(void);
@@ -43,6 +44,9 @@ typedef struct k_ThreadPool
     bool bStarted;
     k_RingBuffer rbTasks;
     ssize_t arenaReserve;
+    K_ARENA_PAGES eArenaPages;
+    ssize_t arenaTrimResets;
+    k_Epoch* pEpoch;
 } k_ThreadPool;
 
 typedef struct k_ThreadPoolInitArgs
@@ -50,6 +54,9 @@ typedef struct k_ThreadPoolInitArgs
     ssize_t nThreads; /* 0 for 1 main thread arena. */
     ssize_t ringBufferSize; /* Amount of memory to store payloads. Ignored if nThreads is 0. */
     ssize_t arenaReserve; /* NOTE: Reserve virtual address space when using k_Arena, or malloc if k_ArenaList is used. */
+    K_ARENA_PAGES eArenaPages; /* Huge page backing for thread arenas. */
+    ssize_t arenaTrimResets; /* Worker arenas decommit above the high-water of the last arenaTrimResets tasks that left them empty. */
+    k_Epoch* pEpochOrNull; /* Workers are online only while running a task and collect retired memory between tasks. */
     void (*pfnLoopStart)(void*);
     void* pLoopStartArg;
     void (*pfnLoopEnd)(void*);
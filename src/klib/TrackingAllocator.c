@@ -0,0 +1,305 @@
+#include "TrackingAllocator.h"
+
+#include "print.h"
+
+#include <stdlib.h>
+
+typedef struct Block
+{
+    ssize_t size;
+    ssize_t siteI;
+    ssize_t nGrowths;
+} Block;
+
+typedef void* PtrKey;
+
+typedef struct Site
+{
+    const char* ntsFile;
+    ssize_t line;
+} Site;
+
+static inline uint64_t
+hashU64(uint64_t x)
+{
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdLLU;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53LLU;
+    x ^= x >> 33;
+    return x;
+}
+
+static inline uint64_t
+hashPtr(const PtrKey* pp)
+{
+    return hashU64((uint64_t)(uintptr_t)*pp);
+}
+
+static inline ssize_t
+cmpPtr(const PtrKey* pL, const PtrKey* pR)
+{
+    return *pL != *pR;
+}
+
+static inline uint64_t
+hashSite(const Site* pSite)
+{
+    return hashU64((uint64_t)(uintptr_t)pSite->ntsFile ^ ((uint64_t)pSite->line << 40));
+}
+
+static inline ssize_t
+cmpSite(const Site* pL, const Site* pR)
+{
+    return pL->ntsFile != pR->ntsFile || pL->line != pR->line;
+}
+
+#define K_NAME MapPtrToBlock
+#define K_KEY_T PtrKey
+#define K_VALUE_T Block
+#define K_FN_HASH hashPtr
+#define K_FN_KEY_CMP cmpPtr
+#define K_DECL_MOD K_UNUSED static
+#include "MapGen-inl.h"
+
+#define K_NAME MapSiteToI
+#define K_KEY_T Site
+#define K_VALUE_T ssize_t
+#define K_FN_HASH hashSite
+#define K_FN_KEY_CMP cmpSite
+#define K_DECL_MOD K_UNUSED static
+#include "MapGen-inl.h"
+
+#define K_NAME VecSiteStats
+#define K_TYPE k_TrackingSiteStats
+#define K_DECL_MOD K_UNUSED static
+#include "VecGen-inl.h"
+
+typedef struct k_TrackingState
+{
+    MapPtrToBlock mapBlocks;
+    MapSiteToI mapSites;
+    VecSiteStats vSites;
+} k_TrackingState;
+
+static ssize_t
+currentSiteI(k_TrackingAllocator* s)
+{
+    k_TrackingState* pState = s->priv.pState;
+    k_IAllocator* pBacking = s->priv.pBackingAlloc;
+    const Site site = {s->priv.ntsSiteFile, s->priv.siteLine};
+
+    MapSiteToIResult res = MapSiteToISearch(&pState->mapSites, &site);
+    if (res.eStatus == K_MAP_RESULT_STATUS_FOUND) return res.pBucket->value;
+
+    const ssize_t i = VecSiteStatsPush(&pState->vSites, pBacking, &(k_TrackingSiteStats){.ntsFile = site.ntsFile, .line = site.line});
+    if (i == K_NPOS) return K_NPOS;
+    MapSiteToIInsertHashed(&pState->mapSites, pBacking, &site, &i, res.hash);
+
+    return i;
+}
+
+static void
+addBytes(k_TrackingAllocator* s, k_TrackingSiteStats* pSite, ssize_t nBytes)
+{
+    pSite->bytesLive += nBytes;
+    pSite->bytesPeak = K_MAX(pSite->bytesPeak, pSite->bytesLive);
+
+    s->priv.bytesLive += nBytes;
+    s->priv.bytesPeak = K_MAX(s->priv.bytesPeak, s->priv.bytesLive);
+}
+
+static void
+track(k_TrackingAllocator* s, void* p, ssize_t nBytes)
+{
+    k_TrackingState* pState = s->priv.pState;
+
+    const ssize_t siteI = currentSiteI(s);
+    if (siteI == K_NPOS) return;
+
+    k_TrackingSiteStats* pSite = VecSiteStatsGetP(&pState->vSites, siteI);
+    ++pSite->nAllocs;
+    pSite->bytesTotal += nBytes;
+    addBytes(s, pSite, nBytes);
+
+    MapPtrToBlockInsert(&pState->mapBlocks, s->priv.pBackingAlloc, &p, &(Block){.size = nBytes, .siteI = siteI});
+}
+
+bool
+k_TrackingAllocatorInit(k_TrackingAllocator* s, k_IAllocator* pBackingAlloc)
+{
+    static const k_IAllocatorVTable s_vTable = {
+        .malloc = k_TrackingAllocatorMalloc,
+        .zalloc = k_TrackingAllocatorZalloc,
+        .realloc = k_TrackingAllocatorRealloc,
+        .free = k_TrackingAllocatorFree,
+    };
+
+    k_TrackingState* pState = K_IZALLOC_T(pBackingAlloc, k_TrackingState, 1);
+    if (!pState) return false;
+
+    if (!MapPtrToBlockInit(&pState->mapBlocks, pBackingAlloc, 64)) goto fail;
+    if (!MapSiteToIInit(&pState->mapSites, pBackingAlloc, 16)) goto fail;
+
+    s->base.pVTable = &s_vTable;
+    s->priv.pBackingAlloc = pBackingAlloc;
+    s->priv.pState = pState;
+    s->priv.ntsSiteFile = "(unknown)";
+    s->priv.siteLine = 0;
+    s->priv.bytesLive = 0;
+    s->priv.bytesPeak = 0;
+
+    return true;
+
+fail:
+    MapPtrToBlockDestroy(&pState->mapBlocks, pBackingAlloc);
+    k_IAllocatorFree(pBackingAlloc, pState);
+    return false;
+}
+
+void
+k_TrackingAllocatorDestroy(k_TrackingAllocator* s)
+{
+    k_TrackingState* pState = s->priv.pState;
+    k_IAllocator* pBacking = s->priv.pBackingAlloc;
+
+    MapPtrToBlockDestroy(&pState->mapBlocks, pBacking);
+    MapSiteToIDestroy(&pState->mapSites, pBacking);
+    VecSiteStatsDestroy(&pState->vSites, pBacking);
+    k_IAllocatorFree(pBacking, pState);
+    *s = (k_TrackingAllocator){0};
+}
+
+void*
+k_TrackingAllocatorMalloc(void* pSelf, ssize_t nBytes)
+{
+    k_TrackingAllocator* s = (k_TrackingAllocator*)pSelf;
+    void* p = k_IAllocatorMalloc(s->priv.pBackingAlloc, nBytes);
+    if (p) track(s, p, nBytes);
+    return p;
+}
+
+void*
+k_TrackingAllocatorZalloc(void* pSelf, ssize_t nBytes)
+{
+    k_TrackingAllocator* s = (k_TrackingAllocator*)pSelf;
+    void* p = k_IAllocatorZalloc(s->priv.pBackingAlloc, nBytes);
+    if (p) track(s, p, nBytes);
+    return p;
+}
+
+void*
+k_TrackingAllocatorRealloc(void* pSelf, void* p, ssize_t oldNBytes, ssize_t newNBytes)
+{
+    k_TrackingAllocator* s = (k_TrackingAllocator*)pSelf;
+    k_TrackingState* pState = s->priv.pState;
+
+    MapPtrToBlockResult res = {0};
+    if (p) res = MapPtrToBlockSearch(&pState->mapBlocks, &p);
+
+    void* pNew = k_IAllocatorRealloc(s->priv.pBackingAlloc, p, oldNBytes, newNBytes);
+    if (!pNew) return NULL;
+
+    if (res.eStatus != K_MAP_RESULT_STATUS_FOUND)
+    {
+        track(s, pNew, newNBytes);
+        return pNew;
+    }
+
+    /* Growth is charged to the site that made the block, that's the container that over-grows. */
+    Block block = res.pBucket->value;
+    k_TrackingSiteStats* pSite = VecSiteStatsGetP(&pState->vSites, block.siteI);
+    ++pSite->nReallocs;
+    if (newNBytes > block.size)
+    {
+        ++pSite->nGrowths;
+        ++block.nGrowths;
+        pSite->maxGrowthChain = K_MAX(pSite->maxGrowthChain, block.nGrowths);
+        pSite->bytesTotal += newNBytes - block.size;
+    }
+    addBytes(s, pSite, newNBytes - block.size);
+    block.size = newNBytes;
+
+    if (pNew == p)
+    {
+        res.pBucket->value = block;
+    }
+    else
+    {
+        MapPtrToBlockRemove(&pState->mapBlocks, &p);
+        MapPtrToBlockInsert(&pState->mapBlocks, s->priv.pBackingAlloc, &pNew, &block);
+    }
+
+    return pNew;
+}
+
+void
+k_TrackingAllocatorFree(void* pSelf, void* p)
+{
+    k_TrackingAllocator* s = (k_TrackingAllocator*)pSelf;
+    k_TrackingState* pState = s->priv.pState;
+    if (!p) return;
+
+    MapPtrToBlockResult res = MapPtrToBlockSearch(&pState->mapBlocks, &p);
+    if (res.eStatus == K_MAP_RESULT_STATUS_FOUND)
+    {
+        k_TrackingSiteStats* pSite = VecSiteStatsGetP(&pState->vSites, res.pBucket->value.siteI);
+        ++pSite->nFrees;
+        addBytes(s, pSite, -res.pBucket->value.size);
+        MapPtrToBlockRemoveI(&pState->mapBlocks, res.pBucket - pState->mapBlocks.pBuckets);
+    }
+
+    k_IAllocatorFree(s->priv.pBackingAlloc, p);
+}
+
+ssize_t
+k_TrackingAllocatorSites(k_TrackingAllocator* s, const k_TrackingSiteStats** ppSites)
+{
+    *ppSites = s->priv.pState->vSites.pData;
+    return s->priv.pState->vSites.size;
+}
+
+ssize_t
+k_TrackingAllocatorLiveBlocks(k_TrackingAllocator* s)
+{
+    return s->priv.pState->mapBlocks.size;
+}
+
+static int
+cmpPeakDesc(const void* pL, const void* pR)
+{
+    const k_TrackingSiteStats* l = *(const k_TrackingSiteStats**)pL;
+    const k_TrackingSiteStats* r = *(const k_TrackingSiteStats**)pR;
+    if (l->bytesPeak != r->bytesPeak) return l->bytesPeak < r->bytesPeak ? 1 : -1;
+    return 0;
+}
+
+void
+k_TrackingAllocatorPrintReport(k_TrackingAllocator* s, FILE* pFile)
+{
+    k_TrackingState* pState = s->priv.pState;
+    k_IAllocator* pBacking = s->priv.pBackingAlloc;
+    const ssize_t nSites = pState->vSites.size;
+
+    k_print(pBacking, pFile, "tracking: live: {sz} bytes in {sz} blocks, peak: {sz} bytes, sites: {sz}\n",
+        s->priv.bytesLive, pState->mapBlocks.size, s->priv.bytesPeak, nSites
+    );
+    if (nSites <= 0) return;
+
+    const k_TrackingSiteStats** ppSorted = K_IMALLOC_T(pBacking, const k_TrackingSiteStats*, nSites);
+    if (!ppSorted) return;
+
+    for (ssize_t i = 0; i < nSites; ++i) ppSorted[i] = VecSiteStatsGetP(&pState->vSites, i);
+    qsort(ppSorted, nSites, sizeof(*ppSorted), cmpPeakDesc);
+
+    for (ssize_t i = 0; i < nSites; ++i)
+    {
+        const k_TrackingSiteStats* p = ppSorted[i];
+        k_print(pBacking, pFile,
+            "    {s}:{sz}: peak: {sz}, live: {sz}, total: {sz}, allocs: {sz}, frees: {sz}, reallocs: {sz}, growths: {sz}, max chain: {sz}\n",
+            p->ntsFile, p->line, p->bytesPeak, p->bytesLive, p->bytesTotal, p->nAllocs, p->nFrees, p->nReallocs, p->nGrowths, p->maxGrowthChain
+        );
+    }
+
+    k_IAllocatorFree(pBacking, ppSorted);
+}
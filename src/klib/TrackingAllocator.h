@@ -0,0 +1,76 @@
+#pragma once
+
+#include "IAllocator.h"
+
+#include <stdio.h>
+
+typedef struct k_TrackingSiteStats
+{
+    const char* ntsFile;
+    ssize_t line;
+    ssize_t nAllocs;
+    ssize_t nReallocs;
+    ssize_t nGrowths; /* Reallocs that made the block bigger. */
+    ssize_t maxGrowthChain; /* Most growths a single block went through. */
+    ssize_t nFrees;
+    ssize_t bytesLive;
+    ssize_t bytesPeak;
+    ssize_t bytesTotal; /* Sum of all requested bytes, including realloc growth. */
+} k_TrackingSiteStats;
+
+/* Decorator that records allocation statistics per call site.
+ * The site is sticky: every allocation is attributed to the last K_TRACKING_SITE() until the next one,
+ * so a K_TRACKING_SITE() before container calls attributes their growth to that line.
+ * NOTE: thread unsafe. */
+typedef struct k_TrackingAllocator
+{
+    k_IAllocator base;
+
+    struct
+    {
+        k_IAllocator* pBackingAlloc;
+        struct k_TrackingState* pState;
+        const char* ntsSiteFile;
+        ssize_t siteLine;
+        ssize_t bytesLive;
+        ssize_t bytesPeak;
+    } priv;
+} k_TrackingAllocator;
+
+bool k_TrackingAllocatorInit(k_TrackingAllocator* s, k_IAllocator* pBackingAlloc);
+void k_TrackingAllocatorDestroy(k_TrackingAllocator* s); /* NOTE: Doesn't free live blocks. */
+K_NO_DISCARD void* k_TrackingAllocatorMalloc(void* s, ssize_t nBytes);
+K_NO_DISCARD void* k_TrackingAllocatorZalloc(void* s, ssize_t nBytes);
+K_NO_DISCARD void* k_TrackingAllocatorRealloc(void* s, void* p, ssize_t oldNBytes, ssize_t newNBytes);
+void k_TrackingAllocatorFree(void* s, void* p);
+static inline void k_TrackingAllocatorSetSite(k_TrackingAllocator* s, const char* ntsFile, ssize_t line);
+ssize_t k_TrackingAllocatorSites(k_TrackingAllocator* s, const k_TrackingSiteStats** ppSites); /* Returns number of sites. */
+ssize_t k_TrackingAllocatorLiveBlocks(k_TrackingAllocator* s);
+void k_TrackingAllocatorPrintReport(k_TrackingAllocator* s, FILE* pFile); /* Sites sorted by peak bytes. */
+static inline ssize_t k_TrackingAllocatorBytesLive(k_TrackingAllocator* s);
+static inline ssize_t k_TrackingAllocatorBytesPeak(k_TrackingAllocator* s);
+
+#define K_TRACKING_SITE(pTracking) k_TrackingAllocatorSetSite(pTracking, __FILE__, __LINE__)
+#define K_TRACKING_IMALLOC_T(pTracking, type, count) (K_TRACKING_SITE(pTracking), K_IMALLOC_T(pTracking, type, count))
+#define K_TRACKING_IZALLOC_T(pTracking, type, count) (K_TRACKING_SITE(pTracking), K_IZALLOC_T(pTracking, type, count))
+#define K_TRACKING_IREALLOC_T(pTracking, type, ptr, oldCount, newCount)                                                \
+    (K_TRACKING_SITE(pTracking), K_IREALLOC_T(pTracking, type, ptr, oldCount, newCount))
+
+static inline void
+k_TrackingAllocatorSetSite(k_TrackingAllocator* s, const char* ntsFile, ssize_t line)
+{
+    s->priv.ntsSiteFile = ntsFile;
+    s->priv.siteLine = line;
+}
+
+static inline ssize_t
+k_TrackingAllocatorBytesLive(k_TrackingAllocator* s)
+{
+    return s->priv.bytesLive;
+}
+
+static inline ssize_t
+k_TrackingAllocatorBytesPeak(k_TrackingAllocator* s)
+{
+    return s->priv.bytesPeak;
+}
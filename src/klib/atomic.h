@@ -22,10 +22,12 @@
     #undef FAR
 
 typedef LONG k_atomic_IntType;
+typedef LONG64 k_atomic_SsizeType;
 
 #elif defined __unix__
 
 typedef int k_atomic_IntType;
+typedef ssize_t k_atomic_SsizeType;
 
 /* __ATOMIC_RELAXED
  * 
@@ -59,6 +61,29 @@ K_ALWAYS_INLINE static void k_AtomicIntStoreRelease(k_atomic_Int* s, k_atomic_In
 K_ALWAYS_INLINE static k_atomic_IntType k_AtomicIntAddRelaxed(k_atomic_Int* s, k_atomic_IntType val);
 K_ALWAYS_INLINE static k_atomic_IntType k_AtomicIntAddRelease(k_atomic_Int* s, k_atomic_IntType val);
 K_ALWAYS_INLINE static k_atomic_IntType k_AtomicIntSubRelease(k_atomic_Int* s, k_atomic_IntType val);
+K_ALWAYS_INLINE static k_atomic_IntType k_AtomicIntExchangeAcquire(k_atomic_Int* s, k_atomic_IntType val); /* Returns previous value. */
+
+typedef struct k_atomic_Ssize
+{
+    volatile k_atomic_SsizeType volNum;
+} k_atomic_Ssize;
+
+K_ALWAYS_INLINE static k_atomic_SsizeType k_AtomicSsizeLoadRelaxed(k_atomic_Ssize* s);
+K_ALWAYS_INLINE static k_atomic_SsizeType k_AtomicSsizeLoadAcquire(k_atomic_Ssize* s);
+K_ALWAYS_INLINE static void k_AtomicSsizeStoreRelease(k_atomic_Ssize* s, k_atomic_SsizeType val);
+K_ALWAYS_INLINE static k_atomic_SsizeType k_AtomicSsizeFetchAddRelaxed(k_atomic_Ssize* s, k_atomic_SsizeType val); /* Returns previous value. */
+K_ALWAYS_INLINE static bool k_AtomicSsizeCasAcqRel(k_atomic_Ssize* s, k_atomic_SsizeType* pExpected, k_atomic_SsizeType desired);
+
+typedef struct k_atomic_Ptr
+{
+    void* volatile volPtr;
+} k_atomic_Ptr;
+
+K_ALWAYS_INLINE static void* k_AtomicPtrLoadAcquire(k_atomic_Ptr* s);
+K_ALWAYS_INLINE static void k_AtomicPtrStoreRelease(k_atomic_Ptr* s, void* p);
+K_ALWAYS_INLINE static void* k_AtomicPtrExchangeAcqRel(k_atomic_Ptr* s, void* p); /* Returns previous value. */
+
+K_ALWAYS_INLINE static void k_AtomicFenceSeqCst(void);
 
 #if defined _WIN32
 
@@ -98,6 +123,69 @@ k_AtomicIntSubRelease(k_atomic_Int* s, k_atomic_IntType val)
     return InterlockedAddRelease(&s->volNum, -val);
 }
 
+K_ALWAYS_INLINE static k_atomic_IntType
+k_AtomicIntExchangeAcquire(k_atomic_Int* s, k_atomic_IntType val)
+{
+    return InterlockedExchangeAcquire(&s->volNum, val);
+}
+
+K_ALWAYS_INLINE static k_atomic_SsizeType
+k_AtomicSsizeLoadRelaxed(k_atomic_Ssize* s)
+{
+    return InterlockedCompareExchangeNoFence64(&s->volNum, 0, 0);
+}
+
+K_ALWAYS_INLINE static k_atomic_SsizeType
+k_AtomicSsizeLoadAcquire(k_atomic_Ssize* s)
+{
+    return InterlockedCompareExchangeAcquire64(&s->volNum, 0, 0);
+}
+
+K_ALWAYS_INLINE static void
+k_AtomicSsizeStoreRelease(k_atomic_Ssize* s, k_atomic_SsizeType val)
+{
+    InterlockedExchange64(&s->volNum, val);
+}
+
+K_ALWAYS_INLINE static k_atomic_SsizeType
+k_AtomicSsizeFetchAddRelaxed(k_atomic_Ssize* s, k_atomic_SsizeType val)
+{
+    return InterlockedExchangeAddNoFence64(&s->volNum, val);
+}
+
+K_ALWAYS_INLINE static bool
+k_AtomicSsizeCasAcqRel(k_atomic_Ssize* s, k_atomic_SsizeType* pExpected, k_atomic_SsizeType desired)
+{
+    const k_atomic_SsizeType old = InterlockedCompareExchange64(&s->volNum, desired, *pExpected);
+    if (old == *pExpected) return true;
+    *pExpected = old;
+    return false;
+}
+
+K_ALWAYS_INLINE static void*
+k_AtomicPtrLoadAcquire(k_atomic_Ptr* s)
+{
+    return InterlockedCompareExchangePointerAcquire(&s->volPtr, NULL, NULL);
+}
+
+K_ALWAYS_INLINE static void
+k_AtomicPtrStoreRelease(k_atomic_Ptr* s, void* p)
+{
+    InterlockedExchangePointer(&s->volPtr, p);
+}
+
+K_ALWAYS_INLINE static void*
+k_AtomicPtrExchangeAcqRel(k_atomic_Ptr* s, void* p)
+{
+    return InterlockedExchangePointer(&s->volPtr, p);
+}
+
+K_ALWAYS_INLINE static void
+k_AtomicFenceSeqCst(void)
+{
+    MemoryBarrier();
+}
+
 #elif defined __unix__
 
 K_ALWAYS_INLINE static k_atomic_IntType
@@ -136,4 +224,64 @@ k_AtomicIntSubRelease(k_atomic_Int* s, k_atomic_IntType val)
     return __atomic_fetch_sub(&s->volNum, val, __ATOMIC_RELEASE);
 }
 
+K_ALWAYS_INLINE static k_atomic_IntType
+k_AtomicIntExchangeAcquire(k_atomic_Int* s, k_atomic_IntType val)
+{
+    return __atomic_exchange_n(&s->volNum, val, __ATOMIC_ACQUIRE);
+}
+
+K_ALWAYS_INLINE static k_atomic_SsizeType
+k_AtomicSsizeLoadRelaxed(k_atomic_Ssize* s)
+{
+    return __atomic_load_n(&s->volNum, __ATOMIC_RELAXED);
+}
+
+K_ALWAYS_INLINE static k_atomic_SsizeType
+k_AtomicSsizeLoadAcquire(k_atomic_Ssize* s)
+{
+    return __atomic_load_n(&s->volNum, __ATOMIC_ACQUIRE);
+}
+
+K_ALWAYS_INLINE static void
+k_AtomicSsizeStoreRelease(k_atomic_Ssize* s, k_atomic_SsizeType val)
+{
+    __atomic_store_n(&s->volNum, val, __ATOMIC_RELEASE);
+}
+
+K_ALWAYS_INLINE static k_atomic_SsizeType
+k_AtomicSsizeFetchAddRelaxed(k_atomic_Ssize* s, k_atomic_SsizeType val)
+{
+    return __atomic_fetch_add(&s->volNum, val, __ATOMIC_RELAXED);
+}
+
+K_ALWAYS_INLINE static bool
+k_AtomicSsizeCasAcqRel(k_atomic_Ssize* s, k_atomic_SsizeType* pExpected, k_atomic_SsizeType desired)
+{
+    return __atomic_compare_exchange_n(&s->volNum, pExpected, desired, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+K_ALWAYS_INLINE static void*
+k_AtomicPtrLoadAcquire(k_atomic_Ptr* s)
+{
+    return __atomic_load_n(&s->volPtr, __ATOMIC_ACQUIRE);
+}
+
+K_ALWAYS_INLINE static void
+k_AtomicPtrStoreRelease(k_atomic_Ptr* s, void* p)
+{
+    __atomic_store_n(&s->volPtr, p, __ATOMIC_RELEASE);
+}
+
+K_ALWAYS_INLINE static void*
+k_AtomicPtrExchangeAcqRel(k_atomic_Ptr* s, void* p)
+{
+    return __atomic_exchange_n(&s->volPtr, p, __ATOMIC_ACQ_REL);
+}
+
+K_ALWAYS_INLINE static void
+k_AtomicFenceSeqCst(void)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
 #endif
@@ -56,6 +56,9 @@ static const uint64_t K_NPOS64 = (uint64_t)-1;
     #define K_NO_UB
     #define K_NO_DISCARD _Check_return_
     #define K_ALWAYS_INLINE __forceinline
+    #define K_PREFETCH(p) _mm_prefetch((const char*)(p), _MM_HINT_T0)
+
+    #include <xmmintrin.h>
 
 #elif defined __clang__ || defined __GNUC__
 
@@ -63,6 +66,7 @@ static const uint64_t K_NPOS64 = (uint64_t)-1;
     #define K_NO_UB __attribute__((no_sanitize("undefined")))
     #define K_NO_DISCARD __attribute__((warn_unused_result))
     #define K_ALWAYS_INLINE __attribute__((always_inline)) inline
+    #define K_PREFETCH(p) __builtin_prefetch(p)
 
 #else
 #endif
@@ -5,8 +5,12 @@
 #if defined _WIN32
     #include <io.h>
     #include <direct.h>
+    #include <windows.h>
 #elif defined __unix__
     #include <unistd.h>
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
 #endif
 
 bool
@@ -56,6 +60,75 @@ k_file_write(int fd, void* pBuff, ssize_t buffSize)
 #endif
 }
 
+bool
+k_file_save(const char* ntsPath, k_Span sp)
+{
+    FILE* pFile = fopen(ntsPath, "wb");
+    if (!pFile) return false;
+
+    const bool bOk = sp.size <= 0 || fwrite(sp.pData, sp.size, 1, pFile) == 1;
+    return fclose(pFile) == 0 && bOk;
+}
+
+k_Span
+k_file_map(const char* ntsPath)
+{
+    k_Span sp = {0};
+
+#if defined _WIN32
+    HANDLE hFile = CreateFileA(ntsPath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) return sp;
+
+    LARGE_INTEGER fileSize;
+    if (GetFileSizeEx(hFile, &fileSize) && fileSize.QuadPart > 0)
+    {
+        HANDLE hMapping = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (hMapping)
+        {
+            void* pMem = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+            if (pMem)
+            {
+                sp.pData = pMem;
+                sp.size = fileSize.QuadPart;
+            }
+            CloseHandle(hMapping); /* The view keeps the mapping alive. */
+        }
+    }
+
+    CloseHandle(hFile);
+#elif defined __unix__
+    const int fd = open(ntsPath, O_RDONLY);
+    if (fd == -1) return sp;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        void* pMem = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (pMem != MAP_FAILED)
+        {
+            sp.pData = pMem;
+            sp.size = st.st_size;
+        }
+    }
+
+    close(fd);
+#endif
+
+    return sp;
+}
+
+void
+k_file_unmap(k_Span sp)
+{
+    if (!sp.pData) return;
+
+#if defined _WIN32
+    UnmapViewOfFile(sp.pData);
+#elif defined __unix__
+    munmap(sp.pData, sp.size);
+#endif
+}
+
 k_StringView
 k_file_cwd(void)
 {
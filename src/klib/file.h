@@ -7,6 +7,9 @@
 bool k_file_isatty(int fd);
 K_NO_DISCARD k_Span k_file_load(k_IAllocator* pAlloc, const char* ntsPath);
 ssize_t k_file_write(int fd, void* pBuff, ssize_t buffSize);
+bool k_file_save(const char* ntsPath, k_Span sp); /* Creates or truncates. */
+K_NO_DISCARD k_Span k_file_map(const char* ntsPath); /* Read-only mapping of the whole file, empty span on failure. */
+void k_file_unmap(k_Span sp);
 k_StringView k_file_cwd(void);
 static inline const char* k_file_shorterFILE(const char* ntsFILE); /* Shorter __FILE__ macro. */
 
@@ -0,0 +1,238 @@
+#ifdef _WIN32
+    #define _CRT_RAND_S /* rand_s(), has to come before stdlib.h. */
+#endif
+
+#include "hash.h"
+#include "atomic.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#ifdef K_HASH_X86
+    #include <immintrin.h>
+#endif
+
+/* Long keys: 8 lanes of 64 bit accumulators, each 64 byte stripe adds a 32x32 -> 64 multiply of the key-mixed word
+ * to its own lane and the raw word to the neighbouring one (xxh3 style). The per-stripe key slides over s_aSecret, so
+ * reordering stripes changes the result, and every 16 stripes the lanes are scrambled.
+ * All of it maps onto AVX2 lane ops one to one, the vector path gives bit identical results. */
+
+#define K_HASH_BLOCK_STRIPES 16
+#define K_HASH_PRIME32 0x9e3779b1U
+
+static const uint64_t s_aSecret[24] = {
+    0xbe4ba423396cfeb8LLU, 0x1cad21f72c81017cLLU, 0xdb979083e96dd4deLLU, 0x1f67b3b7a4a44072LLU,
+    0x78e5c0cc4ee679cbLLU, 0x2172ffcc7dd05a82LLU, 0x8e2443f7744608b8LLU, 0x4c263a81e69035e0LLU,
+    0xcb00c391bb52283cLLU, 0xa32e531b8b65d088LLU, 0x4ef90da297486471LLU, 0xd8acdea946ef1938LLU,
+    0x3f349ce33f76faa8LLU, 0x1d4f0bc7c7bbdcf9LLU, 0x3159b4cd4be0518aLLU, 0x647378d9c97e9fc8LLU,
+    0xc3ebd33483acc5eaLLU, 0xeb6313faffa081c5LLU, 0x49daf0b751dd0d17LLU, 0x9e68d429265516d3LLU,
+    0xfca1477d58be162bLLU, 0xce31d07ad1b8f88fLLU, 0x280416958f3acb45LLU, 0x7e404bbbcafbd7afLLU,
+};
+
+static inline void
+hashAccumulateScalar(uint64_t* aAcc, const uint8_t* p, const uint64_t* pKey)
+{
+    for (int i = 0; i < 8; ++i)
+    {
+        const uint64_t d = k_hash_read64(p + i*8);
+        const uint64_t dk = d ^ pKey[i];
+        aAcc[i ^ 1] += d;
+        aAcc[i] += (dk & 0xffffffff) * (dk >> 32);
+    }
+}
+
+static inline void
+hashScrambleScalar(uint64_t* aAcc, const uint64_t* pKey)
+{
+    for (int i = 0; i < 8; ++i)
+        aAcc[i] = (aAcc[i] ^ (aAcc[i] >> 47) ^ pKey[i]) * K_HASH_PRIME32;
+}
+
+static uint64_t
+hashFinish(const uint64_t* aAcc, ssize_t byteSize, uint64_t seed)
+{
+    uint64_t h = (uint64_t)byteSize * K_HASH_S0;
+    for (int i = 0; i < 8; i += 2)
+        h += k_hash_mum(aAcc[i] ^ s_aSecret[i + 3], aAcc[i + 1] ^ s_aSecret[i + 4]);
+
+    return k_hash_mum(h ^ K_HASH_S2, seed ^ K_HASH_S3);
+}
+
+static uint64_t
+hashLongScalar(const uint8_t* p, ssize_t byteSize, uint64_t seed)
+{
+    uint64_t aAcc[8];
+    for (int i = 0; i < 8; ++i) aAcc[i] = s_aSecret[i] ^ seed;
+
+    /* The last stripe (full or not) always comes from the end of the key. */
+    const ssize_t nStripes = (byteSize - 1) / K_HASH_STRIPE;
+    for (ssize_t s = 0; s < nStripes; ++s)
+    {
+        const ssize_t stripeI = s % K_HASH_BLOCK_STRIPES;
+        hashAccumulateScalar(aAcc, p + s*K_HASH_STRIPE, &s_aSecret[stripeI]);
+        if (stripeI == K_HASH_BLOCK_STRIPES - 1) hashScrambleScalar(aAcc, &s_aSecret[K_HASH_BLOCK_STRIPES]);
+    }
+    hashAccumulateScalar(aAcc, p + byteSize - K_HASH_STRIPE, &s_aSecret[K_HASH_BLOCK_STRIPES]);
+
+    return hashFinish(aAcc, byteSize, seed);
+}
+
+#ifdef K_HASH_X86
+
+K_HASH_TARGET("avx2") static inline __m256i
+hashAccumulateAvx2(__m256i acc, const uint8_t* p, const uint64_t* pKey)
+{
+    const __m256i d = _mm256_loadu_si256((const __m256i*)p);
+    const __m256i dk = _mm256_xor_si256(d, _mm256_loadu_si256((const __m256i*)pKey));
+    const __m256i prod = _mm256_mul_epu32(dk, _mm256_srli_epi64(dk, 32));
+    const __m256i dSwapped = _mm256_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2));
+    return _mm256_add_epi64(acc, _mm256_add_epi64(prod, dSwapped));
+}
+
+K_HASH_TARGET("avx2") static inline __m256i
+hashScrambleAvx2(__m256i acc, const uint64_t* pKey)
+{
+    const __m256i prime = _mm256_set1_epi32((int)K_HASH_PRIME32);
+    acc = _mm256_xor_si256(acc, _mm256_srli_epi64(acc, 47));
+    acc = _mm256_xor_si256(acc, _mm256_loadu_si256((const __m256i*)pKey));
+
+    /* 64x32 multiply out of two 32x32 ones. */
+    const __m256i lo = _mm256_mul_epu32(acc, prime);
+    const __m256i hi = _mm256_mul_epu32(_mm256_srli_epi64(acc, 32), prime);
+    return _mm256_add_epi64(lo, _mm256_slli_epi64(hi, 32));
+}
+
+K_HASH_TARGET("avx2") static uint64_t
+hashLongAvx2(const uint8_t* p, ssize_t byteSize, uint64_t seed)
+{
+    const __m256i vSeed = _mm256_set1_epi64x((long long)seed);
+    __m256i acc0 = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)&s_aSecret[0]), vSeed);
+    __m256i acc1 = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)&s_aSecret[4]), vSeed);
+
+    const ssize_t nStripes = (byteSize - 1) / K_HASH_STRIPE;
+    for (ssize_t s = 0; s < nStripes; ++s)
+    {
+        const ssize_t stripeI = s % K_HASH_BLOCK_STRIPES;
+        const uint8_t* pStripe = p + s*K_HASH_STRIPE;
+        acc0 = hashAccumulateAvx2(acc0, pStripe, &s_aSecret[stripeI]);
+        acc1 = hashAccumulateAvx2(acc1, pStripe + 32, &s_aSecret[stripeI + 4]);
+        if (stripeI == K_HASH_BLOCK_STRIPES - 1)
+        {
+            acc0 = hashScrambleAvx2(acc0, &s_aSecret[K_HASH_BLOCK_STRIPES]);
+            acc1 = hashScrambleAvx2(acc1, &s_aSecret[K_HASH_BLOCK_STRIPES + 4]);
+        }
+    }
+
+    const uint8_t* pLast = p + byteSize - K_HASH_STRIPE;
+    acc0 = hashAccumulateAvx2(acc0, pLast, &s_aSecret[K_HASH_BLOCK_STRIPES]);
+    acc1 = hashAccumulateAvx2(acc1, pLast + 32, &s_aSecret[K_HASH_BLOCK_STRIPES + 4]);
+
+    uint64_t aAcc[8];
+    _mm256_storeu_si256((__m256i*)&aAcc[0], acc0);
+    _mm256_storeu_si256((__m256i*)&aAcc[4], acc1);
+    return hashFinish(aAcc, byteSize, seed);
+}
+
+static bool
+hashCpuHasAvx2(void)
+{
+#if defined __clang__ || defined __GNUC__
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#elif defined _MSC_VER
+    int aRegs[4];
+    __cpuid(aRegs, 0);
+    if (aRegs[0] < 7) return false;
+
+    /* The os has to save ymm registers too. */
+    __cpuid(aRegs, 1);
+    const bool bOsxsave = (aRegs[2] & (1 << 27)) != 0;
+    if (!bOsxsave || (_xgetbv(0) & 6) != 6) return false;
+
+    __cpuidex(aRegs, 7, 0);
+    return (aRegs[1] & (1 << 5)) != 0;
+#else
+    return false;
+#endif
+}
+
+#endif /* K_HASH_X86 */
+
+static k_atomic_Int s_atomImpl; /* K_HASH_IMPL + 1, 0 if not checked yet. */
+
+K_HASH_IMPL
+k_hash_bestImpl(void)
+{
+    int impl = k_AtomicIntLoadRelaxed(&s_atomImpl);
+    if (impl == 0)
+    {
+#ifdef K_HASH_X86
+        impl = 1 + (hashCpuHasAvx2() ? K_HASH_IMPL_AVX2 : K_HASH_IMPL_SCALAR);
+#else
+        impl = 1 + K_HASH_IMPL_SCALAR;
+#endif
+        k_AtomicIntStoreRelease(&s_atomImpl, impl);
+    }
+
+    return (K_HASH_IMPL)(impl - 1);
+}
+
+uint64_t
+k_hash_longImpl(K_HASH_IMPL eImpl, const uint8_t* p, ssize_t byteSize, uint64_t seed)
+{
+    assert(byteSize > K_HASH_LONG_MIN);
+
+#ifdef K_HASH_X86
+    if (eImpl == K_HASH_IMPL_AVX2 && k_hash_bestImpl() == K_HASH_IMPL_AVX2)
+        return hashLongAvx2(p, byteSize, seed);
+#endif
+
+    return hashLongScalar(p, byteSize, seed);
+}
+
+uint64_t
+k_hash_long(const uint8_t* p, ssize_t byteSize, uint64_t seed)
+{
+    return k_hash_longImpl(k_hash_bestImpl(), p, byteSize, seed);
+}
+
+static uint64_t
+hashOsEntropy(void)
+{
+    uint64_t r = 0;
+#ifdef _WIN32
+    unsigned int lo = 0, hi = 0;
+    if (rand_s(&lo) == 0 && rand_s(&hi) == 0) r = ((uint64_t)hi << 32) | lo;
+#else
+    FILE* pFile = fopen("/dev/urandom", "rb");
+    if (pFile)
+    {
+        if (fread(&r, sizeof(r), 1, pFile) != 1) r = 0;
+        fclose(pFile);
+    }
+#endif
+
+    /* No entropy source: at least differ between runs (aslr) and processes. */
+    if (r == 0) r = k_hash_u64((uint64_t)(uintptr_t)&r, (uint64_t)time(NULL)) | 1;
+    return r;
+}
+
+static k_atomic_Ssize s_atomSeedKey; /* 0 until the first k_hash_randomSeed(). */
+static k_atomic_Ssize s_atomSeedCounter;
+
+uint64_t
+k_hash_randomSeed(void)
+{
+    k_atomic_SsizeType key = k_AtomicSsizeLoadRelaxed(&s_atomSeedKey);
+    if (key == 0)
+    {
+        k_atomic_SsizeType expected = 0;
+        const k_atomic_SsizeType fresh = (k_atomic_SsizeType)(hashOsEntropy() | 1);
+        if (k_AtomicSsizeCasAcqRel(&s_atomSeedKey, &expected, fresh)) key = fresh;
+        else key = expected;
+    }
+
+    const k_atomic_SsizeType i = k_AtomicSsizeFetchAddRelaxed(&s_atomSeedCounter, 1);
+    return k_hash_u64((uint64_t)i, (uint64_t)key);
+}
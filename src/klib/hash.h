@@ -3,10 +3,48 @@
 #include "common.h"
 
 #include <assert.h>
-#include <nmmintrin.h>
+#include <string.h>
 
-/* Not a real crc remainder. Just a hash function using crc32 hardware intrinsic. */
-K_NO_UB static inline uint64_t
+#if defined __x86_64__ || defined __i386__ || defined _M_X64 || defined _M_IX86
+    #define K_HASH_X86
+    #include <nmmintrin.h>
+#endif
+
+#if defined _MSC_VER && (defined _M_X64 || defined _M_ARM64)
+    #include <intrin.h>
+#endif
+
+#if defined K_HASH_X86 && (defined __clang__ || defined __GNUC__)
+    #define K_HASH_TARGET(s) __attribute__((target(s)))
+#else
+    #define K_HASH_TARGET(s)
+#endif
+
+#define K_HASH_LONG_MIN 256 /* k_hash_fast() hands longer keys to the vectorized k_hash_long(). */
+#define K_HASH_STRIPE 64 /* Bytes per k_hash_long() accumulation step. */
+
+/* k_hash_fast() output doesn't depend on which k_hash_long() implementation runs. */
+typedef enum K_HASH_IMPL
+{
+    K_HASH_IMPL_SCALAR,
+    K_HASH_IMPL_AVX2,
+} K_HASH_IMPL;
+
+uint64_t k_hash_long(const uint8_t* p, ssize_t byteSize, uint64_t seed); /* byteSize > K_HASH_LONG_MIN. */
+uint64_t k_hash_longImpl(K_HASH_IMPL eImpl, const uint8_t* p, ssize_t byteSize, uint64_t seed); /* Falls back to scalar if eImpl isn't supported. */
+K_HASH_IMPL k_hash_bestImpl(void); /* CPUID, checked once. */
+uint64_t k_hash_randomSeed(void); /* Different on each call and each run, from os entropy. Not for cryptography. */
+
+static const uint64_t K_HASH_S0 = 0xa0761d6478bd642fLLU;
+static const uint64_t K_HASH_S1 = 0xe7037ed1a0b428dbLLU;
+static const uint64_t K_HASH_S2 = 0x8ebc6af09c88c6e3LLU;
+static const uint64_t K_HASH_S3 = 0x589965cc75374cc3LLU;
+
+#ifdef K_HASH_X86
+
+/* Not a real crc remainder. Just a hash function using crc32 hardware intrinsic.
+ * NOTE: Needs an SSE4.2 cpu, only 32 bits of the result vary. Prefer k_hash_fast(). */
+K_NO_UB K_HASH_TARGET("sse4.2") static inline uint64_t
 k_hash_crc32(const uint8_t* p, ssize_t byteSize, uint64_t seed)
 {
     uint64_t crc = seed;
@@ -31,6 +69,8 @@ k_hash_crc32(const uint8_t* p, ssize_t byteSize, uint64_t seed)
     return ~crc;
 }
 
+#endif /* K_HASH_X86 */
+
 K_NO_UB static inline uint64_t
 k_hash_mulXor(const uint8_t* p, ssize_t byteSize, uint64_t seed)
 {
@@ -43,3 +83,115 @@ k_hash_mulXor(const uint8_t* p, ssize_t byteSize, uint64_t seed)
 
     return hash;
 }
+
+/* Full 64x64 -> 128 multiply, *pA gets the low half and *pB the high one. */
+static inline void
+k_hash_mul128(uint64_t* pA, uint64_t* pB)
+{
+#if defined __SIZEOF_INT128__
+    __extension__ const unsigned __int128 r = (unsigned __int128)*pA * *pB;
+    *pA = (uint64_t)r;
+    *pB = (uint64_t)(r >> 64);
+#elif defined _MSC_VER && defined _M_X64
+    *pA = _umul128(*pA, *pB, pB);
+#elif defined _MSC_VER && defined _M_ARM64
+    const uint64_t hi = __umulh(*pA, *pB);
+    *pA = *pA * *pB;
+    *pB = hi;
+#else
+    const uint64_t ha = *pA >> 32, hb = *pB >> 32, la = (uint32_t)*pA, lb = (uint32_t)*pB;
+    const uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    const uint64_t t = rl + (rm0 << 32);
+    const uint64_t lo = t + (rm1 << 32);
+    *pB = rh + (rm0 >> 32) + (rm1 >> 32) + (t < rl) + (lo < t);
+    *pA = lo;
+#endif
+}
+
+/* Multiply and fold the halves. */
+static inline uint64_t
+k_hash_mum(uint64_t a, uint64_t b)
+{
+    k_hash_mul128(&a, &b);
+    return a ^ b;
+}
+
+static inline uint64_t
+k_hash_read64(const uint8_t* p)
+{
+    uint64_t x;
+    memcpy(&x, p, sizeof(x));
+    return x;
+}
+
+static inline uint64_t
+k_hash_read32(const uint8_t* p)
+{
+    uint32_t x;
+    memcpy(&x, p, sizeof(x));
+    return x;
+}
+
+/* wyhash style: 128 bit multiplies over 16 byte blocks, overlapping loads for the tail.
+ * Doesn't need any instruction set extensions. Keys longer than K_HASH_LONG_MIN go to k_hash_long(). */
+static inline uint64_t
+k_hash_fast(const uint8_t* p, ssize_t byteSize, uint64_t seed)
+{
+    if (byteSize > K_HASH_LONG_MIN) return k_hash_long(p, byteSize, seed);
+
+    seed ^= k_hash_mum(seed ^ K_HASH_S0, K_HASH_S1);
+
+    uint64_t a, b;
+    if (byteSize <= 16)
+    {
+        if (byteSize >= 4)
+        {
+            const ssize_t off = (byteSize >> 3) << 2;
+            a = (k_hash_read32(p) << 32) | k_hash_read32(p + off);
+            b = (k_hash_read32(p + byteSize - 4) << 32) | k_hash_read32(p + byteSize - 4 - off);
+        }
+        else if (byteSize > 0)
+        {
+            a = ((uint64_t)p[0] << 16) | ((uint64_t)p[byteSize >> 1] << 8) | p[byteSize - 1];
+            b = 0;
+        }
+        else
+        {
+            a = b = 0;
+        }
+    }
+    else
+    {
+        ssize_t i = byteSize;
+        if (i > 48)
+        {
+            uint64_t see1 = seed, see2 = seed;
+            do
+            {
+                seed = k_hash_mum(k_hash_read64(p) ^ K_HASH_S1, k_hash_read64(p + 8) ^ seed);
+                see1 = k_hash_mum(k_hash_read64(p + 16) ^ K_HASH_S2, k_hash_read64(p + 24) ^ see1);
+                see2 = k_hash_mum(k_hash_read64(p + 32) ^ K_HASH_S3, k_hash_read64(p + 40) ^ see2);
+                p += 48, i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+
+        for (; i > 16; p += 16, i -= 16)
+            seed = k_hash_mum(k_hash_read64(p) ^ K_HASH_S1, k_hash_read64(p + 8) ^ seed);
+
+        a = k_hash_read64(p + i - 16);
+        b = k_hash_read64(p + i - 8);
+    }
+
+    a ^= K_HASH_S1;
+    b ^= seed;
+    k_hash_mul128(&a, &b);
+    return k_hash_mum(a ^ K_HASH_S0 ^ (uint64_t)byteSize, b ^ K_HASH_S1);
+}
+
+/* For integer keys. */
+static inline uint64_t
+k_hash_u64(uint64_t x, uint64_t seed)
+{
+    return k_hash_mum(x ^ seed ^ K_HASH_S0, x ^ K_HASH_S1);
+}